@@ -0,0 +1,103 @@
+#include "bench.hpp"
+#include "struct_pack.hpp"
+#include "struct_pack/append_log.hpp"
+#include "struct_pack/record_writer.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using Fmt = decltype("<QId16s"_fmt);
+
+constexpr std::size_t num_records = 4'000'000;
+
+auto temp_path(const char *name) -> std::string {
+    // /dev/shm is tmpfs on Linux; fall back to /tmp elsewhere
+    auto path = std::string("/dev/shm/") + name;
+    int  fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        path = std::string("/tmp/") + name;
+    } else {
+        ::close(fd);
+    }
+    return path;
+}
+
+template <typename F>
+void run_threads(std::size_t threads, F &&body) {
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            body(t);
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+auto main() -> int {
+    auto path = temp_path("struct_pack_append_log_bench");
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency()
+              << '\n';
+
+    for (std::size_t threads : {1, 2, 4, 8}) {
+        auto per_thread = num_records / threads;
+        auto suffix = ", " + std::to_string(threads) + " thread(s)";
+
+        // The baseline: one buffered writer shared behind a lock
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0) {
+            std::perror("open");
+            return 1;
+        }
+        {
+            auto       writer = struct_pack::record_writer<Fmt>(fd);
+            std::mutex mutex;
+            bench::measure("mutex + record_writer" + suffix, num_records, [&] {
+                run_threads(threads, [&](std::size_t t) {
+                    for (uint64_t i = 0; i < per_thread; i++) {
+                        auto lock = std::lock_guard{mutex};
+                        writer.write(
+                            i, static_cast<uint32_t>(t), 0.5, "SYMBOL");
+                    }
+                });
+                writer.flush();
+            });
+        }
+        ::close(fd);
+
+        for (std::size_t batch : {1, 32}) {
+            auto log
+                = struct_pack::append_log<Fmt>::create(path, num_records);
+            bench::measure(
+                "append_log, batch " + std::to_string(batch) + suffix,
+                num_records,
+                [&] {
+                    run_threads(threads, [&](std::size_t t) {
+                        for (uint64_t i = 0; i < per_thread;) {
+                            auto r = log.try_reserve(
+                                std::min<std::size_t>(batch, per_thread - i));
+                            for (std::size_t k = 0; k < r.count; k++, i++) {
+                                struct_pack::pack_into(
+                                    Fmt{},
+                                    r.data + k * log.record_size,
+                                    i,
+                                    static_cast<uint32_t>(t),
+                                    0.5,
+                                    "SYMBOL");
+                            }
+                            log.commit(r);
+                        }
+                    });
+                });
+        }
+    }
+    std::remove(path.c_str());
+}
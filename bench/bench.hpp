@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string_view>
+
+namespace bench {
+
+// Runs `body` once and prints how many `items` per second it sustained and
+// the time per item
+template <typename F>
+auto measure(std::string_view name, std::size_t items, F &&body) -> double {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    auto elapsed = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    auto rate = static_cast<double>(items) / elapsed;
+    std::cout << name << ": " << static_cast<std::size_t>(rate)
+              << " items/s, " << 1e9 / rate << " ns/item (" << elapsed * 1e3
+              << " ms)\n";
+    return rate;
+}
+
+// Keeps the optimizer from discarding a computed value
+template <typename T>
+inline void do_not_optimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+} // namespace bench
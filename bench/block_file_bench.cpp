@@ -0,0 +1,50 @@
+#include "bench.hpp"
+#include "struct_pack.hpp"
+#include "struct_pack/block_file.hpp"
+
+#include <cstdint>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+using Tick = decltype("<qId8s"_fmt); // time, id, price, symbol
+
+constexpr std::int64_t num_records = 4'000'000;
+
+auto main() -> int {
+    // An in-memory file, so the numbers show the reads saved rather than
+    // the disk
+    int fd = ::memfd_create("block_file_bench", MFD_CLOEXEC);
+    {
+        auto writer = struct_pack::block_file_writer<Tick, 0>(fd);
+        for (std::int64_t t = 0; t < num_records; t++) {
+            writer.write(t, static_cast<uint32_t>(t % 1000), 1.5, "SYMBOL");
+        }
+    }
+
+    // One percent of the time range
+    auto from = num_records / 2;
+    auto to = from + num_records / 100;
+
+    std::int64_t sum = 0;
+    auto         consume = [&](auto record) {
+        sum += record.template get<0>();
+    };
+
+    for (int round = 0; round < 2; round++) {
+        auto reader = struct_pack::block_file_reader<Tick>(fd);
+        bench::measure("full scan + filter", num_records, [&] {
+            reader.for_each([&](auto record) {
+                auto time = record.template get<0>();
+                if (from <= time && time <= to) {
+                    consume(record);
+                }
+            });
+        });
+        bench::measure("zone map range scan", num_records, [&] {
+            reader.scan_range<0>(from, to, consume);
+        });
+    }
+    bench::do_not_optimize(sum);
+    ::close(fd);
+}
@@ -0,0 +1,38 @@
+#include "bench.hpp"
+#include "struct_pack.hpp"
+#include "struct_pack/checksum.hpp"
+
+#include <cstdint>
+#include <vector>
+
+using Fmt = decltype("<QId16s"_fmt);
+
+constexpr std::size_t num_records = 5'000'000;
+
+template <typename Checksum>
+auto run(std::string_view name, std::vector<char> &out) -> void {
+    constexpr auto size = struct_pack::checksummed_size<Checksum>(Fmt{});
+    out.resize(num_records * size);
+    bench::measure(name, num_records, [&] {
+        for (uint64_t i = 0; i < num_records; i++) {
+            struct_pack::pack_into_checksummed<Checksum>(
+                Fmt{}, out.data() + i * size, i, uint32_t(i), 0.5, "SYMBOL");
+        }
+    });
+    bench::do_not_optimize(out.data());
+}
+
+auto main() -> int {
+    constexpr auto size = struct_pack::calcsize(Fmt{});
+    auto           out = std::vector<char>(num_records * size);
+    bench::measure("pack_into, no checksum", num_records, [&] {
+        for (uint64_t i = 0; i < num_records; i++) {
+            struct_pack::pack_into(
+                Fmt{}, out.data() + i * size, i, uint32_t(i), 0.5, "SYMBOL");
+        }
+    });
+    bench::do_not_optimize(out.data());
+
+    run<struct_pack::crc32c>("pack_into_checksummed<crc32c>", out);
+    run<struct_pack::xxhash64>("pack_into_checksummed<xxhash64>", out);
+}
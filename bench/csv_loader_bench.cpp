@@ -0,0 +1,58 @@
+#include "bench.hpp"
+#include "struct_pack.hpp"
+#include "struct_pack/csv_loader.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Tick = decltype("<qIdd?16s"_fmt); // time, id, bid, ask, active, symbol
+
+constexpr std::size_t num_records = 2'000'000;
+
+auto main() -> int {
+    std::string text;
+    for (std::size_t i = 0; i < num_records; i++) {
+        text += std::to_string(1'700'000'000'000'000 + i * 997) + ","
+                + std::to_string(i % 100'000) + ","
+                + std::to_string(100 + i % 1000) + ".125,"
+                + std::to_string(100 + i % 1000) + ".5,"
+                + (i % 2 == 0 ? "1" : "0") + ",SYMBOL"
+                + std::to_string(i % 300) + "\n";
+    }
+    auto megabytes = static_cast<double>(text.size()) / 1e6;
+
+    auto report = [&](double records_per_second) {
+        std::cout << "    " << records_per_second / num_records * megabytes
+                  << " MB/s\n";
+    };
+
+    std::vector<std::size_t> thread_counts = {1};
+    if (std::thread::hardware_concurrency() > 1) {
+        thread_counts.push_back(std::thread::hardware_concurrency());
+    }
+    for (int round = 0; round < 2; round++) {
+        for (auto threads : thread_counts) {
+            struct_pack::csv_options options;
+            options.threads = threads;
+            report(bench::measure(
+                "load_csv, " + std::to_string(threads) + " threads",
+                num_records,
+                [&] {
+                    auto records = struct_pack::load_csv(Tick{}, text, options);
+                    bench::do_not_optimize(records.data());
+                }));
+        }
+        report(bench::measure("parse_csv into a reserved builder",
+                              num_records,
+                              [&] {
+                                  auto builder
+                                      = struct_pack::record_builder<Tick>();
+                                  builder.reserve(num_records);
+                                  struct_pack::parse_csv(text, builder);
+                                  bench::do_not_optimize(builder.data());
+                              }));
+    }
+}
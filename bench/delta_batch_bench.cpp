@@ -0,0 +1,57 @@
+#include "bench.hpp"
+#include "struct_pack.hpp"
+#include "struct_pack/delta_batch.hpp"
+#include "struct_pack/record_view.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using Tick = decltype("<QqId"_fmt); // sequence, time, id, price
+
+constexpr std::size_t num_records = 1'000'000;
+
+auto main() -> int {
+    constexpr auto size = struct_pack::calcsize(Tick{});
+    std::string    records;
+    for (std::size_t i = 0; i < num_records; i++) {
+        auto time = 1'700'000'000'000'000 + static_cast<int64_t>(i * 997);
+        auto packed = struct_pack::pack(Tick{},
+                                        static_cast<uint64_t>(i),
+                                        time + static_cast<int64_t>(i % 61),
+                                        static_cast<uint32_t>(i % 5000),
+                                        0.5);
+        records.append(packed.data(), packed.size());
+    }
+
+    auto encoded = struct_pack::encode_delta<0, 1>(Tick{}, records);
+    auto batch = struct_pack::delta_batch<Tick, 0, 1>(encoded);
+    std::cout << records.size() << " bytes packed, " << encoded.size()
+              << " delta encoded\n";
+
+    std::vector<int64_t> times(num_records);
+    std::string          decoded(records.size(), '\0');
+    for (int round = 0; round < 2; round++) {
+        bench::measure("encode", num_records, [&] {
+            auto again = struct_pack::encode_delta<0, 1>(Tick{}, records);
+            bench::do_not_optimize(again.data());
+        });
+        bench::measure("time column from packed records", num_records, [&] {
+            for (std::size_t i = 0; i < num_records; i++) {
+                times[i] = struct_pack::record_view<Tick>(records.data()
+                                                          + i * size)
+                               .get<1>();
+            }
+            bench::do_not_optimize(times.data());
+        });
+        bench::measure("decode_column", num_records, [&] {
+            batch.decode_column<1>(times.data());
+            bench::do_not_optimize(times.data());
+        });
+        bench::measure("decode_into", num_records, [&] {
+            batch.decode_into(decoded.data());
+            bench::do_not_optimize(decoded.data());
+        });
+    }
+}
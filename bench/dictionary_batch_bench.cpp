@@ -0,0 +1,56 @@
+#include "bench.hpp"
+#include "struct_pack.hpp"
+#include "struct_pack/dictionary_batch.hpp"
+#include "struct_pack/record_view.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+using Tick = decltype("<qId16s"_fmt); // time, id, price, symbol
+
+constexpr std::size_t num_records = 1'000'000;
+
+auto main() -> int {
+    constexpr auto size = struct_pack::calcsize(Tick{});
+    std::string    records;
+    for (std::size_t i = 0; i < num_records; i++) {
+        auto symbol = "SYMBOL" + std::to_string(i % 300);
+        auto packed = struct_pack::pack(Tick{},
+                                        static_cast<int64_t>(i),
+                                        static_cast<uint32_t>(i),
+                                        0.5,
+                                        symbol);
+        records.append(packed.data(), packed.size());
+    }
+
+    auto encoded = struct_pack::encode_dictionary<3>(Tick{}, records);
+    auto batch = struct_pack::dictionary_batch<Tick, 3>(encoded);
+    std::cout << records.size() << " bytes packed, " << encoded.size()
+              << " dictionary encoded\n";
+
+    int64_t sum = 0;
+    for (int round = 0; round < 2; round++) {
+        bench::measure("encode", num_records, [&] {
+            auto again = struct_pack::encode_dictionary<3>(Tick{}, records);
+            bench::do_not_optimize(again.data());
+        });
+        bench::measure("filter packed records", num_records, [&] {
+            auto wanted = struct_pack::pack("16s"_fmt, "SYMBOL42");
+            for (std::size_t i = 0; i < num_records; i++) {
+                auto record = struct_pack::record_view<Tick>(records.data()
+                                                             + i * size);
+                if (record.get<3>()
+                    == std::string_view(wanted.data(), wanted.size())) {
+                    sum += record.get<0>();
+                }
+            }
+        });
+        bench::measure("filter dictionary codes", num_records, [&] {
+            batch.for_each_equal("SYMBOL42", [&](std::size_t i) {
+                sum += batch.get<0>(i);
+            });
+        });
+    }
+    bench::do_not_optimize(sum);
+}
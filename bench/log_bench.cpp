@@ -0,0 +1,104 @@
+#include "bench.hpp"
+#include "struct_pack/binary_log.hpp"
+#include "struct_pack/log.hpp"
+
+#include <iostream>
+#include <streambuf>
+#include <string>
+
+using namespace print_hpp::log;
+
+namespace {
+// Discards everything, so only the cost of producing a line is measured
+class null_buffer : public std::streambuf {
+protected:
+    auto overflow(int ch) -> int override {
+        return ch;
+    }
+
+    auto xsputn(const char * /*data*/, std::streamsize size)
+        -> std::streamsize override {
+        return size;
+    }
+};
+
+constexpr std::size_t num_messages = 1'000'000;
+} // namespace
+
+auto main() -> int {
+    null_buffer null;
+    auto       *old = std::clog.rdbuf(&null);
+    auto        name = std::string("worker-7");
+
+    for (int round = 0; round < 2; round++) {
+        auto precise = detail::ConsoleLogger();
+        bench::measure("sync, system_clock", num_messages, [&] {
+            for (std::size_t i = 0; i < num_messages; i++) {
+                precise.info("processed {} records for {} in {} us",
+                             i,
+                             name,
+                             0.25);
+            }
+        });
+
+        auto coarse = detail::ConsoleLogger();
+        coarse.set_clock(LogClock::COARSE);
+        bench::measure("sync, coarse clock", num_messages, [&] {
+            for (std::size_t i = 0; i < num_messages; i++) {
+                coarse.info("processed {} records for {} in {} us",
+                            i,
+                            name,
+                            0.25);
+            }
+        });
+
+        auto async = detail::ConsoleLogger();
+        async.enable_async({.queue_size = 1 << 16});
+        bench::measure("async, caller side", num_messages, [&] {
+            for (std::size_t i = 0; i < num_messages; i++) {
+                async.info("processed {} records for {} in {} us",
+                           i,
+                           name,
+                           0.25);
+            }
+        });
+        bench::measure("async, until written", num_messages, [&] {
+            for (std::size_t i = 0; i < num_messages; i++) {
+                async.info("processed {} records for {} in {} us",
+                           i,
+                           name,
+                           0.25);
+            }
+            async.flush();
+        });
+        async.disable_async();
+
+        auto writer = BinaryLogWriter(1 << 20);
+        bench::measure("binary", num_messages, [&] {
+            for (std::size_t i = 0; i < num_messages; i++) {
+                BINARY_LOG(writer,
+                           INFO,
+                           "processed {} records for {} in {} us",
+                           i,
+                           name,
+                           0.25);
+                if (writer.size() > (1 << 19)) {
+                    writer.clear();
+                }
+            }
+        });
+
+        auto disabled = detail::ConsoleLogger();
+        disabled.set_level(LogLevel::WARN);
+        bench::measure("below the level", num_messages, [&] {
+            for (std::size_t i = 0; i < num_messages; i++) {
+                disabled.info("processed {} records for {} in {} us",
+                              i,
+                              name,
+                              0.25);
+            }
+        });
+    }
+
+    std::clog.rdbuf(old);
+}
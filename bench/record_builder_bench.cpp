@@ -0,0 +1,46 @@
+#include "bench.hpp"
+#include "struct_pack.hpp"
+#include "struct_pack/record_builder.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using Fmt = decltype("<QId16s"_fmt);
+
+constexpr std::size_t num_records = 4'000'000;
+
+auto main() -> int {
+    bench::measure("pack() + vector<char>::insert", num_records, [] {
+        std::vector<char> batch;
+        for (uint64_t i = 0; i < num_records; i++) {
+            auto packed = struct_pack::pack(
+                Fmt{}, i, static_cast<uint32_t>(i), 0.5, "SYMBOL");
+            batch.insert(batch.end(), packed.begin(), packed.end());
+        }
+        bench::do_not_optimize(batch.data());
+    });
+
+    for (auto pages :
+         {struct_pack::buffer_pages::normal, struct_pack::buffer_pages::huge}) {
+        auto suffix = std::string(
+            pages == struct_pack::buffer_pages::huge ? ", huge pages" : "");
+        bench::measure("record_builder" + suffix, num_records, [&] {
+            auto builder = struct_pack::record_builder<Fmt>(pages);
+            for (uint64_t i = 0; i < num_records; i++) {
+                builder.append(i, static_cast<uint32_t>(i), 0.5, "SYMBOL");
+            }
+            auto batch = builder.release();
+            bench::do_not_optimize(batch.data());
+        });
+        bench::measure("record_builder, reserved" + suffix, num_records, [&] {
+            auto builder
+                = struct_pack::record_builder<Fmt>(num_records, pages);
+            for (uint64_t i = 0; i < num_records; i++) {
+                builder.append(i, static_cast<uint32_t>(i), 0.5, "SYMBOL");
+            }
+            auto batch = builder.release();
+            bench::do_not_optimize(batch.data());
+        });
+    }
+}
@@ -0,0 +1,126 @@
+#include "bench.hpp"
+#include "struct_pack.hpp"
+#include "struct_pack/record_ring.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using Fmt = decltype("<QId16s"_fmt);
+
+constexpr std::size_t num_records = 4'000'000;
+constexpr std::size_t ring_records = 1 << 12;
+
+// The baseline: decoded tuples through a mutex-protected queue
+void mutex_queue(std::size_t producers) {
+    using Record = std::tuple<uint64_t, uint32_t, double, std::string>;
+    std::mutex              mutex;
+    std::condition_variable ready;
+    std::deque<Record>      queue;
+
+    std::vector<std::thread> threads;
+    for (std::size_t p = 0; p < producers; p++) {
+        threads.emplace_back([&] {
+            for (uint64_t i = 0; i < num_records / producers; i++) {
+                {
+                    auto lock = std::lock_guard{mutex};
+                    queue.emplace_back(
+                        i, static_cast<uint32_t>(i), 0.5, "SYMBOL");
+                }
+                ready.notify_one();
+            }
+        });
+    }
+    uint64_t sum = 0;
+    for (std::size_t received = 0; received < num_records; received++) {
+        auto lock = std::unique_lock{mutex};
+        ready.wait(lock, [&] {
+            return !queue.empty();
+        });
+        sum += std::get<0>(queue.front());
+        queue.pop_front();
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    bench::do_not_optimize(sum);
+}
+
+template <struct_pack::ring_producers Producers>
+void ring(std::size_t producers, std::size_t batch) {
+    auto ring = struct_pack::record_ring<Fmt, Producers>(ring_records);
+
+    std::vector<std::thread> threads;
+    for (std::size_t p = 0; p < producers; p++) {
+        threads.emplace_back([&] {
+            for (uint64_t i = 0; i < num_records / producers;) {
+                auto r = ring.try_reserve(
+                    std::min<std::size_t>(batch, num_records / producers - i));
+                if (r.count == 0) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (std::size_t k = 0; k < r.count; k++, i++) {
+                    struct_pack::pack_into(Fmt{},
+                                           r.data + k * ring.record_size,
+                                           i,
+                                           static_cast<uint32_t>(i),
+                                           0.5,
+                                           "SYMBOL");
+                }
+                ring.commit(r);
+            }
+        });
+    }
+    uint64_t    sum = 0;
+    std::size_t received = 0;
+    while (received < num_records) {
+        auto consumed = ring.consume([&](auto record) {
+            sum += record.template get<0>();
+        });
+        if (consumed == 0) {
+            std::this_thread::yield();
+        }
+        received += consumed;
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    bench::do_not_optimize(sum);
+}
+
+auto main() -> int {
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency()
+              << '\n';
+    for (std::size_t producers : {1, 2, 4}) {
+        auto suffix = ", " + std::to_string(producers) + " producer(s)";
+        bench::measure("mutex + deque of tuples" + suffix, num_records, [&] {
+            mutex_queue(producers);
+        });
+        if (producers == 1) {
+            for (std::size_t batch : {1, 64}) {
+                bench::measure("record_ring spsc, batch "
+                                   + std::to_string(batch) + suffix,
+                               num_records,
+                               [&] {
+                                   ring<struct_pack::ring_producers::single>(
+                                       1, batch);
+                               });
+            }
+        }
+        for (std::size_t batch : {1, 64}) {
+            bench::measure(
+                "record_ring mpsc, batch " + std::to_string(batch) + suffix,
+                num_records,
+                [&] {
+                    ring<struct_pack::ring_producers::multiple>(producers,
+                                                                batch);
+                });
+        }
+    }
+}
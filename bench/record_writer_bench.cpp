@@ -0,0 +1,82 @@
+#include "bench.hpp"
+#include "struct_pack.hpp"
+#include "struct_pack/async_record_writer.hpp"
+#include "struct_pack/record_writer.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using Fmt = decltype("<QId16s"_fmt);
+
+constexpr std::size_t num_records = 2'000'000;
+
+auto open_tmpfs(const char *name) -> int {
+    // /dev/shm is tmpfs on Linux; fall back to /tmp elsewhere
+    auto path = std::string("/dev/shm/") + name;
+    int  fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        path = std::string("/tmp/") + name;
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    }
+    ::unlink(path.c_str());
+    return fd;
+}
+
+auto main() -> int {
+    int fd = open_tmpfs("struct_pack_record_writer_bench");
+    if (fd < 0) {
+        std::perror("open");
+        return 1;
+    }
+
+    bench::measure("pack + write per record", num_records / 10, [&] {
+        for (uint64_t i = 0; i < num_records / 10; i++) {
+            auto packed = struct_pack::pack(
+                Fmt{}, i, static_cast<uint32_t>(i), 0.5, "SYMBOL");
+            if (::write(fd, packed.data(), packed.size()) < 0) {
+                std::perror("write");
+            }
+        }
+    });
+
+    for (std::size_t buffer_size : {4096, 1 << 16, 1 << 20}) {
+        ::ftruncate(fd, 0);
+        ::lseek(fd, 0, SEEK_SET);
+        auto name = "record_writer, buffer " + std::to_string(buffer_size);
+        bench::measure(name, num_records, [&] {
+            auto writer = struct_pack::record_writer<Fmt>(fd, buffer_size);
+            for (uint64_t i = 0; i < num_records; i++) {
+                writer.write(i, static_cast<uint32_t>(i), 0.5, "SYMBOL");
+            }
+            writer.flush();
+        });
+    }
+
+    for (auto backend : {struct_pack::write_backend::thread,
+                         struct_pack::write_backend::io_uring}) {
+        ::ftruncate(fd, 0);
+        ::lseek(fd, 0, SEEK_SET);
+        try {
+            auto writer = struct_pack::async_record_writer<Fmt>(
+                fd, 1 << 20, 2, backend);
+            auto name = std::string("async_record_writer, ")
+                        + (backend == struct_pack::write_backend::io_uring
+                               ? "io_uring"
+                               : "thread");
+            bench::measure(name, num_records, [&] {
+                for (uint64_t i = 0; i < num_records; i++) {
+                    writer.write(i, static_cast<uint32_t>(i), 0.5, "SYMBOL");
+                }
+                writer.drain();
+            });
+        } catch (const std::system_error &e) {
+            std::cout << "async_record_writer: " << e.what() << '\n';
+        }
+    }
+
+    ::close(fd);
+}
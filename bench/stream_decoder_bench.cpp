@@ -0,0 +1,37 @@
+#include "bench.hpp"
+#include "struct_pack.hpp"
+#include "struct_pack/stream_decoder.hpp"
+
+#include <cstdint>
+#include <string>
+
+using Fmt = decltype("<QId16s"_fmt);
+
+constexpr std::size_t num_records = 2'000'000;
+
+auto main() -> int {
+    std::string stream;
+    stream.reserve(num_records * struct_pack::calcsize(Fmt{}));
+    for (uint64_t i = 0; i < num_records; i++) {
+        auto packed = struct_pack::pack(
+            Fmt{}, i, static_cast<uint32_t>(i), 0.5, "SYMBOL");
+        stream.append(packed.data(), packed.size());
+    }
+
+    for (std::size_t chunk_size : {7, 64, 1500, 4096, 65536}) {
+        auto     decoder = struct_pack::stream_decoder<Fmt>{};
+        uint64_t sum = 0;
+        auto     name = "stream_decoder, chunk " + std::to_string(chunk_size);
+        bench::measure(name, num_records, [&] {
+            auto view = std::string_view(stream);
+            while (!view.empty()) {
+                auto chunk = view.substr(0, chunk_size);
+                view.remove_prefix(chunk.size());
+                decoder.feed(chunk, [&](const auto &record) {
+                    sum += std::get<0>(record);
+                });
+            }
+        });
+        bench::do_not_optimize(sum);
+    }
+}
@@ -0,0 +1,83 @@
+#include "bench.hpp"
+#include "struct_pack.hpp"
+#include "struct_pack/arena_unpack.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+
+using Fmt = decltype("<QId?16s"_fmt);
+
+constexpr std::size_t num_records = 10'000'000;
+
+auto main() -> int {
+    constexpr auto size = struct_pack::calcsize(Fmt{});
+    std::string    buffer;
+    for (uint64_t i = 0; i < 1024; i++) {
+        auto packed = struct_pack::pack(
+            Fmt{}, i, static_cast<uint32_t>(i), 0.5, i % 2 == 0, "SYMBOL");
+        buffer.append(packed.data(), packed.size());
+    }
+    auto records = std::string_view(buffer);
+
+    uint64_t sum = 0;
+    auto     consume = [&](const auto &record) {
+        auto [q, i, d, b, s] = record;
+        sum += q + i + static_cast<uint64_t>(d) + b + s.size();
+    };
+
+    for (int round = 0; round < 2; round++) {
+        bench::measure("unpack", num_records, [&] {
+            for (std::size_t i = 0; i < num_records; i++) {
+                auto record = records.substr((i % 1024) * size, size);
+                consume(struct_pack::unpack(Fmt{}, record));
+            }
+        });
+        bench::measure("try_unpack", num_records, [&] {
+            for (std::size_t i = 0; i < num_records; i++) {
+                auto record = records.substr((i % 1024) * size, size);
+                if (auto unpacked = struct_pack::try_unpack(Fmt{}, record)) {
+                    consume(*unpacked);
+                }
+            }
+        });
+
+        // Records that outlive their input: a std::string per string item
+        // against one arena allocation per record or per batch
+        bench::measure("unpack + std::string copies", num_records, [&] {
+            for (std::size_t i = 0; i < num_records; i++) {
+                auto record = records.substr((i % 1024) * size, size);
+                auto [q, n, d, b, s] = struct_pack::unpack(Fmt{}, record);
+                auto owned = std::string(s);
+                bench::do_not_optimize(owned.data());
+                consume(std::tuple(q, n, d, b, std::string_view(owned)));
+            }
+        });
+        bench::measure("unpack into an arena", num_records, [&] {
+            std::array<char, 1 << 16>           memory;
+            std::pmr::monotonic_buffer_resource arena(
+                memory.data(), memory.size(), std::pmr::null_memory_resource());
+            for (std::size_t i = 0; i < num_records; i++) {
+                if (i % 1024 == 0) {
+                    arena.release();
+                }
+                auto record = records.substr((i % 1024) * size, size);
+                consume(struct_pack::unpack(Fmt{}, record, arena));
+            }
+        });
+        bench::measure("unpack_records into an arena", num_records, [&] {
+            std::array<char, 1 << 16>           memory;
+            std::pmr::monotonic_buffer_resource arena(
+                memory.data(), memory.size(), std::pmr::null_memory_resource());
+            for (std::size_t i = 0; i < num_records; i += 1024) {
+                arena.release();
+                for (const auto &record :
+                     struct_pack::unpack_records(Fmt{}, records, arena)) {
+                    consume(record);
+                }
+            }
+        });
+    }
+    bench::do_not_optimize(sum);
+}
@@ -0,0 +1,330 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "struct_pack/calcsize.hpp"
+#include "struct_pack/fd_io.hpp"
+#include "struct_pack/pack.hpp"
+#include "struct_pack/record_view.hpp"
+
+namespace struct_pack {
+
+namespace detail {
+    // The first bytes of an append log file
+    struct append_log_header {
+        static constexpr std::uint64_t magic_value = 0x31474f4c444e5041;
+        static constexpr std::uint32_t current_version = 1;
+        static constexpr std::size_t   max_format_size = 128;
+
+        std::uint64_t magic{0};
+        std::uint32_t version{current_version};
+        std::uint32_t record_size{0};
+        std::uint64_t capacity{0};
+        std::uint32_t format_size{0};
+        char          format[max_format_size]{};
+
+        // Slots handed out so far, possibly past capacity
+        alignas(64) std::atomic<std::uint64_t> reserved{0};
+    };
+} // namespace detail
+
+// A fixed-capacity file of records of one format that many threads, or
+// processes, append to at once without a lock. The file is created at its
+// full size and mapped; an append reserves a slot with one fetch_add, packs
+// into the mapping and sets the slot's bit in a commit bitmap. Readers
+// follow the bitmap and see a record only once it is complete.
+//
+//     auto log = struct_pack::append_log<Fmt>::create("trades.log", 1 << 20);
+//     log.append(id, price);              // any thread
+//
+//     std::uint64_t cursor = 0;           // a reader, maybe elsewhere
+//     log.follow(cursor, [](auto record) { ... });
+template <typename Fmt>
+class append_log {
+public:
+    static constexpr std::size_t record_size = struct_pack::calcsize(Fmt{});
+
+    static_assert(Fmt::size() <= detail::append_log_header::max_format_size,
+                  "append_log stores formats of up to 128 characters");
+
+    // Slots reserved by a writer; each must be filled before commit()
+    struct reservation {
+        char         *data;
+        std::size_t   count;
+        std::uint64_t index;
+    };
+
+    // Creates (or truncates) `path` with room for `capacity` records
+    static auto create(const std::string &path, std::size_t capacity)
+        -> append_log {
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            detail::throw_errno("append_log: open");
+        }
+        auto size = layout_size(capacity);
+        // Allocate every block now, so appends never extend the file
+        if (::posix_fallocate(fd, 0, static_cast<off_t>(size)) != 0
+            && ::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            ::close(fd);
+            detail::throw_errno("append_log: ftruncate");
+        }
+        auto log = map(fd, size);
+        auto *header = new (log.mapping_) header_type;
+        header->record_size = static_cast<std::uint32_t>(record_size);
+        header->capacity = capacity;
+        header->format_size = static_cast<std::uint32_t>(Fmt::size());
+        std::copy_n(Fmt::value(), Fmt::size(), header->format);
+        std::atomic_ref(header->magic)
+            .store(header_type::magic_value, std::memory_order_release);
+        log.bind(header);
+        return log;
+    }
+
+    // Maps an existing log to append to or read. Throws std::system_error
+    // with errc::invalid_argument if it is not a log of Fmt.
+    static auto open(const std::string &path) -> append_log {
+        int fd = ::open(path.c_str(), O_RDWR);
+        if (fd < 0) {
+            detail::throw_errno("append_log: open");
+        }
+        struct stat st {};
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            detail::throw_errno("append_log: fstat");
+        }
+        auto size = static_cast<std::size_t>(st.st_size);
+        if (size < bitmap_offset) {
+            ::close(fd);
+            detail::throw_invalid("append_log: not a log");
+        }
+        auto  log = map(fd, size);
+        auto *header
+            = std::launder(reinterpret_cast<header_type *>(log.mapping_));
+        if (std::atomic_ref(header->magic).load(std::memory_order_acquire)
+                != header_type::magic_value
+            || header->version != header_type::current_version) {
+            detail::throw_invalid("append_log: not a log");
+        }
+        if (header->record_size != record_size
+            || std::string_view(header->format, header->format_size)
+                   != std::string_view(Fmt::value(), Fmt::size())) {
+            detail::throw_invalid("append_log: format mismatch");
+        }
+        if (layout_size(header->capacity) > size) {
+            detail::throw_invalid("append_log: truncated");
+        }
+        log.bind(header);
+        return log;
+    }
+
+    append_log(append_log &&other) noexcept
+        : fd_{std::exchange(other.fd_, -1)}
+        , mapping_{std::exchange(other.mapping_, nullptr)}
+        , mapping_size_{other.mapping_size_}
+        , header_{other.header_}
+        , bitmap_{other.bitmap_}
+        , records_{other.records_}
+        , capacity_{other.capacity_} {}
+
+    auto operator=(append_log &&other) noexcept -> append_log & {
+        std::swap(fd_, other.fd_);
+        std::swap(mapping_, other.mapping_);
+        std::swap(mapping_size_, other.mapping_size_);
+        std::swap(header_, other.header_);
+        std::swap(bitmap_, other.bitmap_);
+        std::swap(records_, other.records_);
+        std::swap(capacity_, other.capacity_);
+        return *this;
+    }
+
+    ~append_log() {
+        if (mapping_ != nullptr) {
+            ::munmap(mapping_, mapping_size_);
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    auto capacity() const -> std::size_t {
+        return capacity_;
+    }
+
+    // Slots reserved so far, committed or not
+    auto reserved() const -> std::uint64_t {
+        return std::min<std::uint64_t>(
+            header_->reserved.load(std::memory_order_relaxed), capacity_);
+    }
+
+    // Writers
+
+    // Reserves up to `count` consecutive slots; fewer at the end of the log
+    // and none once it is full
+    auto try_reserve(std::size_t count = 1) -> reservation {
+        auto index
+            = header_->reserved.fetch_add(count, std::memory_order_relaxed);
+        if (index >= capacity_) {
+            return {nullptr, 0, index};
+        }
+        return {records_ + index * record_size,
+                static_cast<std::size_t>(
+                    std::min<std::uint64_t>(count, capacity_ - index)),
+                index};
+    }
+
+    // Marks a filled reservation as readable
+    auto commit(const reservation &r) -> void {
+        auto first = r.index;
+        auto last = r.index + r.count;
+        while (first < last) {
+            auto bit = first % 64;
+            auto bits = std::min<std::uint64_t>(64 - bit, last - first);
+            auto mask = (bits == 64 ? ~std::uint64_t{0}
+                                    : (std::uint64_t{1} << bits) - 1)
+                        << bit;
+            word(first / 64).fetch_or(mask, std::memory_order_release);
+            first += bits;
+        }
+    }
+
+    // Packs one record into the log; false once it is full
+    template <typename... Args>
+    auto append(Args &&...args) -> bool {
+        auto r = try_reserve(1);
+        if (r.count == 0) {
+            return false;
+        }
+        struct_pack::pack_into(Fmt{}, r.data, std::forward<Args>(args)...);
+        commit(r);
+        return true;
+    }
+
+    // Readers
+
+    auto committed(std::uint64_t index) const -> bool {
+        return index < capacity_
+               && (word(index / 64).load(std::memory_order_acquire)
+                   >> (index % 64) & 1)
+                      != 0;
+    }
+
+    // The first slot at or after `from` that is not committed yet
+    auto committed_until(std::uint64_t from) const -> std::uint64_t {
+        while (from < capacity_) {
+            auto bits = word(from / 64).load(std::memory_order_acquire)
+                        >> (from % 64);
+            auto run = static_cast<std::uint64_t>(std::countr_one(bits));
+            if (run < 64 - from % 64) {
+                return std::min<std::uint64_t>(from + run, capacity_);
+            }
+            from += 64 - from % 64;
+        }
+        return capacity_;
+    }
+
+    // Only valid once committed(index)
+    auto record(std::uint64_t index) const -> record_view<Fmt> {
+        return record_view<Fmt>(records_ + index * record_size);
+    }
+
+    // Calls `on_record` for every committed record from `cursor` up to the
+    // first gap, in order, and moves `cursor` past them
+    template <typename F>
+    auto follow(std::uint64_t &cursor, F &&on_record) const -> std::size_t {
+        auto end = committed_until(cursor);
+        auto start = cursor;
+        for (; cursor < end; cursor++) {
+            on_record(record(cursor));
+        }
+        return static_cast<std::size_t>(end - start);
+    }
+
+    // Writes the mapped pages back to the file now
+    auto sync() -> void {
+        if (::msync(mapping_, mapping_size_, MS_SYNC) != 0) {
+            detail::throw_errno("append_log: msync");
+        }
+    }
+
+    // After a crash, with no writer active: forgets slots reserved past the
+    // committed prefix, including committed records after a gap a dead
+    // writer left, so appends continue right after the last readable one
+    auto recover() -> std::uint64_t {
+        auto end = committed_until(0);
+        for (auto i = end; i < capacity_; i += 64 - i % 64) {
+            auto keep = (std::uint64_t{1} << (i % 64)) - 1;
+            word(i / 64).fetch_and(keep, std::memory_order_relaxed);
+        }
+        header_->reserved.store(end, std::memory_order_release);
+        return end;
+    }
+
+private:
+    using header_type = detail::append_log_header;
+
+    // The header, then one commit bit per slot, then the records, each
+    // section starting on a cache line
+    static constexpr std::size_t bitmap_offset
+        = (sizeof(header_type) + 63) / 64 * 64;
+
+    static constexpr auto records_offset(std::size_t capacity)
+        -> std::size_t {
+        return bitmap_offset + (capacity + 511) / 512 * 64;
+    }
+
+    static constexpr auto layout_size(std::size_t capacity) -> std::size_t {
+        return records_offset(capacity) + capacity * record_size;
+    }
+
+    append_log() = default;
+
+    static auto map(int fd, std::size_t size) -> append_log {
+        void *mapping = ::mmap(
+            nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            detail::throw_errno("append_log: mmap");
+        }
+        auto log = append_log();
+        log.fd_ = fd;
+        log.mapping_ = mapping;
+        log.mapping_size_ = size;
+        return log;
+    }
+
+    auto bind(header_type *header) -> void {
+        header_ = header;
+        capacity_ = static_cast<std::size_t>(header->capacity);
+        bitmap_ = reinterpret_cast<std::uint64_t *>(
+            static_cast<char *>(mapping_) + bitmap_offset);
+        records_ = static_cast<char *>(mapping_) + records_offset(capacity_);
+    }
+
+    auto word(std::uint64_t i) const -> std::atomic_ref<std::uint64_t> {
+        return std::atomic_ref<std::uint64_t>(bitmap_[i]);
+    }
+
+    int            fd_{-1};
+    void          *mapping_{nullptr};
+    std::size_t    mapping_size_{0};
+    header_type   *header_{nullptr};
+    std::uint64_t *bitmap_{nullptr};
+    char          *records_{nullptr};
+    std::size_t    capacity_{0};
+};
+
+} // namespace struct_pack
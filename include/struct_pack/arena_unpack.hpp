@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "struct_pack/calcsize.hpp"
+#include "struct_pack/unpack.hpp"
+
+namespace struct_pack {
+
+namespace detail {
+    // Bytes taken by the 's' items of one record of Fmt
+    template <typename Fmt, size_t... Items>
+    constexpr auto string_bytes(std::index_sequence<Items...>) -> size_t {
+        constexpr FormatType formats[]
+            = {struct_pack::getTypeOfItem<Items>(Fmt{})...};
+        return ((formats[Items].formatChar == 's' ? formats[Items].size : 0)
+                + ... + 0);
+    }
+
+    template <typename Fmt>
+    constexpr size_t string_bytes_v
+        = string_bytes<Fmt>(std::make_index_sequence<countItems(Fmt{})>());
+
+    // Copies every string of `record` to `out` and points it there;
+    // returns the end of the copies
+    template <typename Tuple>
+    auto move_strings(Tuple &record, char *out) -> char * {
+        std::apply(
+            [&out](auto &...items) {
+                auto move_one = [&out](auto &item) {
+                    if constexpr (std::is_same_v<
+                                      std::remove_cvref_t<decltype(item)>,
+                                      std::string_view>) {
+                        std::memcpy(out, item.data(), item.size());
+                        item = std::string_view(out, item.size());
+                        out += item.size();
+                    }
+                };
+                (move_one(items), ...);
+            },
+            record);
+        return out;
+    }
+} // namespace detail
+
+// Like unpack(), but the strings of the result are copied into `arena` with
+// a single allocation, so the result stays valid after the input buffer is
+// reused, for as long as the arena lives. Meant for a monotonic arena such
+// as std::pmr::monotonic_buffer_resource that is reset once per batch.
+template <typename Fmt, typename Input>
+auto unpack(Fmt, Input &&packedInput, std::pmr::memory_resource &arena) {
+    auto record = struct_pack::unpack(Fmt{}, std::forward<Input>(packedInput));
+    constexpr auto string_size = detail::string_bytes_v<Fmt>;
+    if constexpr (string_size > 0) {
+        detail::move_strings(
+            record, static_cast<char *>(arena.allocate(string_size, 1)));
+    }
+    return record;
+}
+
+// Unpacks every whole record of `packedInput` into a vector, with the
+// vector and all the strings allocated from `arena` in one piece each
+template <typename Fmt, typename Input>
+auto unpack_records(Fmt, Input &&packedInput, std::pmr::memory_resource &arena)
+    -> std::pmr::vector<decltype(struct_pack::unpack(Fmt{},
+                                                     std::string_view{}))> {
+    constexpr auto record_size = struct_pack::calcsize(Fmt{});
+    constexpr auto string_size = detail::string_bytes_v<Fmt>;
+
+    const char *data = std::data(packedInput);
+    auto        count = std::size(packedInput) / record_size;
+
+    auto records = std::pmr::vector<decltype(struct_pack::unpack(
+        Fmt{}, std::string_view{}))>(&arena);
+    records.reserve(count);
+
+    char *out = nullptr;
+    if constexpr (string_size > 0) {
+        out = static_cast<char *>(arena.allocate(count * string_size, 1));
+    }
+    for (size_t i = 0; i < count; i++, data += record_size) {
+        auto &record = records.emplace_back(struct_pack::unpack(
+            Fmt{}, std::string_view(data, record_size)));
+        if constexpr (string_size > 0) {
+            out = detail::move_strings(record, out);
+        }
+    }
+    return records;
+}
+
+} // namespace struct_pack
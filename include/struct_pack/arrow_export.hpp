@@ -0,0 +1,367 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "struct_pack/calcsize.hpp"
+#include "struct_pack/unpack.hpp"
+
+// The Arrow C data interface, as specified at
+// https://arrow.apache.org/docs/format/CDataInterface.html; the guard lets
+// it coexist with Arrow's own copy of these definitions.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    // Array type description
+    const char          *format;
+    const char          *name;
+    const char          *metadata;
+    int64_t              flags;
+    int64_t              n_children;
+    struct ArrowSchema **children;
+    struct ArrowSchema  *dictionary;
+
+    // Release callback
+    void (*release)(struct ArrowSchema *);
+    // Opaque producer-specific data
+    void *private_data;
+};
+
+struct ArrowArray {
+    // Array data description
+    int64_t             length;
+    int64_t             null_count;
+    int64_t             offset;
+    int64_t             n_buffers;
+    int64_t             n_children;
+    const void        **buffers;
+    struct ArrowArray **children;
+    struct ArrowArray  *dictionary;
+
+    // Release callback
+    void (*release)(struct ArrowArray *);
+    // Opaque producer-specific data
+    void *private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
+
+namespace struct_pack {
+
+namespace detail {
+    // What an exported schema or array owns. Children are released with
+    // their parent unless a consumer moved them out first.
+    struct arrow_schema_data {
+        std::string                format;
+        std::string                name;
+        std::vector<ArrowSchema>   children;
+        std::vector<ArrowSchema *> child_pointers;
+
+        ~arrow_schema_data() {
+            for (auto &child : children) {
+                if (child.release != nullptr) {
+                    child.release(&child);
+                }
+            }
+        }
+    };
+
+    struct arrow_array_data {
+        std::unique_ptr<char[]>   buffer; // null if the column is borrowed
+        const void               *buffers[2]{};
+        std::vector<ArrowArray>   children;
+        std::vector<ArrowArray *> child_pointers;
+
+        ~arrow_array_data() {
+            for (auto &child : children) {
+                if (child.release != nullptr) {
+                    child.release(&child);
+                }
+            }
+        }
+    };
+
+    inline void release_arrow_schema(ArrowSchema *schema) {
+        delete static_cast<arrow_schema_data *>(schema->private_data);
+        schema->release = nullptr;
+    }
+
+    inline void release_arrow_array(ArrowArray *array) {
+        delete static_cast<arrow_array_data *>(array->private_data);
+        array->release = nullptr;
+    }
+
+    // Fills `out` to own `data`, with `children` blank children
+    inline auto bind_arrow_schema(ArrowSchema                       *out,
+                                  std::unique_ptr<arrow_schema_data> data,
+                                  std::size_t children)
+        -> arrow_schema_data & {
+        data->children.resize(children, ArrowSchema{});
+        for (auto &child : data->children) {
+            data->child_pointers.push_back(&child);
+        }
+        *out = ArrowSchema{};
+        out->format = data->format.c_str();
+        out->name = data->name.c_str();
+        out->n_children = static_cast<int64_t>(children);
+        out->children = data->child_pointers.data();
+        out->release = release_arrow_schema;
+        out->private_data = data.get();
+        return *data.release();
+    }
+
+    inline auto bind_arrow_array(ArrowArray                       *out,
+                                 std::unique_ptr<arrow_array_data> data,
+                                 std::size_t                       length,
+                                 std::size_t                       buffers,
+                                 std::size_t children) -> arrow_array_data & {
+        data->children.resize(children, ArrowArray{});
+        for (auto &child : data->children) {
+            data->child_pointers.push_back(&child);
+        }
+        *out = ArrowArray{};
+        out->length = static_cast<int64_t>(length);
+        out->n_buffers = static_cast<int64_t>(buffers);
+        out->n_children = static_cast<int64_t>(children);
+        out->buffers = data->buffers;
+        out->children = data->child_pointers.data();
+        out->release = release_arrow_array;
+        out->private_data = data.get();
+        return *data.release();
+    }
+
+    template <typename Fmt, std::size_t Item>
+    using arrow_item_type
+        = struct_pack::RepresentedType<decltype(struct_pack::getFormatMode(
+                                           Fmt{})),
+                                       struct_pack::getTypeOfItem<Item>(Fmt{})
+                                           .formatChar>;
+
+    // The Arrow format string of an item: a native type for numbers and
+    // bools, a fixed-size binary for 's' and 'c'
+    template <typename Fmt, std::size_t Item>
+    auto arrow_format() -> std::string {
+        constexpr auto format = struct_pack::getTypeOfItem<Item>(Fmt{});
+        using Type = arrow_item_type<Fmt, Item>;
+        if constexpr (format.formatChar == 's' || format.formatChar == 'c') {
+            return "w:" + std::to_string(format.size);
+        } else if constexpr (std::is_same_v<Type, bool>) {
+            return "b";
+        } else if constexpr (std::is_floating_point_v<Type>) {
+            return sizeof(Type) == 4 ? "f" : "g";
+        } else {
+            constexpr const char *formats[2][4]
+                = {{"C", "S", "I", "L"}, {"c", "s", "i", "l"}};
+            return formats[std::is_signed_v<Type>]
+                          [std::countr_zero(sizeof(Type))];
+        }
+    }
+
+    template <typename Fmt, std::size_t... Items>
+    constexpr auto arrow_columns(std::index_sequence<Items...>)
+        -> std::size_t {
+        return ((struct_pack::getTypeOfItem<Items>(Fmt{}).formatChar != 'x')
+                + ... + 0);
+    }
+
+    template <typename Fmt>
+    constexpr std::size_t arrow_columns_v = arrow_columns<Fmt>(
+        std::make_index_sequence<countItems(Fmt{})>());
+
+    // Whether item Item of records at `data` is already laid out as an
+    // Arrow column: the only item of its records, at native byte order
+    template <typename Fmt, std::size_t Item>
+    auto arrow_borrowable(const char *data) -> bool {
+        constexpr auto format = struct_pack::getTypeOfItem<Item>(Fmt{});
+        using Type = arrow_item_type<Fmt, Item>;
+        if constexpr (struct_pack::calcsize(Fmt{}) != format.size
+                      || format.formatChar == '?') {
+            return false;
+        } else if constexpr (format.formatChar == 's'
+                             || format.formatChar == 'c') {
+            return true;
+        } else {
+            constexpr bool native
+                = sizeof(Type) == 1
+                  || struct_pack::getFormatMode(Fmt{}).isBigEndian()
+                         == (std::endian::native == std::endian::big);
+            return native
+                   && reinterpret_cast<std::uintptr_t>(data) % alignof(Type)
+                          == 0;
+        }
+    }
+
+    template <typename Fmt, std::size_t Item>
+    auto export_arrow_column(const char *data,
+                             std::size_t count,
+                             ArrowArray *out) -> void {
+        constexpr auto record_size = struct_pack::calcsize(Fmt{});
+        constexpr auto formatMode = struct_pack::getFormatMode(Fmt{});
+        constexpr auto format = struct_pack::getTypeOfItem<Item>(Fmt{});
+        using Type = arrow_item_type<Fmt, Item>;
+        data += getBinaryOffset<Item>(Fmt{});
+
+        auto column = std::make_unique<arrow_array_data>();
+        if (arrow_borrowable<Fmt, Item>(data)) {
+            column->buffers[1] = data;
+        } else if constexpr (format.formatChar == '?') {
+            column->buffer = std::make_unique<char[]>((count + 7) / 8);
+            auto *bits
+                = reinterpret_cast<unsigned char *>(column->buffer.get());
+            for (std::size_t i = 0; i < count; i++) {
+                if (data[i * record_size] != '\0') {
+                    bits[i / 8] |= static_cast<unsigned char>(1U << (i % 8));
+                }
+            }
+        } else if constexpr (format.formatChar == 's'
+                             || format.formatChar == 'c') {
+            column->buffer.reset(new char[count * format.size]);
+            for (std::size_t i = 0; i < count; i++) {
+                std::memcpy(column->buffer.get() + i * format.size,
+                            data + i * record_size,
+                            format.size);
+            }
+        } else {
+            column->buffer.reset(new char[count * sizeof(Type)]);
+            for (std::size_t i = 0; i < count; i++) {
+                auto value = unpackElement<Item, Type>(
+                    data + i * record_size,
+                    format.size,
+                    formatMode.isBigEndian());
+                std::memcpy(column->buffer.get() + i * sizeof(Type),
+                            &value,
+                            sizeof(Type));
+            }
+        }
+        if (column->buffer) {
+            column->buffers[1] = column->buffer.get();
+        }
+        bind_arrow_array(out, std::move(column), count, 2, 0);
+    }
+
+    template <typename Fmt, std::size_t... Items>
+    auto export_arrow_columns(const char *data,
+                              std::size_t count,
+                              ArrowArray **columns,
+                              std::index_sequence<Items...>) -> void {
+        (
+            [&] {
+                if constexpr (struct_pack::getTypeOfItem<Items>(Fmt{})
+                                  .formatChar
+                              != 'x') {
+                    export_arrow_column<Fmt, Items>(data, count, *columns++);
+                }
+            }(),
+            ...);
+    }
+
+    template <typename Fmt, std::size_t... Items>
+    auto export_arrow_fields(const std::vector<std::string_view> &names,
+                             ArrowSchema                        **fields,
+                             std::index_sequence<Items...>) -> void {
+        std::size_t column = 0;
+        (
+            [&] {
+                if constexpr (struct_pack::getTypeOfItem<Items>(Fmt{})
+                                  .formatChar
+                              != 'x') {
+                    auto field = std::make_unique<arrow_schema_data>();
+                    field->format = arrow_format<Fmt, Items>();
+                    field->name = names.empty() ? "f" + std::to_string(Items)
+                                                : std::string(names[column]);
+                    bind_arrow_schema(*fields++, std::move(field), 0);
+                    column++;
+                }
+            }(),
+            ...);
+    }
+} // namespace detail
+
+// Exports the schema of records of Fmt through the Arrow C data interface:
+// a struct with one non-nullable field per item, 'x' padding left out.
+// Numbers map to the Arrow type of the same width, '?' to boolean, 's' and
+// 'c' to fixed-size binary. Fields are named `names`, one per field, or
+// "f<item index>" without them. The consumer calls schema->release.
+template <typename Fmt>
+auto export_arrow_schema(Fmt,
+                         ArrowSchema                         *schema,
+                         const std::vector<std::string_view> &names = {})
+    -> void {
+    constexpr auto columns = detail::arrow_columns_v<Fmt>;
+    if (!names.empty() && names.size() != columns) {
+        throw std::system_error(
+            std::make_error_code(std::errc::invalid_argument),
+            "export_arrow_schema: one name per field");
+    }
+    auto  data = std::make_unique<detail::arrow_schema_data>();
+    data->format = "+s";
+    auto &root = detail::bind_arrow_schema(schema, std::move(data), columns);
+    try {
+        detail::export_arrow_fields<Fmt>(
+            names,
+            root.child_pointers.data(),
+            std::make_index_sequence<countItems(Fmt{})>());
+    } catch (...) {
+        schema->release(schema);
+        throw;
+    }
+}
+
+// Exports the whole records of `packedInput` as a struct array with one
+// child array per field of export_arrow_schema(). Columns are gathered
+// with their byte order made native; a format of a single item already at
+// native byte order is exported without a copy, borrowing `packedInput`,
+// which must then outlive the array. The consumer calls array->release.
+template <typename Fmt, typename Input>
+auto export_arrow_array(Fmt, Input &&packedInput, ArrowArray *array) -> void {
+    constexpr auto columns = detail::arrow_columns_v<Fmt>;
+    const char    *data = std::data(packedInput);
+    auto count = std::size(packedInput) / struct_pack::calcsize(Fmt{});
+
+    auto &root = detail::bind_arrow_array(
+        array, std::make_unique<detail::arrow_array_data>(), count, 1, columns);
+    try {
+        detail::export_arrow_columns<Fmt>(
+            data,
+            count,
+            root.child_pointers.data(),
+            std::make_index_sequence<countItems(Fmt{})>());
+    } catch (...) {
+        array->release(array);
+        throw;
+    }
+}
+
+// Both of the above
+template <typename Fmt, typename Input>
+auto export_arrow(Fmt,
+                  Input                               &&packedInput,
+                  ArrowSchema                          *schema,
+                  ArrowArray                           *array,
+                  const std::vector<std::string_view> &names = {}) -> void {
+    export_arrow_schema(Fmt{}, schema, names);
+    try {
+        export_arrow_array(Fmt{}, std::forward<Input>(packedInput), array);
+    } catch (...) {
+        schema->release(schema);
+        throw;
+    }
+}
+
+} // namespace struct_pack
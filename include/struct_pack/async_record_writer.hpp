@@ -0,0 +1,646 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if !defined(STRUCT_PACK_NO_IO_URING) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define STRUCT_PACK_HAS_IO_URING 1
+#else
+#define STRUCT_PACK_HAS_IO_URING 0
+#endif
+
+#include "struct_pack/calcsize.hpp"
+#include "struct_pack/fd_io.hpp"
+#include "struct_pack/pack.hpp"
+
+namespace struct_pack {
+
+enum class write_backend {
+    automatic, // io_uring when the kernel allows it, otherwise thread
+    io_uring,
+    thread,
+};
+
+namespace detail {
+
+    // A finished write: its slot and the errno it failed with, or 0
+    struct write_completion {
+        std::size_t slot;
+        int         error;
+    };
+
+    // Writes whole buffers asynchronously. Buffers are identified by slot
+    // index; submit() hands one off and reap() returns slots whose write
+    // has completed.
+    class async_write_backend {
+    public:
+        virtual ~async_write_backend() = default;
+
+        virtual auto
+        submit(std::size_t slot, const char *data, std::size_t size) -> void
+            = 0;
+
+        // Returns a completed slot, or nullopt if none is ready and `wait`
+        // is false. A failed write still completes its slot.
+        virtual auto reap(bool wait) -> std::optional<write_completion> = 0;
+    };
+
+    // Fallback: a single worker thread performing blocking writes in order
+    class thread_write_backend final : public async_write_backend {
+    public:
+        explicit thread_write_backend(int fd)
+            : fd_{fd}
+            , worker_{[this] {
+                run();
+            }} {}
+
+        ~thread_write_backend() override {
+            {
+                auto lock = std::lock_guard{mutex_};
+                stop_ = true;
+            }
+            jobs_cv_.notify_one();
+            worker_.join();
+        }
+
+        auto submit(std::size_t slot, const char *data, std::size_t size)
+            -> void override {
+            {
+                auto lock = std::lock_guard{mutex_};
+                jobs_.push_back({slot, data, size});
+            }
+            jobs_cv_.notify_one();
+        }
+
+        auto reap(bool wait) -> std::optional<write_completion> override {
+            auto lock = std::unique_lock{mutex_};
+            if (wait) {
+                done_cv_.wait(lock, [this] {
+                    return !done_.empty();
+                });
+            } else if (done_.empty()) {
+                return std::nullopt;
+            }
+            auto next = done_.front();
+            done_.pop_front();
+            return next;
+        }
+
+    private:
+        struct job {
+            std::size_t slot;
+            const char *data;
+            std::size_t size;
+        };
+
+        auto run() -> void {
+            auto lock = std::unique_lock{mutex_};
+            while (true) {
+                jobs_cv_.wait(lock, [this] {
+                    return stop_ || !jobs_.empty();
+                });
+                if (jobs_.empty()) {
+                    return;
+                }
+                auto next = jobs_.front();
+                jobs_.pop_front();
+                lock.unlock();
+
+                int error = 0;
+                try {
+                    write_all(fd_,
+                              next.data,
+                              next.size,
+                              "async_record_writer: write");
+                } catch (const std::system_error &e) {
+                    error = e.code().value();
+                }
+
+                lock.lock();
+                done_.push_back({next.slot, error});
+                done_cv_.notify_one();
+            }
+        }
+
+        int                          fd_;
+        std::mutex                   mutex_;
+        std::condition_variable      jobs_cv_;
+        std::condition_variable      done_cv_;
+        std::deque<job>              jobs_;
+        std::deque<write_completion> done_;
+        bool                         stop_{false};
+        std::thread                  worker_;
+    };
+
+#if STRUCT_PACK_HAS_IO_URING
+    // io_uring driven through the raw syscalls, so liburing is not needed.
+    // Requires a seekable descriptor: every buffer is written at an explicit
+    // offset so several writes can be in flight at once.
+    class uring_write_backend final : public async_write_backend {
+    public:
+        uring_write_backend(int         fd,
+                            char       *buffers,
+                            std::size_t slot_size,
+                            std::size_t num_slots)
+            : fd_{fd}
+            , slots_(num_slots) {
+            auto offset = ::lseek(fd, 0, SEEK_CUR);
+            if (offset < 0) {
+                throw_errno("io_uring: lseek");
+            }
+            file_offset_ = static_cast<std::uint64_t>(offset);
+
+            io_uring_params params{};
+            ring_fd_ = static_cast<int>(
+                ::syscall(__NR_io_uring_setup, num_slots, &params));
+            if (ring_fd_ < 0) {
+                throw_errno("io_uring_setup");
+            }
+            try {
+                map_rings(params);
+                if (!supports_write()) {
+                    throw std::system_error(
+                        std::make_error_code(std::errc::not_supported),
+                        "io_uring: IORING_OP_WRITE");
+                }
+            } catch (...) {
+                unmap_rings();
+                ::close(ring_fd_);
+                throw;
+            }
+
+            // Registered buffers skip the per-write page pinning; they are
+            // an optimization only, so failure (e.g. RLIMIT_MEMLOCK) is fine
+            auto iovs = std::vector<iovec>(num_slots);
+            for (std::size_t i = 0; i < num_slots; i++) {
+                iovs[i] = {buffers + i * slot_size, slot_size};
+            }
+            registered_ = ::syscall(__NR_io_uring_register,
+                                    ring_fd_,
+                                    IORING_REGISTER_BUFFERS,
+                                    iovs.data(),
+                                    static_cast<unsigned>(num_slots))
+                          == 0;
+        }
+
+        uring_write_backend(const uring_write_backend &) = delete;
+        auto operator=(const uring_write_backend &)
+            -> uring_write_backend & = delete;
+
+        ~uring_write_backend() override {
+            unmap_rings();
+            ::close(ring_fd_);
+        }
+
+        auto submit(std::size_t slot, const char *data, std::size_t size)
+            -> void override {
+            slots_[slot] = {data, size, file_offset_};
+            file_offset_ += size;
+            outstanding_++;
+            push(slot);
+        }
+
+        auto reap(bool wait) -> std::optional<write_completion> override {
+            while (true) {
+                auto head = load(cq_head_, std::memory_order_relaxed);
+                if (head == load(cq_tail_, std::memory_order_acquire)) {
+                    if (!wait) {
+                        return std::nullopt;
+                    }
+                    enter(0, 1, IORING_ENTER_GETEVENTS);
+                    continue;
+                }
+                auto cqe = cqes_[head & cq_mask_];
+                store(cq_head_, head + 1, std::memory_order_release);
+
+                auto  slot = static_cast<std::size_t>(cqe.user_data);
+                auto &pending = slots_[slot];
+                auto  written = static_cast<std::size_t>(cqe.res);
+                if (cqe.res > 0 && written < pending.size) {
+                    // Short write: resubmit the remainder of this slot
+                    pending.data += written;
+                    pending.size -= written;
+                    pending.offset += written;
+                    push(slot);
+                    continue;
+                }
+                if (--outstanding_ == 0) {
+                    // Once idle, leave the descriptor positioned after
+                    // everything written, as a series of write(2) would
+                    ::lseek(fd_, static_cast<off_t>(file_offset_), SEEK_SET);
+                }
+                int error = cqe.res < 0 ? -cqe.res : 0;
+                if (cqe.res == 0 && pending.size > 0) {
+                    // Resubmitting a write of nothing would spin forever
+                    error = EIO;
+                }
+                return write_completion{slot, error};
+            }
+        }
+
+    private:
+        struct pending_write {
+            const char   *data;
+            std::size_t   size;
+            std::uint64_t offset;
+        };
+
+        // IORING_OP_WRITE needs Linux 5.6; older kernels also lack the
+        // probe itself, which counts as unsupported
+        auto supports_write() const -> bool {
+            constexpr unsigned    ops = 256;
+            constexpr std::size_t words
+                = (sizeof(io_uring_probe) + ops * sizeof(io_uring_probe_op))
+                  / sizeof(std::uint64_t);
+
+            auto  storage = std::vector<std::uint64_t>(words);
+            auto *probe = reinterpret_cast<io_uring_probe *>(storage.data());
+            if (::syscall(__NR_io_uring_register,
+                          ring_fd_,
+                          IORING_REGISTER_PROBE,
+                          probe,
+                          ops)
+                != 0) {
+                return false;
+            }
+            return IORING_OP_WRITE < probe->ops_len
+                   && (probe->ops[IORING_OP_WRITE].flags
+                       & IO_URING_OP_SUPPORTED)
+                          != 0;
+        }
+
+        static auto load(unsigned *p, std::memory_order order) -> unsigned {
+            return std::atomic_ref<unsigned>(*p).load(order);
+        }
+
+        static auto store(unsigned *p, unsigned v, std::memory_order order)
+            -> void {
+            std::atomic_ref<unsigned>(*p).store(v, order);
+        }
+
+        auto map_rings(const io_uring_params &params) -> void {
+            sq_size_
+                = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_size_ = params.cq_off.cqes
+                       + params.cq_entries * sizeof(io_uring_cqe);
+            if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+                sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+            }
+            sq_ring_ = map(sq_size_, IORING_OFF_SQ_RING);
+            cq_ring_ = (params.features & IORING_FEAT_SINGLE_MMAP) != 0
+                           ? sq_ring_
+                           : map(cq_size_, IORING_OFF_CQ_RING);
+            sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+            sqes_ = static_cast<io_uring_sqe *>(
+                map(sqes_size_, IORING_OFF_SQES));
+
+            auto *sq = static_cast<char *>(sq_ring_);
+            sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+            sq_mask_ = *reinterpret_cast<unsigned *>(
+                sq + params.sq_off.ring_mask);
+            sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+            auto *cq = static_cast<char *>(cq_ring_);
+            cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+            cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+            cq_mask_ = *reinterpret_cast<unsigned *>(
+                cq + params.cq_off.ring_mask);
+            cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        }
+
+        auto map(std::size_t size, off_t offset) -> void * {
+            auto *p = ::mmap(nullptr,
+                             size,
+                             PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE,
+                             ring_fd_,
+                             offset);
+            if (p == MAP_FAILED) {
+                throw_errno("io_uring: mmap");
+            }
+            return p;
+        }
+
+        auto unmap_rings() -> void {
+            if (sqes_ != nullptr) {
+                ::munmap(sqes_, sqes_size_);
+            }
+            if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+                ::munmap(cq_ring_, cq_size_);
+            }
+            if (sq_ring_ != nullptr) {
+                ::munmap(sq_ring_, sq_size_);
+            }
+        }
+
+        auto push(std::size_t slot) -> void {
+            const auto &pending = slots_[slot];
+            auto        tail = load(sq_tail_, std::memory_order_relaxed);
+            auto        index = tail & sq_mask_;
+
+            auto &sqe = sqes_[index];
+            sqe = io_uring_sqe{};
+            sqe.opcode = registered_ ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+            sqe.fd = fd_;
+            sqe.addr = reinterpret_cast<std::uint64_t>(pending.data);
+            sqe.len = static_cast<unsigned>(pending.size);
+            sqe.off = pending.offset;
+            sqe.buf_index = static_cast<std::uint16_t>(slot);
+            sqe.user_data = slot;
+
+            sq_array_[index] = index;
+            store(sq_tail_, tail + 1, std::memory_order_release);
+            enter(1, 0, 0);
+        }
+
+        auto enter(unsigned to_submit, unsigned min_complete, unsigned flags)
+            -> void {
+            while (::syscall(__NR_io_uring_enter,
+                             ring_fd_,
+                             to_submit,
+                             min_complete,
+                             flags,
+                             nullptr,
+                             0)
+                   < 0) {
+                if (errno != EINTR) {
+                    throw_errno("io_uring_enter");
+                }
+            }
+        }
+
+        int                        fd_;
+        int                        ring_fd_{-1};
+        bool                       registered_{false};
+        std::uint64_t              file_offset_{0};
+        std::size_t                outstanding_{0};
+        std::vector<pending_write> slots_;
+
+        void         *sq_ring_{nullptr};
+        void         *cq_ring_{nullptr};
+        io_uring_sqe *sqes_{nullptr};
+        std::size_t   sq_size_{0};
+        std::size_t   cq_size_{0};
+        std::size_t   sqes_size_{0};
+        unsigned     *sq_tail_{nullptr};
+        unsigned     *sq_array_{nullptr};
+        unsigned      sq_mask_{0};
+        unsigned     *cq_head_{nullptr};
+        unsigned     *cq_tail_{nullptr};
+        io_uring_cqe *cqes_{nullptr};
+        unsigned      cq_mask_{0};
+    };
+#endif
+
+    struct aligned_buffer_deleter {
+        auto operator()(char *p) const -> void {
+            ::operator delete[](p, std::align_val_t{4096});
+        }
+    };
+
+} // namespace detail
+
+// Like record_writer, but the buffers are written asynchronously so packing
+// overlaps with disk I/O. Records are packed into one of `num_buffers`
+// buffers; a full buffer is submitted and packing continues in the next one.
+// When every buffer is still being written, write() blocks until one
+// completes and try_write() returns false (back-pressure).
+//
+// A failed write is reported by the call that collects it; from then on
+// every call that would submit or wait rethrows that first error.
+template <typename Fmt>
+class async_record_writer {
+public:
+    static constexpr std::size_t record_size = struct_pack::calcsize(Fmt{});
+    static constexpr std::size_t default_buffer_size = 1 << 20;
+
+    explicit async_record_writer(
+        int           fd,
+        std::size_t   buffer_size = default_buffer_size,
+        std::size_t   num_buffers = 2,
+        write_backend backend = write_backend::automatic)
+        : fd_{fd}
+        , capacity_{std::max(buffer_size, record_size)}
+        , num_buffers_{std::max<std::size_t>(num_buffers, 2)}
+        , storage_{static_cast<char *>(::operator new[](
+              capacity_ * num_buffers_, std::align_val_t{4096}))}
+        , sizes_(num_buffers_) {
+        for (std::size_t i = 1; i < num_buffers_; i++) {
+            free_.push_back(i);
+        }
+        make_backend(backend);
+    }
+
+    async_record_writer(const async_record_writer &) = delete;
+    auto operator=(const async_record_writer &)
+        -> async_record_writer & = delete;
+
+    ~async_record_writer() {
+        try {
+            if (!error_) {
+                drain();
+            }
+        } catch (const std::system_error &) {
+            // Nowhere to report it; call drain() explicitly to observe errors
+        }
+        abandon();
+    }
+
+    // Packs one record, blocking if every buffer is still being written
+    template <typename... Args>
+    auto write(Args &&...args) -> void {
+        if (sizes_[active_] + record_size > capacity_) {
+            rotate(true);
+        }
+        pack_record(std::forward<Args>(args)...);
+    }
+
+    // Like write(), but returns false instead of blocking
+    template <typename... Args>
+    auto try_write(Args &&...args) -> bool {
+        if (sizes_[active_] + record_size > capacity_ && !rotate(false)) {
+            return false;
+        }
+        pack_record(std::forward<Args>(args)...);
+        return true;
+    }
+
+    // Submits the partially filled buffer without waiting for it
+    auto flush() -> void {
+        rethrow_error();
+        if (sizes_[active_] != 0) {
+            rotate(true);
+        }
+    }
+
+    // flush() and wait until every submitted buffer has been written
+    auto drain() -> void {
+        STRUCT_PACK_TRACE_SPAN("async_record_writer::drain", "bulk");
+        flush();
+        while (in_flight() > 0) {
+            complete(*backend_->reap(true));
+        }
+    }
+
+    // drain() and wait for the data to reach the device
+    auto sync() -> void {
+        drain();
+        if (::fdatasync(fd_) != 0) {
+            detail::throw_errno("async_record_writer: fdatasync");
+        }
+    }
+
+    // Collects finished writes without blocking; returns how many were
+    // collected
+    auto poll() -> std::size_t {
+        rethrow_error();
+        std::size_t reaped = 0;
+        while (in_flight() > 0) {
+            auto done = backend_->reap(false);
+            if (!done) {
+                break;
+            }
+            complete(*done);
+            reaped++;
+        }
+        return reaped;
+    }
+
+    // Buffers submitted but not yet completed
+    auto in_flight() const -> std::size_t {
+        return num_buffers_ - 1 - free_.size();
+    }
+
+    auto records_written() const -> std::size_t {
+        return records_;
+    }
+
+    // Bytes whose write has completed
+    auto bytes_written() const -> std::size_t {
+        return bytes_;
+    }
+
+    auto backend() const -> write_backend {
+        return backend_kind_;
+    }
+
+private:
+    auto buffer(std::size_t slot) -> char * {
+        return storage_.get() + slot * capacity_;
+    }
+
+    template <typename... Args>
+    auto pack_record(Args &&...args) -> void {
+        sizes_[active_] += struct_pack::pack_into(
+            Fmt{},
+            buffer(active_) + sizes_[active_],
+            std::forward<Args>(args)...);
+        records_++;
+    }
+
+    // Submits the active buffer and switches to a free one
+    auto rotate(bool wait) -> bool {
+        rethrow_error();
+        if (free_.empty()) {
+            auto done = backend_->reap(wait);
+            if (!done) {
+                return false;
+            }
+            complete(*done);
+        }
+        backend_->submit(active_, buffer(active_), sizes_[active_]);
+        active_ = free_.front();
+        free_.pop_front();
+        return true;
+    }
+
+    // Returns the slot to the free list even when its write failed, so
+    // in_flight() keeps counting down
+    auto complete(detail::write_completion done) -> void {
+        if (done.error == 0) {
+            bytes_ += sizes_[done.slot];
+        } else if (!error_) {
+            error_ = std::error_code(done.error, std::generic_category());
+        }
+        sizes_[done.slot] = 0;
+        free_.push_back(done.slot);
+        rethrow_error();
+    }
+
+    auto rethrow_error() const -> void {
+        if (error_) {
+            throw std::system_error(error_, "async_record_writer: write");
+        }
+    }
+
+    // Submits nothing more and only waits for the writes already in flight,
+    // so none of them outlives its buffer
+    auto abandon() noexcept -> void {
+        try {
+            while (in_flight() > 0) {
+                free_.push_back(backend_->reap(true)->slot);
+            }
+        } catch (const std::system_error &) {
+            // The ring itself failed; nothing left to wait on
+        }
+    }
+
+    auto make_backend(write_backend backend) -> void {
+#if STRUCT_PACK_HAS_IO_URING
+        if (backend != write_backend::thread) {
+            try {
+                backend_ = std::make_unique<detail::uring_write_backend>(
+                    fd_, storage_.get(), capacity_, num_buffers_);
+                backend_kind_ = write_backend::io_uring;
+                return;
+            } catch (const std::system_error &) {
+                if (backend == write_backend::io_uring) {
+                    throw;
+                }
+            }
+        }
+#else
+        if (backend == write_backend::io_uring) {
+            throw std::system_error(
+                std::make_error_code(std::errc::not_supported),
+                "async_record_writer: io_uring");
+        }
+#endif
+        backend_ = std::make_unique<detail::thread_write_backend>(fd_);
+        backend_kind_ = write_backend::thread;
+    }
+
+    using buffer_ptr = std::unique_ptr<char[], detail::aligned_buffer_deleter>;
+
+    int                                          fd_;
+    std::size_t                                  capacity_;
+    std::size_t                                  num_buffers_;
+    buffer_ptr                                   storage_;
+    std::vector<std::size_t>                     sizes_;
+    std::deque<std::size_t>                      free_;
+    std::size_t                                  active_{0};
+    std::unique_ptr<detail::async_write_backend> backend_;
+    write_backend                                backend_kind_{};
+    std::size_t                                  records_{0};
+    std::size_t                                  bytes_{0};
+    std::error_code                              error_;
+};
+
+} // namespace struct_pack
@@ -0,0 +1,614 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <source_location>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "struct_pack/calcsize.hpp"
+#include "struct_pack/data_view.hpp"
+#include "struct_pack/log.hpp"
+#include "struct_pack/pack.hpp"
+#include "struct_pack/string_literal.hpp"
+#include "struct_pack/unpack.hpp"
+
+// Binary logging: the hot path packs the raw argument bytes next to a call
+// site id and a timestamp, and formatting happens later, on another thread
+// or in another process, with BinaryLogDecoder.
+//
+//     auto writer = print_hpp::log::BinaryLogWriter();
+//     BINARY_LOG(writer, INFO, "read {} bytes from {}", n, path);
+//     writer.flush(file);
+//
+// The stream is self-describing: the first record of every call site
+// carries its format string, location and argument types, so a log file
+// decodes on its own. Records, all little-endian:
+//
+//     site:    <IBIBI  size, kind = 0, site id, level, line,
+//                      then file, function, format and argument types,
+//                      each as <I length followed by the bytes
+//     message: <IBIq   size, kind = 1, site id, nanoseconds since the epoch,
+//                      then the arguments packed with the site's format
+//                      (strings as <I lengths), then the string bytes
+
+namespace print_hpp::log {
+
+namespace detail {
+    // Argument type codes: struct_pack format characters, plus 'S' for a
+    // string, which is packed as its 'I' length and stored after the record
+    template <typename T>
+    constexpr auto binary_type_code() -> char {
+        using U = std::remove_cvref_t<T>;
+        if constexpr (std::is_convertible_v<const U &, std::string_view>) {
+            return 'S';
+        } else if constexpr (std::is_same_v<U, bool>) {
+            return '?';
+        } else if constexpr (std::is_same_v<U, char>) {
+            return 'c';
+        } else if constexpr (std::is_same_v<U, float>) {
+            return 'f';
+        } else if constexpr (std::is_same_v<U, double>) {
+            return 'd';
+        } else if constexpr (std::is_integral_v<U>) {
+            constexpr bool is_signed = std::is_signed_v<U>;
+            if constexpr (sizeof(U) == 1) {
+                return is_signed ? 'b' : 'B';
+            } else if constexpr (sizeof(U) == 2) {
+                return is_signed ? 'h' : 'H';
+            } else if constexpr (sizeof(U) == 4) {
+                return is_signed ? 'i' : 'I';
+            } else {
+                static_assert(sizeof(U) == 8);
+                return is_signed ? 'q' : 'Q';
+            }
+        } else {
+            static_assert(!sizeof(U),
+                          "Binary logging takes arithmetic and string "
+                          "arguments only");
+        }
+    }
+
+    template <typename... Args>
+    struct BinaryArgs {
+        static constexpr char types[]
+            = {binary_type_code<Args>()..., '\0'};
+        static constexpr char format_chars[]
+            = {'<', (binary_type_code<Args>() == 'S'
+                         ? 'I'
+                         : binary_type_code<Args>())...,
+               '\0'};
+        // struct_pack format of the fixed-size part
+        using format = type_string<string_container<sizeof(format_chars)>(
+            format_chars)>;
+        static constexpr std::size_t size = [] {
+            if constexpr (sizeof...(Args) == 0) {
+                return std::size_t{0}; // calcsize needs at least one item
+            } else {
+                return struct_pack::calcsize(format{});
+            }
+        }();
+    };
+
+    template <typename T>
+    auto binary_fixed_value(const T &arg) {
+        if constexpr (binary_type_code<T>() == 'S') {
+            return static_cast<std::uint32_t>(std::string_view(arg).size());
+        } else {
+            return arg;
+        }
+    }
+
+    template <typename T>
+    auto binary_string_size(const T &arg) -> std::size_t {
+        if constexpr (binary_type_code<T>() == 'S') {
+            return std::string_view(arg).size();
+        } else {
+            return 0;
+        }
+    }
+
+    template <typename T>
+    auto binary_copy_string(char *&out, const T &arg) {
+        if constexpr (binary_type_code<T>() == 'S') {
+            auto s = std::string_view(arg);
+            std::memcpy(out, s.data(), s.size());
+            out += s.size();
+        }
+    }
+
+    constexpr auto binary_header = "<IB"_fmt;
+    constexpr auto binary_site_header = "<IBIBI"_fmt;
+    constexpr auto binary_message_header = "<IBIq"_fmt;
+    constexpr auto binary_length = "<I"_fmt;
+    constexpr std::uint8_t binary_site_kind = 0;
+    constexpr std::uint8_t binary_message_kind = 1;
+} // namespace detail
+
+// Everything about a call site except its arguments
+struct BinarySite {
+    std::uint32_t       id;
+    LogLevel            level;
+    std::string_view    file;
+    std::uint_least32_t line;
+    std::string_view    function;
+    std::string_view    fmt;
+    std::string_view    types;
+};
+
+// Process-wide table of call sites; ids are dense and never reused
+class BinarySiteRegistry {
+public:
+    static auto instance() -> BinarySiteRegistry & {
+        static BinarySiteRegistry registry;
+        return registry;
+    }
+
+    // `fmt` must be a string literal: it is referenced, not copied
+    template <LogLevel Level, typename... Args>
+    auto add(std::string_view fmt, std::source_location location)
+        -> const BinarySite & {
+        auto lock = std::lock_guard{mutex_};
+        return sites_.emplace_back(
+            BinarySite{static_cast<std::uint32_t>(sites_.size()),
+                       Level,
+                       location.file_name(),
+                       location.line(),
+                       location.function_name(),
+                       fmt,
+                       detail::BinaryArgs<Args...>::types});
+    }
+
+private:
+    std::mutex             mutex_;
+    std::deque<BinarySite> sites_;
+};
+
+// Appends binary log records to a growing buffer. Not thread-safe: use one
+// writer per thread and hand the bytes elsewhere with flush() or data().
+class BinaryLogWriter {
+public:
+    explicit BinaryLogWriter(std::size_t initial_capacity = 1 << 16)
+        : capacity_{std::max<std::size_t>(initial_capacity, 64)}
+        , buffer_{std::make_unique<char[]>(capacity_)} {}
+
+    // Packs one message; the site's own record is written first if this
+    // stream has not seen the site yet
+    template <typename... Args>
+    void write(const BinarySite &site, const Args &...args) {
+        if (site.level < level_) {
+            return;
+        }
+        if (site.id >= emitted_.size() || !emitted_[site.id]) {
+            write_site(site);
+        }
+
+        using Packed = detail::BinaryArgs<Args...>;
+        auto record_size
+            = struct_pack::calcsize(detail::binary_message_header)
+              + Packed::size
+              + (std::size_t{0} + ... + detail::binary_string_size(args));
+        char *out = reserve(record_size);
+        auto  now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+        out += struct_pack::pack_into(detail::binary_message_header,
+                                      out,
+                                      static_cast<std::uint32_t>(record_size),
+                                      detail::binary_message_kind,
+                                      site.id,
+                                      static_cast<std::int64_t>(now));
+        if constexpr (sizeof...(Args) > 0) {
+            out += struct_pack::pack_into(typename Packed::format{},
+                                          out,
+                                          detail::binary_fixed_value(args)...);
+        }
+        (detail::binary_copy_string(out, args), ...);
+        size_ += record_size;
+    }
+
+    auto set_level(LogLevel level) {
+        level_ = level;
+    }
+
+    auto level() const -> LogLevel {
+        return level_;
+    }
+
+    template <LogLevel Level>
+    auto enabled() const -> bool {
+        if constexpr (Level < min_level) {
+            return false;
+        } else {
+            return Level >= level_;
+        }
+    }
+
+    auto data() const -> const char * {
+        return buffer_.get();
+    }
+
+    auto size() const -> std::size_t {
+        return size_;
+    }
+
+    // Drops the buffered bytes, which are assumed to have been consumed as
+    // part of the same stream
+    void clear() {
+        size_ = 0;
+    }
+
+    // Drops the buffered bytes and starts a new stream, which describes
+    // every call site again
+    void restart() {
+        size_ = 0;
+        emitted_.clear();
+    }
+
+    // Writes the buffered bytes to `out` and clears them
+    void flush(std::ostream &out) {
+        out.write(buffer_.get(), static_cast<std::streamsize>(size_));
+        clear();
+    }
+
+    void flush(LogSink &sink) {
+        sink.write(std::string_view(buffer_.get(), size_));
+        clear();
+    }
+
+private:
+    auto reserve(std::size_t record_size) -> char * {
+        if (size_ + record_size > capacity_) {
+            auto capacity = std::max(capacity_ * 2, size_ + record_size);
+            auto buffer = std::make_unique<char[]>(capacity);
+            std::memcpy(buffer.get(), buffer_.get(), size_);
+            buffer_ = std::move(buffer);
+            capacity_ = capacity;
+        }
+        return buffer_.get() + size_;
+    }
+
+    void write_site(const BinarySite &site) {
+        std::string_view strings[]
+            = {site.file, site.function, site.fmt, site.types};
+        auto record_size = struct_pack::calcsize(detail::binary_site_header);
+        for (auto s : strings) {
+            record_size
+                += struct_pack::calcsize(detail::binary_length) + s.size();
+        }
+
+        char *out = reserve(record_size);
+        out += struct_pack::pack_into(detail::binary_site_header,
+                                      out,
+                                      static_cast<std::uint32_t>(record_size),
+                                      detail::binary_site_kind,
+                                      site.id,
+                                      static_cast<std::uint8_t>(site.level),
+                                      static_cast<std::uint32_t>(site.line));
+        for (auto s : strings) {
+            out += struct_pack::pack_into(detail::binary_length,
+                                          out,
+                                          static_cast<std::uint32_t>(s.size()));
+            std::memcpy(out, s.data(), s.size());
+            out += s.size();
+        }
+        size_ += record_size;
+
+        if (site.id >= emitted_.size()) {
+            emitted_.resize(site.id + 1);
+        }
+        emitted_[site.id] = true;
+    }
+
+    std::size_t             capacity_;
+    std::unique_ptr<char[]> buffer_;
+    std::size_t             size_{0};
+    std::vector<bool>       emitted_;
+    LogLevel                level_{LogLevel::DEBUG};
+};
+
+// Turns a binary log back into the text ConsoleLogger would have printed.
+// Input may arrive in arbitrary chunks; incomplete records are kept until
+// the rest shows up.
+class BinaryLogDecoder {
+public:
+    // Decodes every record completed by `chunk`, appending the text to `out`;
+    // returns the number of messages
+    auto decode(std::string_view chunk, std::string &out) -> std::size_t {
+        pending_.append(chunk);
+        constexpr auto header_size
+            = struct_pack::calcsize(detail::binary_header);
+        auto        input = std::string_view(pending_);
+        std::size_t messages = 0;
+        while (input.size() >= header_size) {
+            auto [size, kind]
+                = struct_pack::unpack(detail::binary_header, input);
+            if (size < header_size) {
+                throw std::runtime_error("BinaryLogDecoder: corrupt record");
+            }
+            if (input.size() < size) {
+                break;
+            }
+            auto record = input.substr(0, size);
+            if (kind == detail::binary_site_kind) {
+                read_site(record);
+            } else if (kind == detail::binary_message_kind) {
+                read_message(record, out);
+                messages++;
+            } else {
+                throw std::runtime_error("BinaryLogDecoder: unknown record");
+            }
+            input.remove_prefix(size);
+        }
+        pending_.erase(0, pending_.size() - input.size());
+        return messages;
+    }
+
+    auto decode(std::string_view chunk) -> std::string {
+        std::string out;
+        decode(chunk, out);
+        return out;
+    }
+
+    auto set_style(LogStyle style) {
+        style_ = style;
+    }
+
+private:
+    struct Site {
+        LogLevel            level;
+        std::uint_least32_t line;
+        std::string         file;
+        std::string         function;
+        std::string         fmt;
+        std::string         types;
+    };
+
+    using Value = std::variant<bool,
+                               char,
+                               std::int8_t,
+                               std::uint8_t,
+                               std::int16_t,
+                               std::uint16_t,
+                               std::int32_t,
+                               std::uint32_t,
+                               std::int64_t,
+                               std::uint64_t,
+                               float,
+                               double,
+                               std::string_view>;
+
+    static auto take_string(std::string_view &record) -> std::string {
+        constexpr auto length_size
+            = struct_pack::calcsize(detail::binary_length);
+        auto [length] = struct_pack::unpack(detail::binary_length,
+                                            check(record, length_size));
+        record.remove_prefix(length_size);
+        auto s = check(record, length);
+        record.remove_prefix(length);
+        return std::string(s.substr(0, length));
+    }
+
+    static auto check(std::string_view record, std::size_t size)
+        -> std::string_view {
+        if (record.size() < size) {
+            throw std::runtime_error("BinaryLogDecoder: truncated record");
+        }
+        return record;
+    }
+
+    void read_site(std::string_view record) {
+        constexpr auto header_size
+            = struct_pack::calcsize(detail::binary_site_header);
+        auto [size, kind, id, level, line] = struct_pack::unpack(
+            detail::binary_site_header, check(record, header_size));
+        record.remove_prefix(header_size);
+        auto file = take_string(record);
+        auto function = take_string(record);
+        auto fmt = take_string(record);
+        auto types = take_string(record);
+        // Keyed by id: a stream only defines the sites it uses, so ids are
+        // sparse and come straight from the input
+        sites_[id] = Site{static_cast<LogLevel>(level),
+                          line,
+                          std::move(file),
+                          std::move(function),
+                          std::move(fmt),
+                          std::move(types)};
+    }
+
+    // Reads the fixed part with data_view, the runtime counterpart of the
+    // packing done by BinaryLogWriter
+    template <typename T>
+    static auto get(const char *p) -> T {
+        auto view = struct_pack::data_view<const char>(p, false);
+        return static_cast<T>(struct_pack::data::get<T>(view));
+    }
+
+    static auto read_value(char type, const char *p) -> Value {
+        switch (type) {
+        case '?':
+            return get<bool>(p);
+        case 'c':
+            return get<char>(p);
+        case 'b':
+            return get<std::int8_t>(p);
+        case 'B':
+            return get<std::uint8_t>(p);
+        case 'h':
+            return get<std::int16_t>(p);
+        case 'H':
+            return get<std::uint16_t>(p);
+        case 'i':
+            return get<std::int32_t>(p);
+        case 'I':
+        case 'S':
+            return get<std::uint32_t>(p);
+        case 'q':
+            return get<std::int64_t>(p);
+        case 'Q':
+            return get<std::uint64_t>(p);
+        case 'f':
+            return get<float>(p);
+        case 'd':
+            return get<double>(p);
+        default:
+            throw std::runtime_error("BinaryLogDecoder: unknown type");
+        }
+    }
+
+    static constexpr auto type_size(char type) -> std::size_t {
+        switch (type) {
+        case 'h':
+        case 'H':
+            return 2;
+        case 'i':
+        case 'I':
+        case 'S':
+        case 'f':
+            return 4;
+        case 'q':
+        case 'Q':
+        case 'd':
+            return 8;
+        default:
+            return 1;
+        }
+    }
+
+    // Formats one value with the replacement field `spec` (":x", "" ...)
+    static auto format_value(const Value &value, std::string_view spec)
+        -> std::string {
+        auto fmt = std::string("{") + std::string(spec) + "}";
+        return std::visit(
+            [&](const auto &v) {
+                return std::vformat(fmt, std::make_format_args(v));
+            },
+            value);
+    }
+
+    // std::vformat over the decoded values, one replacement field at a time
+    static auto format_message(std::string_view          fmt,
+                               const std::vector<Value> &values)
+        -> std::string {
+        std::string out;
+        std::size_t next = 0;
+        for (std::size_t i = 0; i < fmt.size(); i++) {
+            if ((fmt[i] == '{' || fmt[i] == '}') && i + 1 < fmt.size()
+                && fmt[i + 1] == fmt[i]) {
+                out += fmt[i++];
+                continue;
+            }
+            if (fmt[i] != '{') {
+                out += fmt[i];
+                continue;
+            }
+            auto end = fmt.find('}', i);
+            if (end == std::string_view::npos) {
+                throw std::format_error("unterminated replacement field");
+            }
+            auto field = fmt.substr(i + 1, end - i - 1);
+            auto colon = std::min(field.find(':'), field.size());
+            auto index = next++;
+            if (colon > 0) {
+                index = 0;
+                for (char ch : field.substr(0, colon)) {
+                    index = index * 10 + static_cast<std::size_t>(ch - '0');
+                }
+            }
+            if (index >= values.size()) {
+                throw std::format_error("argument index out of range");
+            }
+            out += format_value(values[index], field.substr(colon));
+            i = end;
+        }
+        return out;
+    }
+
+    void read_message(std::string_view record, std::string &out) {
+        constexpr auto header_size
+            = struct_pack::calcsize(detail::binary_message_header);
+        auto [size, kind, id, nanoseconds] = struct_pack::unpack(
+            detail::binary_message_header, check(record, header_size));
+        auto found = sites_.find(id);
+        if (found == sites_.end()) {
+            throw std::runtime_error("BinaryLogDecoder: unknown call site");
+        }
+        const auto &site = found->second;
+        record.remove_prefix(header_size);
+
+        std::vector<Value> values;
+        std::size_t        fixed_size = 0;
+        for (char type : site.types) {
+            fixed_size += type_size(type);
+        }
+        auto strings = check(record, fixed_size).substr(fixed_size);
+        for (char type : site.types) {
+            auto value = read_value(type, record.data());
+            record.remove_prefix(type_size(type));
+            if (type == 'S') {
+                auto length = std::get<std::uint32_t>(value);
+                value = check(strings, length).substr(0, length);
+                strings.remove_prefix(length);
+            }
+            values.push_back(value);
+        }
+
+        std::string message;
+        try {
+            message = format_message(site.fmt, values);
+        } catch (const std::format_error &e) {
+            message = std::format("<format error: {}>", e.what());
+        }
+        auto time = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds(nanoseconds)));
+        out += detail::format_line(site.level,
+                                   time,
+                                   style_,
+                                   site.file,
+                                   site.line,
+                                   site.function,
+                                   message);
+    }
+
+    std::string                             pending_;
+    std::unordered_map<std::uint32_t, Site> sites_;
+    LogStyle                                style_{LogStyle::FG};
+};
+
+} // namespace print_hpp::log
+
+// Logs through a BinaryLogWriter; `level` is a LogLevel name and the format
+// must be a string literal. Arguments are not evaluated for disabled levels.
+#define BINARY_LOG(writer, level, ...)                                         \
+    (!(writer).template enabled<::print_hpp::log::LogLevel::level>()           \
+         ? (void) (0)                                                          \
+         : BINARY_LOG_WRITE(writer, level, __VA_ARGS__))
+#define BINARY_LOG_WRITE(writer, level, ...)                                   \
+    [&, binary_log_location = std::source_location::current()](               \
+        const auto &binary_log_fmt, const auto &...binary_log_args) {          \
+        static_assert(std::is_array_v<                                         \
+                          std::remove_cvref_t<decltype(binary_log_fmt)>>,     \
+                      "BINARY_LOG takes a string literal format");             \
+        static const auto &binary_log_site                                     \
+            = ::print_hpp::log::BinarySiteRegistry::instance()                 \
+                  .add<::print_hpp::log::LogLevel::level,                      \
+                       std::remove_cvref_t<decltype(binary_log_args)>...>(     \
+                      binary_log_fmt, binary_log_location);                    \
+        (writer).write(binary_log_site, binary_log_args...);                   \
+    }(__VA_ARGS__)
@@ -0,0 +1,459 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "struct_pack/calcsize.hpp"
+#include "struct_pack/fd_io.hpp"
+#include "struct_pack/pack.hpp"
+#include "struct_pack/record_view.hpp"
+#include "struct_pack/string_literal.hpp"
+#include "struct_pack/unpack.hpp"
+
+// A self-describing file of records of one format, grouped into blocks:
+//
+//     file header:  <8sHHIH  magic "SPBLOCK1", version, format length,
+//                            record size, zone map count,
+//                            then the format string and the zone mapped
+//                            item indices, one <H each
+//     block:        <II      magic, record count,
+//                            then a <16s min/max pair per zone map,
+//                            then the packed records
+//
+// Zone map values are 8 bytes: <q for signed integers, <Q for unsigned ones
+// and bools, <d for floating point items.
+
+namespace struct_pack {
+
+namespace detail {
+    constexpr auto block_file_header = "<8sHHIH"_fmt;
+    constexpr auto block_header = "<II"_fmt;
+    constexpr auto block_file_magic = std::string_view("SPBLOCK1");
+    constexpr std::uint32_t block_magic = 0x4b4c4253;
+    constexpr std::uint16_t block_file_version = 1;
+    constexpr std::size_t   zone_size = 16;
+    constexpr std::size_t   block_header_size
+        = struct_pack::calcsize(block_header);
+
+    // How an item's min/max are kept in a zone map
+    template <typename Fmt, std::size_t Item>
+    struct zone_traits {
+        static constexpr auto format_char
+            = struct_pack::getTypeOfItem<Item>(Fmt{}).formatChar;
+        using item_type
+            = struct_pack::RepresentedType<decltype(struct_pack::getFormatMode(
+                                               Fmt{})),
+                                           format_char>;
+
+        static_assert(std::is_arithmetic_v<item_type>
+                          && format_char != 'c' && format_char != 'x',
+                      "Zone maps are for numeric items");
+
+        using value_type = std::conditional_t<
+            std::is_floating_point_v<item_type>,
+            double,
+            std::conditional_t<std::is_signed_v<item_type>,
+                               std::int64_t,
+                               std::uint64_t>>;
+
+        static auto store(char *out, value_type min, value_type max) -> void {
+            if constexpr (std::is_same_v<value_type, double>) {
+                struct_pack::pack_into("<dd"_fmt, out, min, max);
+            } else if constexpr (std::is_same_v<value_type, std::int64_t>) {
+                struct_pack::pack_into("<qq"_fmt, out, min, max);
+            } else {
+                struct_pack::pack_into("<QQ"_fmt, out, min, max);
+            }
+        }
+
+        static auto load(const char *in) -> std::pair<value_type, value_type> {
+            auto bytes = std::string_view(in, zone_size);
+            auto [min, max] = [&] {
+                if constexpr (std::is_same_v<value_type, double>) {
+                    return struct_pack::unpack("<dd"_fmt, bytes);
+                } else if constexpr (std::is_same_v<value_type,
+                                                    std::int64_t>) {
+                    return struct_pack::unpack("<qq"_fmt, bytes);
+                } else {
+                    return struct_pack::unpack("<QQ"_fmt, bytes);
+                }
+            }();
+            return {static_cast<value_type>(min),
+                    static_cast<value_type>(max)};
+        }
+
+        // [min, max] as zone values, clamped to the zone type so that mixed
+        // signs don't wrap; nullopt when no value of the item can match
+        template <typename T>
+        static auto bounds(T min, T max)
+            -> std::optional<std::pair<value_type, value_type>> {
+            static_assert(std::is_arithmetic_v<T>, "Bounds must be numbers");
+            static_assert(std::is_floating_point_v<value_type>
+                              || !std::is_floating_point_v<T>,
+                          "An integer item needs integer bounds");
+            if constexpr (std::is_integral_v<value_type>) {
+                constexpr auto lowest = std::numeric_limits<value_type>::min();
+                constexpr auto highest = std::numeric_limits<value_type>::max();
+                if (std::cmp_greater(min, max) || std::cmp_less(max, lowest)
+                    || std::cmp_greater(min, highest)) {
+                    return std::nullopt;
+                }
+                return std::pair{
+                    std::cmp_less(min, lowest) ? lowest
+                                               : static_cast<value_type>(min),
+                    std::cmp_greater(max, highest)
+                        ? highest
+                        : static_cast<value_type>(max)};
+            } else {
+                return std::pair{static_cast<value_type>(min),
+                                 static_cast<value_type>(max)};
+            }
+        }
+    };
+
+    inline void pread_all(int         fd,
+                          char       *data,
+                          std::size_t size,
+                          std::size_t offset) {
+        while (size > 0) {
+            auto n = ::pread(fd, data, size, static_cast<off_t>(offset));
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw_errno("block_file_reader: pread");
+            }
+            if (n == 0) {
+                throw_invalid("block_file_reader: truncated file");
+            }
+            data += n;
+            size -= static_cast<std::size_t>(n);
+            offset += static_cast<std::size_t>(n);
+        }
+    }
+} // namespace detail
+
+// Writes a block file to a borrowed file descriptor. Records are buffered
+// into blocks of `block_records`; each block starts with the min and max
+// of every item listed in ZoneItems, which lets block_file_reader skip it.
+//
+//     using Tick = decltype("<qId"_fmt); // time, id, price
+//     auto writer = struct_pack::block_file_writer<Tick, 0>(fd);
+//     writer.write(time, id, price);
+//     writer.flush();
+template <typename Fmt, std::size_t... ZoneItems>
+class block_file_writer {
+public:
+    static constexpr std::size_t record_size = struct_pack::calcsize(Fmt{});
+    static constexpr std::size_t zone_count = sizeof...(ZoneItems);
+    static constexpr std::size_t header_size
+        = detail::block_header_size + zone_count * detail::zone_size;
+
+    static_assert(Fmt::size() <= std::numeric_limits<std::uint16_t>::max());
+
+    // Writes the file header at once
+    explicit block_file_writer(int fd, std::size_t block_records = 4096)
+        : fd_{fd}
+        , block_records_{std::max<std::size_t>(block_records, 1)}
+        , buffer_{std::make_unique<char[]>(header_size
+                                           + block_records_ * record_size)} {
+        std::vector<char> header(
+            struct_pack::calcsize(detail::block_file_header));
+        struct_pack::pack_into(detail::block_file_header,
+                               header.data(),
+                               detail::block_file_magic,
+                               detail::block_file_version,
+                               static_cast<std::uint16_t>(Fmt::size()),
+                               static_cast<std::uint32_t>(record_size),
+                               static_cast<std::uint16_t>(zone_count));
+        header.insert(header.end(), Fmt::value(), Fmt::value() + Fmt::size());
+        for (auto item : {static_cast<std::uint16_t>(ZoneItems)...}) {
+            auto index = struct_pack::pack("<H"_fmt, item);
+            header.insert(header.end(), index.begin(), index.end());
+        }
+        detail::write_all(
+            fd_, header.data(), header.size(), "block_file_writer: write");
+        reset_zones();
+    }
+
+    block_file_writer(const block_file_writer &) = delete;
+    auto operator=(const block_file_writer &) -> block_file_writer & = delete;
+
+    ~block_file_writer() {
+        try {
+            flush();
+        } catch (const std::system_error &) {
+            // Nowhere to report it; call flush() explicitly to observe errors
+        }
+    }
+
+    template <typename... Args>
+    auto write(Args &&...args) -> void {
+        auto *record = buffer_.get() + header_size + count_ * record_size;
+        struct_pack::pack_into(Fmt{}, record, std::forward<Args>(args)...);
+        update_zones(record_view<Fmt>(record));
+        if (++count_ == block_records_) {
+            flush();
+        }
+    }
+
+    // Writes the buffered records as a (possibly short) block
+    auto flush() -> void {
+        if (count_ == 0) {
+            return;
+        }
+        struct_pack::pack_into(detail::block_header,
+                               buffer_.get(),
+                               detail::block_magic,
+                               static_cast<std::uint32_t>(count_));
+        store_zones(std::make_index_sequence<zone_count>());
+        auto size = header_size + count_ * record_size;
+        count_ = 0;
+        reset_zones();
+        detail::write_all(fd_, buffer_.get(), size, "block_file_writer: write");
+        blocks_++;
+    }
+
+    auto blocks_written() const -> std::size_t {
+        return blocks_;
+    }
+
+private:
+    template <std::size_t Item>
+    using zone = detail::zone_traits<Fmt, Item>;
+
+    auto reset_zones() -> void {
+        zones_ = {std::pair{
+            std::numeric_limits<typename zone<ZoneItems>::value_type>::max(),
+            std::numeric_limits<
+                typename zone<ZoneItems>::value_type>::lowest()}...};
+    }
+
+    auto update_zones(record_view<Fmt> record) -> void {
+        update_zones(record, std::make_index_sequence<zone_count>());
+    }
+
+    template <std::size_t... Zones>
+    auto update_zones(record_view<Fmt> record, std::index_sequence<Zones...>)
+        -> void {
+        (update_zone<Zones, ZoneItems>(record), ...);
+    }
+
+    template <std::size_t Zone, std::size_t Item>
+    auto update_zone(record_view<Fmt> record) -> void {
+        auto value = static_cast<typename zone<Item>::value_type>(
+            record.template get<Item>());
+        auto &[min, max] = std::get<Zone>(zones_);
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+
+    template <std::size_t... Zones>
+    auto store_zones(std::index_sequence<Zones...>) -> void {
+        auto *out = buffer_.get() + detail::block_header_size;
+        (zone<ZoneItems>::store(out + Zones * detail::zone_size,
+                                std::get<Zones>(zones_).first,
+                                std::get<Zones>(zones_).second),
+         ...);
+    }
+
+    int                     fd_;
+    std::size_t             block_records_;
+    std::unique_ptr<char[]> buffer_;
+    std::size_t             count_{0};
+    std::size_t             blocks_{0};
+    std::tuple<std::pair<typename zone<ZoneItems>::value_type,
+                         typename zone<ZoneItems>::value_type>...>
+        zones_;
+};
+
+// Reads a block file whose format must be Fmt; the file header is checked
+// when the reader is made. Range scans only read the blocks whose zone map
+// overlaps the range.
+template <typename Fmt>
+class block_file_reader {
+public:
+    static constexpr std::size_t record_size = struct_pack::calcsize(Fmt{});
+
+    struct block {
+        std::size_t   offset; // of the records
+        std::uint32_t records;
+        std::size_t   zones; // offset of the zone maps in zone_data_
+    };
+
+    // Reads the file header and every block header; a block cut short at
+    // the end of the file is ignored. Throws std::system_error with
+    // errc::invalid_argument if this is not a block file of Fmt.
+    explicit block_file_reader(int fd)
+        : fd_{fd} {
+        struct stat st {};
+        if (::fstat(fd_, &st) != 0) {
+            detail::throw_errno("block_file_reader: fstat");
+        }
+        auto file_size = static_cast<std::size_t>(st.st_size);
+
+        auto fixed = std::array<char, struct_pack::calcsize(
+                                          detail::block_file_header)>{};
+        if (file_size < fixed.size()) {
+            detail::throw_invalid("block_file_reader: not a block file");
+        }
+        detail::pread_all(fd_, fixed.data(), fixed.size(), 0);
+        auto [magic, version, format_size, size, zone_count]
+            = struct_pack::unpack(detail::block_file_header, fixed);
+        if (magic != detail::block_file_magic
+            || version != detail::block_file_version) {
+            detail::throw_invalid("block_file_reader: not a block file");
+        }
+
+        auto header_size = fixed.size() + format_size + 2 * zone_count;
+        auto rest = std::vector<char>(header_size - fixed.size());
+        detail::pread_all(fd_, rest.data(), rest.size(), fixed.size());
+        auto format = std::string_view(rest.data(), format_size);
+        if (size != record_size
+            || format != std::string_view(Fmt::value(), Fmt::size())) {
+            detail::throw_invalid("block_file_reader: format mismatch");
+        }
+        for (std::size_t i = 0; i < zone_count; i++) {
+            auto [item] = struct_pack::unpack(
+                "<H"_fmt,
+                std::string_view(rest.data() + format_size + 2 * i, 2));
+            zone_items_.push_back(item);
+        }
+
+        auto header = std::vector<char>(detail::block_header_size
+                                        + zone_count * detail::zone_size);
+        for (auto offset = header_size; offset + header.size() <= file_size;) {
+            detail::pread_all(fd_, header.data(), header.size(), offset);
+            auto [block_magic, records] = struct_pack::unpack(
+                detail::block_header,
+                std::string_view(header.data(), detail::block_header_size));
+            if (block_magic != detail::block_magic) {
+                detail::throw_invalid(
+                    "block_file_reader: corrupt block header");
+            }
+            auto end = offset + header.size() + records * record_size;
+            if (end > file_size) {
+                break;
+            }
+            blocks_.push_back(
+                {offset + header.size(), records, zone_data_.size()});
+            zone_data_.insert(zone_data_.end(),
+                              header.begin() + detail::block_header_size,
+                              header.end());
+            offset = end;
+        }
+    }
+
+    auto blocks() const -> const std::vector<block> & {
+        return blocks_;
+    }
+
+    auto records() const -> std::size_t {
+        std::size_t total = 0;
+        for (const auto &b : blocks_) {
+            total += b.records;
+        }
+        return total;
+    }
+
+    // Whether the file keeps a zone map for `item`
+    auto has_zone_map(std::size_t item) const -> bool {
+        return std::find(zone_items_.begin(), zone_items_.end(), item)
+               != zone_items_.end();
+    }
+
+    // Calls `on_record` with a record_view of every record
+    template <typename F>
+    auto for_each(F &&on_record) -> std::size_t {
+        std::size_t total = 0;
+        for (const auto &b : blocks_) {
+            total += read_block(b, on_record);
+        }
+        return total;
+    }
+
+    // Calls `on_record` for every record whose item Item lies in
+    // [min, max], reading only blocks whose zone map overlaps that range
+    // (every block, if the file has no zone map for Item)
+    template <std::size_t Item, typename T, typename F>
+    auto scan_range(T min, T max, F &&on_record) -> std::size_t {
+        using zone = detail::zone_traits<Fmt, Item>;
+        auto range = zone::bounds(min, max);
+        if (!range) {
+            return 0;
+        }
+        auto [lo, hi] = *range;
+        auto position = std::find(zone_items_.begin(), zone_items_.end(), Item)
+                        - zone_items_.begin();
+
+        std::size_t matched = 0;
+        for (const auto &b : blocks_) {
+            if (static_cast<std::size_t>(position) < zone_items_.size()) {
+                auto [block_min, block_max] = zone::load(
+                    zone_data_.data() + b.zones
+                    + static_cast<std::size_t>(position) * detail::zone_size);
+                if (block_max < lo || block_min > hi) {
+                    blocks_skipped_++;
+                    continue;
+                }
+            }
+            read_block(b, [&](record_view<Fmt> record) {
+                auto value = static_cast<typename zone::value_type>(
+                    record.template get<Item>());
+                if (lo <= value && value <= hi) {
+                    on_record(record);
+                    matched++;
+                }
+            });
+        }
+        return matched;
+    }
+
+    // Blocks read and skipped so far, to see what zone maps saved
+    auto blocks_read() const -> std::size_t {
+        return blocks_read_;
+    }
+
+    auto blocks_skipped() const -> std::size_t {
+        return blocks_skipped_;
+    }
+
+private:
+    template <typename F>
+    auto read_block(const block &b, F &&on_record) -> std::size_t {
+        auto size = b.records * record_size;
+        if (buffer_.size() < size) {
+            buffer_.resize(size);
+        }
+        detail::pread_all(fd_, buffer_.data(), size, b.offset);
+        blocks_read_++;
+        for (std::size_t i = 0; i < b.records; i++) {
+            on_record(record_view<Fmt>(buffer_.data() + i * record_size));
+        }
+        return b.records;
+    }
+
+    int                        fd_;
+    std::vector<std::uint16_t> zone_items_;
+    std::vector<block>         blocks_;
+    std::vector<char>          zone_data_;
+    std::vector<char>          buffer_;
+    std::size_t                blocks_read_{0};
+    std::size_t                blocks_skipped_{0};
+};
+
+} // namespace struct_pack
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <string_view>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define STRUCT_PACK_HAS_SSE42_CRC 1
+#else
+#define STRUCT_PACK_HAS_SSE42_CRC 0
+#endif
+
+#include "struct_pack/calcsize.hpp"
+#include "struct_pack/data_view.hpp"
+#include "struct_pack/pack.hpp"
+#include "struct_pack/unpack.hpp"
+
+namespace struct_pack {
+
+namespace detail {
+    constexpr auto crc32c_table = [] {
+        std::array<std::uint32_t, 256> table{};
+        for (std::uint32_t i = 0; i < 256; i++) {
+            auto crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ ((crc & 1) != 0 ? 0x82F63B78U : 0);
+            }
+            table[i] = crc;
+        }
+        return table;
+    }();
+
+    constexpr auto
+    crc32c_portable(const char *data, std::size_t size, std::uint32_t crc)
+        -> std::uint32_t {
+        for (std::size_t i = 0; i < size; i++) {
+            crc = crc32c_table[(crc ^ static_cast<std::uint8_t>(data[i]))
+                               & 0xFF]
+                  ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+#if STRUCT_PACK_HAS_SSE42_CRC
+    __attribute__((target("sse4.2"))) inline auto
+    crc32c_sse42(const char *data, std::size_t size, std::uint32_t crc)
+        -> std::uint32_t {
+        std::uint64_t crc64 = crc;
+        for (; size >= 8; size -= 8, data += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, data, 8);
+            crc64 = _mm_crc32_u64(crc64, word);
+        }
+        crc = static_cast<std::uint32_t>(crc64);
+        for (; size > 0; size--, data++) {
+            crc = _mm_crc32_u8(crc, static_cast<std::uint8_t>(*data));
+        }
+        return crc;
+    }
+
+    inline auto has_sse42() -> bool {
+#if defined(__SSE4_2__)
+        return true;
+#else
+        static const bool supported = __builtin_cpu_supports("sse4.2");
+        return supported;
+#endif
+    }
+#endif
+
+    constexpr auto rotl64(std::uint64_t x, int r) -> std::uint64_t {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    constexpr auto read64(const char *p) -> std::uint64_t {
+        auto view = data_view<const char>(p, false);
+        return data::get<std::uint64_t>(view);
+    }
+
+    constexpr auto read32(const char *p) -> std::uint32_t {
+        auto view = data_view<const char>(p, false);
+        return data::get<std::uint32_t>(view);
+    }
+} // namespace detail
+
+// CRC-32C (Castagnoli), using the SSE4.2 crc32 instruction when the CPU has
+// it and a lookup table otherwise
+struct crc32c {
+    using value_type = std::uint32_t;
+
+    static auto compute(const char *data, std::size_t size) -> value_type {
+#if STRUCT_PACK_HAS_SSE42_CRC
+        if (detail::has_sse42()) {
+            return ~detail::crc32c_sse42(data, size, ~0U);
+        }
+#endif
+        return ~detail::crc32c_portable(data, size, ~0U);
+    }
+};
+
+// 64-bit xxHash (XXH64) with seed 0
+struct xxhash64 {
+    using value_type = std::uint64_t;
+
+    static constexpr auto compute(const char *data, std::size_t size)
+        -> value_type {
+        constexpr std::uint64_t p1 = 0x9E3779B185EBCA87ULL;
+        constexpr std::uint64_t p2 = 0xC2B2AE3D27D4EB4FULL;
+        constexpr std::uint64_t p3 = 0x165667B19E3779F9ULL;
+        constexpr std::uint64_t p4 = 0x85EBCA77C2B2AE63ULL;
+        constexpr std::uint64_t p5 = 0x27D4EB2F165667C5ULL;
+
+        auto round = [](std::uint64_t acc, std::uint64_t input) {
+            return detail::rotl64(acc + input * p2, 31) * p1;
+        };
+        auto merge = [&](std::uint64_t acc, std::uint64_t val) {
+            return (acc ^ round(0, val)) * p1 + p4;
+        };
+
+        const char   *end = data + size;
+        std::uint64_t h = 0;
+        if (size >= 32) {
+            std::uint64_t v1 = p1 + p2;
+            std::uint64_t v2 = p2;
+            std::uint64_t v3 = 0;
+            std::uint64_t v4 = 0 - p1;
+            for (; end - data >= 32; data += 32) {
+                v1 = round(v1, detail::read64(data));
+                v2 = round(v2, detail::read64(data + 8));
+                v3 = round(v3, detail::read64(data + 16));
+                v4 = round(v4, detail::read64(data + 24));
+            }
+            h = detail::rotl64(v1, 1) + detail::rotl64(v2, 7)
+                + detail::rotl64(v3, 12) + detail::rotl64(v4, 18);
+            h = merge(h, v1);
+            h = merge(h, v2);
+            h = merge(h, v3);
+            h = merge(h, v4);
+        } else {
+            h = p5;
+        }
+        h += size;
+
+        for (; end - data >= 8; data += 8) {
+            h ^= round(0, detail::read64(data));
+            h = detail::rotl64(h, 27) * p1 + p4;
+        }
+        if (end - data >= 4) {
+            h ^= detail::read32(data) * p1;
+            h = detail::rotl64(h, 23) * p2 + p3;
+            data += 4;
+        }
+        for (; data < end; data++) {
+            h ^= static_cast<std::uint8_t>(*data) * p5;
+            h = detail::rotl64(h, 11) * p1;
+        }
+
+        h ^= h >> 33;
+        h *= p2;
+        h ^= h >> 29;
+        h *= p3;
+        h ^= h >> 32;
+        return h;
+    }
+};
+
+// A checksummed record is the packed record followed directly (without
+// padding) by Checksum::value_type over the record bytes, in the byte order
+// of the format.
+template <typename Checksum, typename Fmt>
+constexpr auto checksummed_size(Fmt /*unused*/) -> std::size_t {
+    return struct_pack::calcsize(Fmt{}) + sizeof(typename Checksum::value_type);
+}
+
+// Packs a record and its checksum into `output`. The checksum is a second
+// pass over the bytes just packed, taken while they are still cache-hot
+// rather than while the fields are written.
+template <typename Checksum, typename Fmt, typename... Args>
+auto pack_into_checksummed(Fmt /*unused*/, char *output, Args &&...args)
+    -> std::size_t {
+    constexpr auto record_size = struct_pack::calcsize(Fmt{});
+    struct_pack::pack_into(Fmt{}, output, std::forward<Args>(args)...);
+
+    auto view = data_view<char>(output + record_size,
+                                getFormatMode(Fmt{}).isBigEndian());
+    data::store(view, Checksum::compute(output, record_size));
+    return checksummed_size<Checksum>(Fmt{});
+}
+
+template <typename Checksum, typename Fmt, typename... Args>
+auto pack_checksummed(Fmt /*unused*/, Args &&...args) {
+    std::array<char, checksummed_size<Checksum>(Fmt{})> output{};
+    pack_into_checksummed<Checksum>(
+        Fmt{}, output.data(), std::forward<Args>(args)...);
+    return output;
+}
+
+// Verifies the trailing checksum and unpacks the record, or returns nullopt
+// if the input is too short or the checksum does not match
+template <typename Checksum, typename Fmt, typename Input>
+auto unpack_checksummed(Fmt /*unused*/, Input &&packedInput)
+    -> std::optional<decltype(struct_pack::unpack(Fmt{}, packedInput))> {
+    constexpr auto record_size = struct_pack::calcsize(Fmt{});
+    if (std::size(packedInput) < checksummed_size<Checksum>(Fmt{})) {
+        return std::nullopt;
+    }
+
+    const char *data = std::data(packedInput);
+    auto        view = data_view<const char>(data + record_size,
+                                      getFormatMode(Fmt{}).isBigEndian());
+    if (data::get<typename Checksum::value_type>(view)
+        != Checksum::compute(data, record_size)) {
+        return std::nullopt;
+    }
+    return struct_pack::unpack(Fmt{}, std::string_view(data, record_size));
+}
+
+} // namespace struct_pack
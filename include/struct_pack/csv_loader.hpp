@@ -0,0 +1,417 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "struct_pack/calcsize.hpp"
+#include "struct_pack/data_view.hpp"
+#include "struct_pack/fd_io.hpp"
+#include "struct_pack/record_builder.hpp"
+
+namespace struct_pack {
+
+struct csv_options {
+    char         delimiter{','};
+    bool         header{false}; // skip the first line
+    std::size_t  threads{1};    // 0 for one per hardware thread
+    buffer_pages pages{buffer_pages::normal};
+};
+
+namespace detail {
+    // Each thread parses at least this much text
+    inline constexpr std::size_t csv_min_chunk = std::size_t{1} << 16;
+
+    // The first `delimiter` or '\n' in [p, end), or `end`; 16 bytes at a
+    // time with SSE2
+    inline auto find_field_end(const char *p, const char *end, char delimiter)
+        -> const char * {
+#if defined(__SSE2__)
+        auto delimiters = _mm_set1_epi8(delimiter);
+        auto newlines = _mm_set1_epi8('\n');
+        for (; end - p >= 16; p += 16) {
+            auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            auto mask = _mm_movemask_epi8(
+                _mm_or_si128(_mm_cmpeq_epi8(block, delimiters),
+                             _mm_cmpeq_epi8(block, newlines)));
+            if (mask != 0) {
+                return p + std::countr_zero(static_cast<unsigned>(mask));
+            }
+        }
+#endif
+        for (; p < end; p++) {
+            if (*p == delimiter || *p == '\n') {
+                return p;
+            }
+        }
+        return end;
+    }
+
+    // The integer type data::store() takes for an item type
+    template <typename T>
+    using csv_stored_type = std::conditional_t<
+        std::is_floating_point_v<T> || std::is_same_v<T, bool>,
+        T,
+        std::conditional_t<
+            std::is_signed_v<T>,
+            std::conditional_t<
+                sizeof(T) == 1,
+                std::int8_t,
+                std::conditional_t<
+                    sizeof(T) == 2,
+                    std::int16_t,
+                    std::conditional_t<sizeof(T) == 4,
+                                       std::int32_t,
+                                       std::int64_t>>>,
+            std::conditional_t<
+                sizeof(T) == 1,
+                std::uint8_t,
+                std::conditional_t<
+                    sizeof(T) == 2,
+                    std::uint16_t,
+                    std::conditional_t<sizeof(T) == 4,
+                                       std::uint32_t,
+                                       std::uint64_t>>>>>;
+
+    // A field as found in the text: `quoted` fields may hold "" escapes
+    struct csv_field {
+        std::string_view text;
+        bool             quoted;
+    };
+
+    // Packs `field` as item Item of the zeroed record at `record`; false
+    // if it does not hold a value of the item's type
+    template <typename Fmt, std::size_t Item>
+    auto parse_csv_field(csv_field field, char *record) -> bool {
+        constexpr auto formatMode = struct_pack::getFormatMode(Fmt{});
+        constexpr auto format = struct_pack::getTypeOfItem<Item>(Fmt{});
+        using Type = struct_pack::RepresentedType<decltype(formatMode),
+                                                  format.formatChar>;
+        char *out = record + getBinaryOffset<Item>(Fmt{});
+        auto  text = field.text;
+
+        if constexpr (format.formatChar == 's' || format.formatChar == 'c') {
+            std::size_t size = 0;
+            for (std::size_t i = 0; i < text.size(); i++, size++) {
+                if (size == format.size) {
+                    return false;
+                }
+                out[size] = text[i];
+                if (field.quoted && text[i] == '"') {
+                    i++; // the second quote of an escaped one
+                }
+            }
+            return format.formatChar == 's' || size == 1;
+        } else if constexpr (std::is_same_v<Type, bool>) {
+            if (text == "1" || text == "true") {
+                *out = 1;
+            } else if (text != "0" && text != "false") {
+                return false;
+            }
+            return true;
+        } else {
+            Type value{};
+            const char *end = text.data() + text.size();
+            auto [ptr, error] = std::from_chars(text.data(), end, value);
+            if (error != std::errc() || ptr != end) {
+                return false;
+            }
+            auto view = data_view<char>(out, formatMode.isBigEndian());
+            data::store(view, static_cast<csv_stored_type<Type>>(value));
+            return true;
+        }
+    }
+
+    // Lines in [begin, end), guessed from the first few kilobytes, to
+    // reserve room for the records up front
+    inline auto estimate_lines(const char *begin, const char *end)
+        -> std::size_t {
+        auto size = static_cast<std::size_t>(end - begin);
+        auto sample = std::min<std::size_t>(size, 4096);
+        auto lines = static_cast<std::size_t>(
+            std::count(begin, begin + sample, '\n'));
+        if (lines == 0) {
+            return 1;
+        }
+        return size / (sample / lines) + 1;
+    }
+
+    [[noreturn]] inline void
+    throw_csv_error(const char *origin, const char *at, const char *what) {
+        auto line = std::count(origin, at, '\n') + 1;
+        throw std::system_error(
+            std::make_error_code(std::errc::invalid_argument),
+            "csv: line " + std::to_string(line) + ": " + what);
+    }
+
+    // Parses the lines of [begin, end) into `builder`. `origin` is where
+    // the text starts, to give line numbers in errors.
+    template <typename Fmt>
+    class csv_parser {
+    public:
+        static constexpr std::size_t record_size
+            = struct_pack::calcsize(Fmt{});
+
+        csv_parser(const char *origin, char delimiter)
+            : origin_{origin}
+            , delimiter_{delimiter} {}
+
+        auto parse(const char          *begin,
+                   const char          *end,
+                   record_builder<Fmt> &builder) const -> std::size_t {
+            std::size_t records = 0;
+            for (const char *p = begin; p < end;) {
+                if (*p == '\n') {
+                    p++; // a blank line
+                    continue;
+                }
+                if (*p == '\r' && p + 1 < end && p[1] == '\n') {
+                    p += 2;
+                    continue;
+                }
+                auto  previous = builder.size();
+                char *record = builder.allocate(1);
+                std::memset(record, 0, record_size);
+                try {
+                    p = parse_record(
+                        p,
+                        end,
+                        record,
+                        std::make_index_sequence<countItems(Fmt{})>());
+                } catch (...) {
+                    // Leave no half-filled record behind
+                    builder.truncate(previous);
+                    throw;
+                }
+                records++;
+            }
+            return records;
+        }
+
+    private:
+        template <std::size_t... Items>
+        auto parse_record(const char *p,
+                          const char *end,
+                          char       *record,
+                          std::index_sequence<Items...>) const
+            -> const char * {
+            bool first = true;
+            (
+                [&] {
+                    if constexpr (struct_pack::getTypeOfItem<Items>(Fmt{})
+                                      .formatChar
+                                  != 'x') {
+                        if (!first) {
+                            if (p == end || *p != delimiter_) {
+                                throw_csv_error(origin_, p, "too few fields");
+                            }
+                            p++;
+                        }
+                        first = false;
+                        auto field = next_field(p, end);
+                        if (!parse_csv_field<Fmt, Items>(field, record)) {
+                            throw_csv_error(origin_,
+                                            field.text.data(),
+                                            "bad field");
+                        }
+                    }
+                }(),
+                ...);
+            if (p < end && *p == '\r') {
+                p++;
+            }
+            if (p < end && *p != '\n') {
+                throw_csv_error(origin_, p, "too many fields");
+            }
+            return p < end ? p + 1 : p;
+        }
+
+        // The field at `p`, leaving `p` right after it
+        auto next_field(const char *&p, const char *end) const -> csv_field {
+            if (p < end && *p == '"') {
+                const char *begin = ++p;
+                for (;; p++) {
+                    p = std::find_if(p, end, [](char c) {
+                        return c == '"' || c == '\n';
+                    });
+                    if (p == end || *p == '\n') {
+                        throw_csv_error(origin_, begin, "unterminated quote");
+                    }
+                    if (p + 1 == end || p[1] != '"') {
+                        break;
+                    }
+                    p++; // an escaped quote
+                }
+                auto text = std::string_view(begin, p - begin);
+                p++;
+                return {text, true};
+            }
+            const char *begin = p;
+            p = find_field_end(p, end, delimiter_);
+            auto text = std::string_view(begin, p - begin);
+            if (!text.empty() && text.back() == '\r'
+                && (p == end || *p == '\n')) {
+                text.remove_suffix(1);
+                p--;
+            }
+            return {text, false};
+        }
+
+        const char *origin_;
+        char        delimiter_;
+    };
+} // namespace detail
+
+// Parses delimited text into `builder`, one record per line, packing each
+// field straight into its place in the record: numbers with
+// std::from_chars, 's' items as the text itself, '?' from 1, 0, true or
+// false. A field may be quoted, with "" for a quote inside, but not span
+// lines; lines end with \n or \r\n, blank ones are skipped, and 'x'
+// padding takes no field.
+// Returns the number of records added; throws std::system_error with
+// errc::invalid_argument, naming the line, on text that does not fit Fmt,
+// keeping the records of the lines before it.
+template <typename Fmt>
+auto parse_csv(std::string_view     text,
+               record_builder<Fmt> &builder,
+               char                 delimiter = ',') -> std::size_t {
+    return detail::csv_parser<Fmt>(text.data(), delimiter)
+        .parse(text.data(), text.data() + text.size(), builder);
+}
+
+// Parses all of `text` like parse_csv(), split at line boundaries into
+// chunks parsed on `options.threads` threads, and returns the records in
+// the order of the lines
+template <typename Fmt>
+auto load_csv(Fmt, std::string_view text, const csv_options &options = {})
+    -> record_buffer<Fmt> {
+    const char *origin = text.data();
+    const char *begin = origin;
+    const char *end = origin + text.size();
+    if (options.header) {
+        begin = std::find(begin, end, '\n');
+        begin += begin < end ? 1 : 0;
+    }
+
+    auto threads = options.threads != 0
+                       ? options.threads
+                       : std::max(1U, std::thread::hardware_concurrency());
+    threads = std::clamp<std::size_t>(
+        static_cast<std::size_t>(end - begin) / detail::csv_min_chunk,
+        1,
+        threads);
+
+    std::vector<const char *> bounds = {begin};
+    for (std::size_t k = 1; k < threads; k++) {
+        const char *at
+            = std::max(bounds.back(),
+                       begin
+                           + (end - begin) * static_cast<std::ptrdiff_t>(k)
+                                 / static_cast<std::ptrdiff_t>(threads));
+        at = std::find(at, end, '\n');
+        bounds.push_back(at < end ? at + 1 : end);
+    }
+    bounds.push_back(end);
+
+    auto parser = detail::csv_parser<Fmt>(origin, options.delimiter);
+    std::vector<record_builder<Fmt>> parts;
+    for (std::size_t k = 0; k < threads; k++) {
+        parts.emplace_back(options.pages);
+    }
+    std::vector<std::exception_ptr> errors(threads);
+    auto parse_part = [&](std::size_t k) {
+        try {
+            parts[k].reserve(
+                detail::estimate_lines(bounds[k], bounds[k + 1]));
+            parser.parse(bounds[k], bounds[k + 1], parts[k]);
+        } catch (...) {
+            errors[k] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t k = 1; k < threads; k++) {
+        workers.emplace_back(parse_part, k);
+    }
+    parse_part(0);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    for (auto &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    auto       &records = parts[0];
+    std::size_t total = 0;
+    for (const auto &part : parts) {
+        total += part.size();
+    }
+    records.reserve(total);
+    for (std::size_t k = 1; k < threads; k++) {
+        auto bytes = parts[k].bytes();
+        std::memcpy(
+            records.allocate(parts[k].size()), bytes.data(), bytes.size());
+    }
+    return records.release();
+}
+
+// load_csv() over a file, which is mapped rather than read
+template <typename Fmt>
+auto load_csv_file(Fmt,
+                   const std::string &path,
+                   const csv_options &options = {}) -> record_buffer<Fmt> {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        detail::throw_errno("load_csv_file: open");
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        detail::throw_errno("load_csv_file: fstat");
+    }
+    auto size = static_cast<std::size_t>(st.st_size);
+    if (size == 0) {
+        ::close(fd);
+        return load_csv(Fmt{}, std::string_view(), options);
+    }
+    void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        detail::throw_errno("load_csv_file: mmap");
+    }
+    ::madvise(mapping, size, MADV_SEQUENTIAL);
+
+    struct unmap {
+        void       *mapping;
+        std::size_t size;
+        ~unmap() {
+            ::munmap(mapping, size);
+        }
+    } guard{mapping, size};
+    return load_csv(
+        Fmt{}, std::string_view(static_cast<char *>(mapping), size), options);
+}
+
+} // namespace struct_pack
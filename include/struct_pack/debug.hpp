@@ -12,15 +12,40 @@ inline auto &debug_logger = print_hpp::log::console;
 
 #define SET_LOG_LEVEL(level) debug_logger.set_level(level)
 #define SET_LOG_STYLE(style) debug_logger.set_style(style)
-#define LOG_TRACE(...) debug_logger.trace(__VA_ARGS__)
-#define LOG_INFO(...) debug_logger.info(__VA_ARGS__)
-#define LOG_DEBUG(...) debug_logger.debug(__VA_ARGS__)
-#define LOG_WARN(...) debug_logger.warn(__VA_ARGS__)
-#define LOG_ERROR(...) debug_logger.error(__VA_ARGS__)
-#define LOG_FATAL(...) debug_logger.fatal(__VA_ARGS__)
+
+// Arguments are only evaluated when the level is enabled; levels below
+// PRINT_HPP_MIN_LOG_LEVEL compile to nothing
+#define LOG_ENABLED(level)                                                     \
+    debug_logger.enabled<::print_hpp::log::LogLevel::level>()
+#define LOG_AT(level, fn, ...)                                                 \
+    (LOG_ENABLED(level) ? debug_logger.fn(__VA_ARGS__) : (void) (0))
+#define LOG_TRACE(...) LOG_AT(TRACE, trace, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(INFO, info, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(DEBUG, debug, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(WARN, warn, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(ERROR, error, __VA_ARGS__)
+#define LOG_FATAL(...) LOG_AT(FATAL, fatal, __VA_ARGS__)
 
 #define LOG(level) LOG_##level
-#define LOG_IF(level, condition) (!(condition)) ? (void) (0) : LOG(level)
+#define LOG_IF(level, condition)                                               \
+    (!LOG_ENABLED(level) || !(condition)) ? (void) (0) : LOG(level)
+
+// Rate-limited logging for hot loops: the first of every `n` calls, or at
+// most one call every `ms` milliseconds, per call site
+#define LOG_EVERY_N(level, n, ...)                                             \
+    LOG_IF(level,                                                              \
+           ([]() -> auto & {                                                   \
+               static ::print_hpp::log::detail::EveryN every;                 \
+               return every;                                                   \
+           }()(n)))                                                            \
+    (__VA_ARGS__)
+#define LOG_EVERY_MS(level, ms, ...)                                           \
+    LOG_IF(level,                                                              \
+           ([]() -> auto & {                                                   \
+               static ::print_hpp::log::detail::EveryMs every;                \
+               return every;                                                   \
+           }()(ms)))                                                           \
+    (__VA_ARGS__)
 
 #else
 
@@ -35,6 +60,8 @@ inline auto &debug_logger = print_hpp::log::console;
 
 #define LOG(level)
 #define LOG_IF(level, condition)
+#define LOG_EVERY_N(level, n, ...)
+#define LOG_EVERY_MS(level, ms, ...)
 
 #endif
 
@@ -0,0 +1,503 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define STRUCT_PACK_HAS_AVX2_BITPACK 1
+#else
+#define STRUCT_PACK_HAS_AVX2_BITPACK 0
+#endif
+
+#include "struct_pack/calcsize.hpp"
+#include "struct_pack/data_view.hpp"
+#include "struct_pack/fd_io.hpp"
+#include "struct_pack/pack.hpp"
+#include "struct_pack/string_literal.hpp"
+#include "struct_pack/unpack.hpp"
+
+// A batch of records of one format with some integer items delta encoded:
+//
+//     header:   <4sIH   magic "SPDF", record count, column count
+//     columns:  <HBQq   item index, bit width, first value, smallest delta,
+//                       then the bit packed deltas
+//     records:  the packed records with the encoded items cut out
+//
+// Each delta minus the smallest one is stored in `bit width` bits. The
+// deltas are spread over 4 lanes, the i-th going to lane i % 4, and each
+// lane is a stream of little endian 64-bit words, interleaved word by word
+// across the lanes so that 4 values unpack at once with one vector shift.
+
+namespace struct_pack {
+
+namespace detail {
+    constexpr auto delta_batch_header = "<4sIH"_fmt;
+    constexpr auto delta_column_header = "<HBQq"_fmt;
+    constexpr auto delta_batch_magic = std::string_view("SPDF");
+    constexpr std::size_t delta_batch_header_size
+        = struct_pack::calcsize(delta_batch_header);
+    constexpr std::size_t delta_column_header_size
+        = struct_pack::calcsize(delta_column_header);
+    constexpr std::size_t delta_lanes = 4;
+
+    // Bytes of the packed deltas of a column of `count` records
+    constexpr auto delta_words_size(std::size_t count, unsigned width)
+        -> std::size_t {
+        auto groups = (std::max<std::size_t>(count, 1) - 1 + delta_lanes - 1)
+                      / delta_lanes;
+        return (groups * width + 63) / 64 * delta_lanes * 8;
+    }
+
+    // Where the next group of values starts in each lane
+    struct bit_cursor {
+        std::size_t word{0};
+        unsigned    shift{0};
+    };
+
+    inline auto load_word(const char *words, std::size_t index)
+        -> std::uint64_t {
+        auto view = data_view<const char>(words + index * 8, false);
+        return data::get<std::uint64_t>(view);
+    }
+
+    // Unpacks `groups` groups of 4 values of `width` bits, with width > 0
+    inline auto unpack_bits_portable(const char    *words,
+                                     unsigned       width,
+                                     bit_cursor    &cursor,
+                                     std::uint64_t *out,
+                                     std::size_t    groups) -> void {
+        auto mask = width == 64 ? ~std::uint64_t{0}
+                                : (std::uint64_t{1} << width) - 1;
+        for (std::size_t g = 0; g < groups; g++, out += delta_lanes) {
+            for (std::size_t lane = 0; lane < delta_lanes; lane++) {
+                auto value
+                    = load_word(words, cursor.word * delta_lanes + lane)
+                      >> cursor.shift;
+                if (cursor.shift + width > 64) {
+                    value |= load_word(words,
+                                       (cursor.word + 1) * delta_lanes + lane)
+                             << (64 - cursor.shift);
+                }
+                out[lane] = value & mask;
+            }
+            cursor.shift += width;
+            if (cursor.shift >= 64) {
+                cursor.shift -= 64;
+                cursor.word++;
+            }
+        }
+    }
+
+#if STRUCT_PACK_HAS_AVX2_BITPACK
+    __attribute__((target("avx2"))) inline auto
+    unpack_bits_avx2(const char    *words,
+                     unsigned       width,
+                     bit_cursor    &cursor,
+                     std::uint64_t *out,
+                     std::size_t    groups) -> void {
+        auto mask = _mm256_set1_epi64x(static_cast<long long>(
+            width == 64 ? ~std::uint64_t{0}
+                        : (std::uint64_t{1} << width) - 1));
+        for (std::size_t g = 0; g < groups; g++, out += delta_lanes) {
+            const char *at = words + cursor.word * delta_lanes * 8;
+            auto        value = _mm256_srl_epi64(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(at)),
+                _mm_cvtsi32_si128(static_cast<int>(cursor.shift)));
+            if (cursor.shift + width > 64) {
+                auto next = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i *>(at + delta_lanes * 8));
+                auto left = static_cast<int>(64 - cursor.shift);
+                value = _mm256_or_si256(
+                    value, _mm256_sll_epi64(next, _mm_cvtsi32_si128(left)));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out),
+                                _mm256_and_si256(value, mask));
+            cursor.shift += width;
+            if (cursor.shift >= 64) {
+                cursor.shift -= 64;
+                cursor.word++;
+            }
+        }
+    }
+
+    inline auto has_avx2() -> bool {
+#if defined(__AVX2__)
+        return true;
+#else
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+#endif
+    }
+#endif
+
+    // Unpacks with AVX2 when the CPU has it
+    inline auto unpack_bits(const char    *words,
+                            unsigned       width,
+                            bit_cursor    &cursor,
+                            std::uint64_t *out,
+                            std::size_t    groups) -> void {
+        if (width == 0) {
+            std::fill_n(out, groups * delta_lanes, 0);
+            return;
+        }
+#if STRUCT_PACK_HAS_AVX2_BITPACK
+        if (detail::has_avx2()) {
+            unpack_bits_avx2(words, width, cursor, out, groups);
+            return;
+        }
+#endif
+        unpack_bits_portable(words, width, cursor, out, groups);
+    }
+
+    // Packs `count` values of `width` bits into zeroed lane words
+    inline auto pack_bits(const std::uint64_t *values,
+                          std::size_t          count,
+                          unsigned             width,
+                          std::uint64_t       *words) -> void {
+        if (width == 0) {
+            return;
+        }
+        for (std::size_t i = 0; i < count; i++) {
+            auto bit = i / delta_lanes * width;
+            auto lane = i % delta_lanes;
+            auto word = bit / 64;
+            auto shift = static_cast<unsigned>(bit % 64);
+            words[word * delta_lanes + lane] |= values[i] << shift;
+            if (shift + width > 64) {
+                words[(word + 1) * delta_lanes + lane]
+                    |= values[i] >> (64 - shift);
+            }
+        }
+    }
+
+    template <typename Fmt, std::size_t Item>
+    using delta_item_type
+        = struct_pack::RepresentedType<decltype(struct_pack::getFormatMode(
+                                           Fmt{})),
+                                       struct_pack::getTypeOfItem<Item>(Fmt{})
+                                           .formatChar>;
+
+    template <typename Fmt, std::size_t Item>
+    constexpr auto delta_encodable() -> bool {
+        using Type = delta_item_type<Fmt, Item>;
+        return std::is_integral_v<Type> && !std::is_same_v<Type, bool>
+               && struct_pack::getTypeOfItem<Item>(Fmt{}).formatChar != 'c';
+    }
+} // namespace detail
+
+// Packed records of Fmt whose integer items `Items` (in increasing order)
+// are stored as deltas, made by encode_delta(). Sequence numbers and
+// timestamps that grow by small steps shrink to a few bits per record.
+// Reads the encoded bytes in place, which must outlive it.
+//
+//     auto encoded = struct_pack::encode_delta<0, 1>(Fmt{}, records);
+//     auto batch = struct_pack::delta_batch<Fmt, 0, 1>(encoded);
+//     std::vector<std::uint64_t> times(batch.size());
+//     batch.decode_column<0>(times.data());
+template <typename Fmt, std::size_t... Items>
+class delta_batch {
+public:
+    static constexpr std::size_t record_size = struct_pack::calcsize(Fmt{});
+    static constexpr std::size_t column_count = sizeof...(Items);
+
+    static_assert(column_count > 0, "Delta encode at least one item");
+    static_assert((detail::delta_encodable<Fmt, Items>() && ...),
+                  "Delta encoding is for integer items");
+
+private:
+    static constexpr std::array<std::size_t, column_count> items = {Items...};
+    static constexpr std::array<std::size_t, column_count> offsets
+        = {getBinaryOffset<Items>(Fmt{})...};
+    static constexpr std::array<std::size_t, column_count> sizes
+        = {struct_pack::getTypeOfItem<Items>(Fmt{}).size...};
+
+    static constexpr auto increasing() -> bool {
+        for (std::size_t c = 1; c < column_count; c++) {
+            if (items[c - 1] >= items[c]) {
+                return false;
+            }
+        }
+        return true;
+    }
+    static_assert(increasing(), "Delta encoded items must be increasing");
+
+    // Encoded bytes before byte `offset` of a record
+    static constexpr auto encoded_before(std::size_t offset) -> std::size_t {
+        std::size_t size = 0;
+        for (std::size_t c = 0; c < column_count; c++) {
+            if (offsets[c] < offset) {
+                size += sizes[c];
+            }
+        }
+        return size;
+    }
+
+    template <std::size_t Item>
+    static constexpr auto column_of() -> std::size_t {
+        return static_cast<std::size_t>(
+            std::find(items.begin(), items.end(), Item) - items.begin());
+    }
+
+public:
+    // A record without the encoded items
+    static constexpr std::size_t rest_size
+        = record_size - encoded_before(record_size);
+
+    // Throws std::system_error with errc::invalid_argument if `encoded` is
+    // not a delta batch of these items
+    explicit delta_batch(std::string_view encoded) {
+        if (encoded.size() < detail::delta_batch_header_size) {
+            detail::throw_invalid("delta_batch: truncated");
+        }
+        auto [magic, count, columns] = struct_pack::unpack(
+            detail::delta_batch_header,
+            encoded.substr(0, detail::delta_batch_header_size));
+        if (magic != detail::delta_batch_magic || columns != column_count) {
+            detail::throw_invalid(
+                "delta_batch: not a delta batch of these items");
+        }
+        count_ = count;
+
+        auto offset = detail::delta_batch_header_size;
+        for (std::size_t c = 0; c < column_count; c++) {
+            if (encoded.size() < offset + detail::delta_column_header_size) {
+                detail::throw_invalid("delta_batch: truncated");
+            }
+            auto [item, width, first, min_delta] = struct_pack::unpack(
+                detail::delta_column_header,
+                encoded.substr(offset, detail::delta_column_header_size));
+            if (item != items[c] || width > 64) {
+                detail::throw_invalid(
+                "delta_batch: not a delta batch of these items");
+            }
+            offset += detail::delta_column_header_size;
+            columns_[c] = {width,
+                           first,
+                           static_cast<std::uint64_t>(min_delta),
+                           encoded.data() + offset};
+            offset += detail::delta_words_size(count_, width);
+        }
+        rest_ = encoded.data() + offset;
+        if (encoded.size() < offset + count_ * rest_size) {
+            detail::throw_invalid("delta_batch: truncated");
+        }
+    }
+
+    // Number of records
+    auto size() const -> std::size_t {
+        return count_;
+    }
+
+    auto empty() const -> bool {
+        return count_ == 0;
+    }
+
+    // Bits taken by each record's delta of Item
+    template <std::size_t Item>
+    auto bit_width() const -> unsigned {
+        return columns_[column_of<Item>()].width;
+    }
+
+    // Item I of record i, for an item that is not delta encoded
+    template <std::size_t I>
+    auto get(std::size_t i) const {
+        static_assert(column_of<I>() == column_count,
+                      "Delta encoded items are read with decode_column()");
+        constexpr auto formatMode = struct_pack::getFormatMode(Fmt{});
+        constexpr auto format = struct_pack::getTypeOfItem<I>(Fmt{});
+        using Type = struct_pack::RepresentedType<decltype(formatMode),
+                                                  format.formatChar>;
+        constexpr auto offset = getBinaryOffset<I>(Fmt{});
+        return unpackElement<I, Type>(rest_ + i * rest_size + offset
+                                          - encoded_before(offset),
+                                      format.size,
+                                      formatMode.isBigEndian());
+    }
+
+    // Writes the size() values of the delta encoded Item to `out`
+    template <std::size_t Item, typename T>
+    auto decode_column(T *out) const -> void {
+        static_assert(column_of<Item>() < column_count,
+                      "Item is not delta encoded");
+        decode(columns_[column_of<Item>()], out);
+    }
+
+    // Packs the records back to `out`, which has room for size() records
+    auto decode_into(char *out) const -> std::size_t {
+        column_values values;
+        for (std::size_t c = 0; c < column_count; c++) {
+            values[c].resize(count_);
+            decode(columns_[c], values[c].data());
+        }
+        for (std::size_t i = 0; i < count_; i++, out += record_size) {
+            const char *rest = rest_ + i * rest_size;
+            std::size_t from = 0;
+            for (std::size_t c = 0; c < column_count; c++) {
+                std::copy_n(rest, offsets[c] - from, out + from);
+                rest += offsets[c] - from;
+                from = offsets[c] + sizes[c];
+            }
+            std::copy_n(rest, record_size - from, out + from);
+            store_columns(
+                out, values, i, std::make_index_sequence<column_count>());
+        }
+        return count_ * record_size;
+    }
+
+private:
+    using column_values
+        = std::array<std::vector<std::uint64_t>, column_count>;
+
+    struct column {
+        unsigned      width{0};
+        std::uint64_t first{0};
+        std::uint64_t min_delta{0};
+        const char   *words{nullptr};
+    };
+
+    // Values come out a chunk at a time: unpack the offsets, then add them
+    // up into the running value
+    template <typename T>
+    auto decode(const column &c, T *out) const -> void {
+        if (count_ == 0) {
+            return;
+        }
+        constexpr std::size_t chunk_groups = 64;
+        std::array<std::uint64_t, chunk_groups * detail::delta_lanes> chunk;
+
+        auto value = c.first;
+        *out++ = static_cast<T>(value);
+        auto cursor = detail::bit_cursor();
+        for (auto remaining = count_ - 1; remaining > 0;) {
+            auto groups = std::min(chunk_groups,
+                                   (remaining + detail::delta_lanes - 1)
+                                       / detail::delta_lanes);
+            detail::unpack_bits(c.words, c.width, cursor, chunk.data(), groups);
+            auto take = std::min(remaining, groups * detail::delta_lanes);
+            for (std::size_t k = 0; k < take; k++) {
+                value += c.min_delta + chunk[k];
+                *out++ = static_cast<T>(value);
+            }
+            remaining -= take;
+        }
+    }
+
+    template <std::size_t... Columns>
+    static auto store_columns(char                *out,
+                              const column_values &values,
+                              std::size_t          i,
+                              std::index_sequence<Columns...>) -> void {
+        constexpr auto formatMode = struct_pack::getFormatMode(Fmt{});
+        (
+            [&] {
+                auto view = data_view<char>(out + offsets[Columns],
+                                            formatMode.isBigEndian());
+                data::store(view,
+                            static_cast<detail::delta_item_type<
+                                Fmt,
+                                items[Columns]>>(values[Columns][i]));
+            }(),
+            ...);
+    }
+
+    std::size_t                      count_{0};
+    std::array<column, column_count> columns_{};
+    const char                      *rest_{nullptr};
+};
+
+// Encodes the whole records of `packedInput` as a delta_batch with the
+// integer items `Items` (in increasing order) delta encoded and bit packed
+template <std::size_t... Items, typename Fmt, typename Input>
+auto encode_delta(Fmt, Input &&packedInput) -> std::string {
+    using batch = delta_batch<Fmt, Items...>;
+    constexpr auto formatMode = struct_pack::getFormatMode(Fmt{});
+    constexpr std::array<std::size_t, sizeof...(Items)> offsets
+        = {getBinaryOffset<Items>(Fmt{})...};
+    constexpr std::array<std::size_t, sizeof...(Items)> sizes
+        = {struct_pack::getTypeOfItem<Items>(Fmt{}).size...};
+
+    const char *data = std::data(packedInput);
+    auto        count = std::size(packedInput) / batch::record_size;
+
+    std::string encoded(detail::delta_batch_header_size, '\0');
+    struct_pack::pack_into(detail::delta_batch_header,
+                           encoded.data(),
+                           detail::delta_batch_magic,
+                           static_cast<std::uint32_t>(count),
+                           static_cast<std::uint16_t>(sizeof...(Items)));
+
+    std::vector<std::uint64_t> deltas;
+    std::vector<std::uint64_t> words;
+    auto encode_column = [&]<std::size_t Item>() {
+        using Type = detail::delta_item_type<Fmt, Item>;
+        constexpr auto format = struct_pack::getTypeOfItem<Item>(Fmt{});
+        auto value = [&](std::size_t i) {
+            return static_cast<std::uint64_t>(unpackElement<Item, Type>(
+                data + i * batch::record_size + getBinaryOffset<Item>(Fmt{}),
+                format.size,
+                formatMode.isBigEndian()));
+        };
+
+        auto first = count > 0 ? value(0) : 0;
+        auto min_delta = std::int64_t{0};
+        deltas.clear();
+        for (std::size_t i = 1; i < count; i++) {
+            deltas.push_back(value(i) - value(i - 1));
+            auto delta = static_cast<std::int64_t>(deltas.back());
+            min_delta = i == 1 ? delta : std::min(min_delta, delta);
+        }
+        std::uint64_t max_offset = 0;
+        for (auto &delta : deltas) {
+            delta -= static_cast<std::uint64_t>(min_delta);
+            max_offset = std::max(max_offset, delta);
+        }
+        auto width = static_cast<unsigned>(std::bit_width(max_offset));
+
+        auto words_size = detail::delta_words_size(count, width);
+        words.assign(words_size / 8, 0);
+        detail::pack_bits(deltas.data(), deltas.size(), width, words.data());
+
+        auto at = encoded.size();
+        encoded.resize(at + detail::delta_column_header_size + words_size);
+        at += struct_pack::pack_into(detail::delta_column_header,
+                                     encoded.data() + at,
+                                     static_cast<std::uint16_t>(Item),
+                                     static_cast<std::uint8_t>(width),
+                                     first,
+                                     min_delta);
+        for (auto word : words) {
+            auto view = data_view<char>(encoded.data() + at, false);
+            data::store(view, word);
+            at += 8;
+        }
+    };
+    (encode_column.template operator()<Items>(), ...);
+
+    auto at = encoded.size();
+    encoded.resize(at + count * batch::rest_size);
+    char *out = encoded.data() + at;
+    for (std::size_t i = 0; i < count; i++) {
+        const char *record = data + i * batch::record_size;
+        std::size_t from = 0;
+        for (std::size_t c = 0; c < sizeof...(Items); c++) {
+            out = std::copy(record + from, record + offsets[c], out);
+            from = offsets[c] + sizes[c];
+        }
+        out = std::copy(record + from, record + batch::record_size, out);
+    }
+    return encoded;
+}
+
+} // namespace struct_pack
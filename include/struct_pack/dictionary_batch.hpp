@@ -0,0 +1,299 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "struct_pack/calcsize.hpp"
+#include "struct_pack/fd_io.hpp"
+#include "struct_pack/pack.hpp"
+#include "struct_pack/string_literal.hpp"
+#include "struct_pack/unpack.hpp"
+
+// A batch of records of one format with one 's' item dictionary encoded:
+//
+//     header:      <4sIIB  magic "SPDB", record count, dictionary size,
+//                          code width (1, 2 or 4 bytes)
+//     dictionary:  the distinct values of the item, each at its full width
+//     codes:       one little endian code per record
+//     records:     the packed records with the item cut out
+
+namespace struct_pack {
+
+namespace detail {
+    constexpr auto dictionary_batch_header = "<4sIIB"_fmt;
+    constexpr auto dictionary_batch_magic = std::string_view("SPDB");
+    constexpr std::size_t dictionary_batch_header_size
+        = struct_pack::calcsize(dictionary_batch_header);
+
+    constexpr auto code_width(std::size_t entries) -> std::size_t {
+        return entries <= 0x100 ? 1 : entries <= 0x10000 ? 2 : 4;
+    }
+
+    inline auto store_code(char *out, std::uint32_t code, std::size_t width)
+        -> void {
+        for (std::size_t i = 0; i < width; i++, code >>= 8) {
+            out[i] = static_cast<char>(code & 0xff);
+        }
+    }
+
+    inline auto load_code(const char *in, std::size_t width) -> std::uint32_t {
+        std::uint32_t code = 0;
+        for (std::size_t i = width; i-- > 0;) {
+            code = code << 8 | static_cast<unsigned char>(in[i]);
+        }
+        return code;
+    }
+
+    // Whether a packed 's' item holds `value`: packing pads it with zeros
+    inline auto padded_equal(std::string_view item, std::string_view value)
+        -> bool {
+        if (value.size() > item.size()) {
+            return false;
+        }
+        return item.substr(0, value.size()) == value
+               && std::all_of(item.begin() + value.size(),
+                              item.end(),
+                              [](char c) { return c == '\0'; });
+    }
+
+    template <typename Fmt, std::size_t Item>
+    constexpr auto dictionary_item_size() -> std::size_t {
+        constexpr auto format = struct_pack::getTypeOfItem<Item>(Fmt{});
+        static_assert(format.formatChar == 's',
+                      "Dictionary encoding is for 's' items");
+        return format.size;
+    }
+} // namespace detail
+
+// Packed records of Fmt, `Item` of which is replaced by a code into a
+// dictionary of its distinct values. Made by encode_dictionary(); reads
+// the encoded bytes in place, which must outlive it.
+//
+//     auto encoded = struct_pack::encode_dictionary<3>(Fmt{}, records);
+//     auto batch = struct_pack::dictionary_batch<Fmt, 3>(encoded);
+//     batch.for_each_equal("AAPL", [&](std::size_t i) {
+//         auto price = batch.get<2>(i);
+//     });
+template <typename Fmt, std::size_t Item>
+class dictionary_batch {
+public:
+    static constexpr std::size_t record_size = struct_pack::calcsize(Fmt{});
+    static constexpr std::size_t item_size
+        = detail::dictionary_item_size<Fmt, Item>();
+    // A record without the dictionary encoded item
+    static constexpr std::size_t rest_size = record_size - item_size;
+
+    // Throws std::system_error with errc::invalid_argument if `encoded` is
+    // not a dictionary batch of this size or a code has no entry
+    explicit dictionary_batch(std::string_view encoded) {
+        if (encoded.size() < detail::dictionary_batch_header_size) {
+            detail::throw_invalid("dictionary_batch: truncated");
+        }
+        auto [magic, count, entries, width] = struct_pack::unpack(
+            detail::dictionary_batch_header,
+            encoded.substr(0, detail::dictionary_batch_header_size));
+        if (magic != detail::dictionary_batch_magic
+            || width != detail::code_width(entries)) {
+            detail::throw_invalid("dictionary_batch: not a dictionary batch");
+        }
+        if (encoded.size() < encoded_size(count, entries)) {
+            detail::throw_invalid("dictionary_batch: truncated");
+        }
+        count_ = count;
+        entries_ = entries;
+        width_ = width;
+        dictionary_ = encoded.data() + detail::dictionary_batch_header_size;
+        codes_ = dictionary_ + entries_ * item_size;
+        rest_ = codes_ + count_ * width_;
+        // Every code must name an entry, so entry() stays in the dictionary
+        for (std::size_t i = 0; i < count_; i++) {
+            if (code(i) >= entries_) {
+                detail::throw_invalid("dictionary_batch: code out of range");
+            }
+        }
+    }
+
+    // Bytes of a batch of `count` records with `entries` distinct values
+    static constexpr auto encoded_size(std::size_t count, std::size_t entries)
+        -> std::size_t {
+        return detail::dictionary_batch_header_size + entries * item_size
+               + count * (detail::code_width(entries) + rest_size);
+    }
+
+    // Number of records
+    auto size() const -> std::size_t {
+        return count_;
+    }
+
+    auto empty() const -> bool {
+        return count_ == 0;
+    }
+
+    auto dictionary_size() const -> std::size_t {
+        return entries_;
+    }
+
+    // A dictionary entry, at the item's full width like unpack() gives it
+    auto entry(std::uint32_t code) const -> std::string_view {
+        return {dictionary_ + code * item_size, item_size};
+    }
+
+    auto code(std::size_t i) const -> std::uint32_t {
+        return detail::load_code(codes_ + i * width_, width_);
+    }
+
+    // The code of `value`, if any record holds it
+    auto find(std::string_view value) const -> std::optional<std::uint32_t> {
+        for (std::uint32_t code = 0; code < entries_; code++) {
+            if (detail::padded_equal(entry(code), value)) {
+                return code;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Item I of record i; the encoded item is a view into the dictionary
+    template <std::size_t I>
+    auto get(std::size_t i) const {
+        if constexpr (I == Item) {
+            return entry(code(i));
+        } else {
+            constexpr auto formatMode = struct_pack::getFormatMode(Fmt{});
+            constexpr auto format = struct_pack::getTypeOfItem<I>(Fmt{});
+            using Type = struct_pack::RepresentedType<decltype(formatMode),
+                                                      format.formatChar>;
+            constexpr auto offset = getBinaryOffset<I>(Fmt{})
+                                    - (I > Item ? item_size : 0);
+            return unpackElement<I, Type>(rest_ + i * rest_size + offset,
+                                          format.size,
+                                          formatMode.isBigEndian());
+        }
+    }
+
+    // Record i, as unpack() would give it
+    auto unpack(std::size_t i) const {
+        return unpack(i, std::make_index_sequence<countItems(Fmt{})>());
+    }
+
+    // Calls `on_index` with the index of every record whose item equals
+    // `value`, comparing codes only
+    template <typename F>
+    auto for_each_equal(std::string_view value, F &&on_index) const
+        -> std::size_t {
+        auto wanted = find(value);
+        if (!wanted) {
+            return 0;
+        }
+        switch (width_) {
+        case 1:
+            return for_each_code<1>(*wanted, on_index);
+        case 2:
+            return for_each_code<2>(*wanted, on_index);
+        default:
+            return for_each_code<4>(*wanted, on_index);
+        }
+    }
+
+    // Packs the records back to `out`, which has room for size() records
+    auto decode_into(char *out) const -> std::size_t {
+        constexpr auto offset = getBinaryOffset<Item>(Fmt{});
+        for (std::size_t i = 0; i < count_; i++, out += record_size) {
+            const char *rest = rest_ + i * rest_size;
+            std::memcpy(out, rest, offset);
+            std::memcpy(out + offset, entry(code(i)).data(), item_size);
+            std::memcpy(out + offset + item_size,
+                        rest + offset,
+                        rest_size - offset);
+        }
+        return count_ * record_size;
+    }
+
+private:
+    template <std::size_t... Items>
+    auto unpack(std::size_t i, std::index_sequence<Items...>) const {
+        return std::make_tuple(get<Items>(i)...);
+    }
+
+    template <std::size_t Width, typename F>
+    auto for_each_code(std::uint32_t wanted, F &on_index) const
+        -> std::size_t {
+        std::size_t matched = 0;
+        for (std::size_t i = 0; i < count_; i++) {
+            if (detail::load_code(codes_ + i * Width, Width) == wanted) {
+                on_index(i);
+                matched++;
+            }
+        }
+        return matched;
+    }
+
+    std::size_t count_{0};
+    std::size_t entries_{0};
+    std::size_t width_{1};
+    const char *dictionary_{nullptr};
+    const char *codes_{nullptr};
+    const char *rest_{nullptr};
+};
+
+// Encodes the whole records of `packedInput` as a dictionary_batch with
+// item `Item`, an 's' item, dictionary encoded. Values get codes in order
+// of first appearance.
+template <std::size_t Item, typename Fmt, typename Input>
+auto encode_dictionary(Fmt, Input &&packedInput) -> std::string {
+    using batch = dictionary_batch<Fmt, Item>;
+    constexpr auto offset = getBinaryOffset<Item>(Fmt{});
+
+    const char *data = std::data(packedInput);
+    auto        count = std::size(packedInput) / batch::record_size;
+
+    std::unordered_map<std::string_view, std::uint32_t> codes;
+    std::string                                         dictionary;
+    std::vector<std::uint32_t>                          record_codes(count);
+    for (std::size_t i = 0; i < count; i++) {
+        auto value = std::string_view(
+            data + i * batch::record_size + offset, batch::item_size);
+        auto next = static_cast<std::uint32_t>(codes.size());
+        auto [it, added] = codes.try_emplace(value, next);
+        if (added) {
+            dictionary.append(value);
+        }
+        record_codes[i] = it->second;
+    }
+
+    auto entries = codes.size();
+    auto width = detail::code_width(entries);
+    auto encoded = std::string(batch::encoded_size(count, entries), '\0');
+    char *out = encoded.data();
+    out += struct_pack::pack_into(detail::dictionary_batch_header,
+                                  out,
+                                  detail::dictionary_batch_magic,
+                                  static_cast<std::uint32_t>(count),
+                                  static_cast<std::uint32_t>(entries),
+                                  static_cast<std::uint8_t>(width));
+    out = std::copy(dictionary.begin(), dictionary.end(), out);
+    for (auto code : record_codes) {
+        detail::store_code(out, code, width);
+        out += width;
+    }
+    for (std::size_t i = 0; i < count; i++) {
+        const char *record = data + i * batch::record_size;
+        out = std::copy_n(record, offset, out);
+        out = std::copy(record + offset + batch::item_size,
+                        record + batch::record_size,
+                        out);
+    }
+    return encoded;
+}
+
+} // namespace struct_pack
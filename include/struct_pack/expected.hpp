@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdexcept>
+#include <utility>
+#include <variant>
+
+#if __has_include(<expected>)
+#include <expected>
+#endif
+
+namespace struct_pack {
+
+#if defined(__cpp_lib_expected)
+
+template <typename T, typename E>
+using expected = std::expected<T, E>;
+
+template <typename E>
+using unexpected = std::unexpected<E>;
+
+#else
+
+// The subset of C++23 std::expected used by this library, for standard
+// libraries that do not ship <expected> yet
+template <typename E>
+class unexpected {
+public:
+    constexpr explicit unexpected(E error)
+        : error_{std::move(error)} {}
+
+    constexpr auto error() const -> const E & {
+        return error_;
+    }
+
+private:
+    E error_;
+};
+
+template <typename T, typename E>
+class expected {
+public:
+    using value_type = T;
+    using error_type = E;
+
+    constexpr expected(T value)
+        : storage_{std::in_place_index<0>, std::move(value)} {}
+
+    constexpr expected(unexpected<E> error)
+        : storage_{std::in_place_index<1>, error.error()} {}
+
+    constexpr auto has_value() const -> bool {
+        return storage_.index() == 0;
+    }
+
+    constexpr explicit operator bool() const {
+        return has_value();
+    }
+
+    constexpr auto value() const -> const T & {
+        if (!has_value()) {
+            throw std::logic_error("struct_pack::expected: no value");
+        }
+        return std::get<0>(storage_);
+    }
+
+    constexpr auto error() const -> const E & {
+        return std::get<1>(storage_);
+    }
+
+    constexpr auto operator*() const -> const T & {
+        return std::get<0>(storage_);
+    }
+
+    constexpr auto operator->() const -> const T * {
+        return &std::get<0>(storage_);
+    }
+
+private:
+    std::variant<T, E> storage_;
+};
+
+#endif
+
+} // namespace struct_pack
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <system_error>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Error helpers and write loops shared by everything that works on raw file
+// descriptors, mappings and encoded buffers
+
+namespace struct_pack {
+
+namespace detail {
+    [[noreturn]] inline void throw_errno(const char *what) {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    // For input that is not what it claims to be: a corrupt header, a
+    // format mismatch, a code past the dictionary
+    [[noreturn]] inline void throw_invalid(const char *what) {
+        throw std::system_error(
+            std::make_error_code(std::errc::invalid_argument), what);
+    }
+
+    // write(2) until everything is out, retrying on EINTR and short writes.
+    // `what` names the caller in the error; a write of nothing is EIO.
+    inline void
+    write_all(int fd, const char *data, std::size_t size, const char *what) {
+        while (size > 0) {
+            auto n = ::write(fd, data, size);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw_errno(what);
+            }
+            if (n == 0) {
+                throw std::system_error(EIO, std::generic_category(), what);
+            }
+            data += n;
+            size -= static_cast<std::size_t>(n);
+        }
+    }
+
+    // writev(2) until every iovec is consumed; `iov` is modified in place.
+    // As with write_all(), writing nothing while bytes remain is EIO.
+    inline void
+    writev_all(int fd, struct iovec *iov, int count, const char *what) {
+        while (true) {
+            while (count > 0 && iov->iov_len == 0) {
+                iov++;
+                count--;
+            }
+            if (count == 0) {
+                return;
+            }
+            auto n = ::writev(fd, iov, count);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw_errno(what);
+            }
+            if (n == 0) {
+                throw std::system_error(EIO, std::generic_category(), what);
+            }
+            auto written = static_cast<std::size_t>(n);
+            while (count > 0 && written >= iov->iov_len) {
+                written -= iov->iov_len;
+                iov++;
+                count--;
+            }
+            if (count > 0) {
+                iov->iov_base = static_cast<char *>(iov->iov_base) + written;
+                iov->iov_len -= written;
+            }
+        }
+    }
+} // namespace detail
+
+} // namespace struct_pack
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+
+#include "struct_pack/calcsize.hpp"
+#include "struct_pack/pack.hpp"
+#include "struct_pack/ring_buffer.hpp"
+#include "struct_pack/unpack.hpp"
+
+namespace struct_pack {
+
+// Frames are a length prefix (a single integer item such as "!I" or "!H")
+// holding the body size, followed by the body.
+
+namespace detail {
+    template <typename LengthFmt>
+    constexpr auto check_length_format() -> std::size_t {
+        static_assert(countItems(LengthFmt{}) == 1,
+                      "A frame length format holds exactly one item");
+        constexpr auto type = getTypeOfItem<0>(LengthFmt{});
+        static_assert(type.formatChar == 'B' || type.formatChar == 'H'
+                          || type.formatChar == 'I' || type.formatChar == 'L'
+                          || type.formatChar == 'Q',
+                      "A frame length must be an unsigned integer");
+        return struct_pack::calcsize(LengthFmt{});
+    }
+} // namespace detail
+
+// Size of a frame carrying one record of Fmt
+template <typename LengthFmt, typename Fmt>
+constexpr auto frame_size(LengthFmt /*unused*/, Fmt /*unused*/)
+    -> std::size_t {
+    return detail::check_length_format<LengthFmt>()
+           + struct_pack::calcsize(Fmt{});
+}
+
+// Packs the length prefix and a record of Fmt into `output`, which must hold
+// frame_size(LengthFmt{}, Fmt{}) bytes; returns the bytes written
+template <typename LengthFmt, typename Fmt, typename... Args>
+constexpr auto pack_frame(LengthFmt /*unused*/,
+                          Fmt /*unused*/,
+                          char *output,
+                          Args &&...args) -> std::size_t {
+    constexpr auto header_size = detail::check_length_format<LengthFmt>();
+    constexpr auto body_size = struct_pack::calcsize(Fmt{});
+    static_assert(header_size >= sizeof(std::uint64_t)
+                      || body_size >> (8 * header_size) == 0,
+                  "The record does not fit in the frame length prefix");
+    struct_pack::pack_into(LengthFmt{}, output, body_size);
+    struct_pack::pack_into(
+        Fmt{}, output + header_size, std::forward<Args>(args)...);
+    return header_size + body_size;
+}
+
+// Reassembles length-prefixed frames from a byte stream. Bytes land in a
+// mirrored ring buffer, so a frame is always contiguous and is handed out as
+// a view that can be passed to unpack() without copying.
+//
+//     auto decoder = struct_pack::frame_decoder<decltype("!I"_fmt)>(1 << 16);
+//     auto space = decoder.writable();
+//     decoder.commit(::read(fd, space.data(), space.size()));
+//     decoder.decode([](std::string_view body) { ... });
+template <typename LengthFmt>
+class frame_decoder {
+public:
+    static constexpr std::size_t header_size
+        = detail::check_length_format<LengthFmt>();
+
+    // The largest frame accepted is capacity() bytes, header included
+    explicit frame_decoder(std::size_t min_capacity)
+        : ring_{std::max(min_capacity, header_size)} {}
+
+    auto capacity() const -> std::size_t {
+        return ring_.capacity();
+    }
+
+    // Free space to receive into directly; follow with commit()
+    auto writable() -> std::span<char> {
+        return ring_.writable();
+    }
+
+    auto commit(std::size_t n) -> void {
+        ring_.commit(n);
+    }
+
+    // Invokes `on_frame` with the body of every complete frame, consuming
+    // them; returns how many there were. Bodies are only valid during the
+    // callback. Throws std::length_error for a frame that can never fit.
+    template <typename F>
+    auto decode(F &&on_frame) -> std::size_t {
+        STRUCT_PACK_TRACE_SPAN("frame_decoder::decode", "bulk");
+        std::size_t decoded = 0;
+        while (ring_.size() >= header_size) {
+            auto bytes = ring_.readable();
+            auto header = bytes.substr(0, header_size);
+            auto length = static_cast<std::size_t>(
+                std::get<0>(struct_pack::unpack(LengthFmt{}, header)));
+            // A hostile length near SIZE_MAX must not wrap the sum around
+            if (length > ring_.capacity() - header_size) {
+                throw std::length_error(
+                    "frame_decoder: frame larger than the ring buffer");
+            }
+            if (bytes.size() < header_size + length) {
+                break;
+            }
+            on_frame(bytes.substr(header_size, length));
+            ring_.consume(header_size + length);
+            decoded++;
+        }
+        return decoded;
+    }
+
+    // Copies `chunk` in, decoding as it goes so chunks larger than the free
+    // space are accepted
+    template <typename Input, typename F>
+    auto feed(Input &&chunk, F &&on_frame) -> std::size_t {
+        auto        data = std::string_view(std::data(chunk), std::size(chunk));
+        std::size_t decoded = 0;
+        while (!data.empty()) {
+            auto space = ring_.writable();
+            auto n = std::min(space.size(), data.size());
+            std::copy_n(data.data(), n, space.data());
+            ring_.commit(n);
+            data.remove_prefix(n);
+            decoded += decode(on_frame);
+        }
+        return decoded;
+    }
+
+    // Bytes of incomplete frames held until more input arrives
+    auto buffered() const -> std::size_t {
+        return ring_.size();
+    }
+
+private:
+    mirrored_ring_buffer ring_;
+};
+
+} // namespace struct_pack
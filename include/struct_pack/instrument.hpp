@@ -0,0 +1,329 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "struct_pack/pack.hpp"
+#include "struct_pack/unpack.hpp"
+
+// Per-format instrumentation. Calls made through struct_pack::instrumented
+// count calls, bytes and time spent per format string. Define
+// STRUCT_PACK_INSTRUMENTATION to 1 to compile it in; otherwise the
+// instrumented functions forward straight to the plain ones.
+#ifndef STRUCT_PACK_INSTRUMENTATION
+#define STRUCT_PACK_INSTRUMENTATION 0
+#endif
+
+namespace struct_pack {
+
+// Totals for one format, merged over every thread
+struct format_stats {
+    // Bucket i counts calls that took [2^i, 2^(i+1)) cycles
+    static constexpr std::size_t histogram_buckets = 32;
+
+    std::uint64_t packs{0};
+    std::uint64_t unpacks{0};
+    std::uint64_t unpack_failures{0};
+    std::uint64_t bytes_packed{0};
+    std::uint64_t bytes_unpacked{0};
+    std::array<std::uint64_t, histogram_buckets> cycle_histogram{};
+};
+
+namespace detail {
+    inline auto read_cycles() -> std::uint64_t {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(
+            std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    // A counter written by one thread and read by others. Updates are a
+    // plain load and store, not a locked read-modify-write.
+    struct shard_counter {
+        std::atomic<std::uint64_t> value{0};
+
+        void add(std::uint64_t n) {
+            value.store(value.load(std::memory_order_relaxed) + n,
+                        std::memory_order_relaxed);
+        }
+
+        auto get() const -> std::uint64_t {
+            return value.load(std::memory_order_relaxed);
+        }
+    };
+
+    struct shard_stats {
+        shard_counter packs;
+        shard_counter unpacks;
+        shard_counter unpack_failures;
+        shard_counter bytes_packed;
+        shard_counter bytes_unpacked;
+        std::array<shard_counter, format_stats::histogram_buckets> histogram;
+
+        void record_cycles(std::uint64_t cycles) {
+            auto bucket = cycles == 0 ? 0 : std::bit_width(cycles) - 1;
+            histogram[std::min<std::size_t>(
+                          bucket, format_stats::histogram_buckets - 1)]
+                .add(1);
+        }
+
+        void clear() {
+            for (auto *counter :
+                 {&packs, &unpacks, &unpack_failures, &bytes_packed,
+                  &bytes_unpacked}) {
+                counter->value.store(0, std::memory_order_relaxed);
+            }
+            for (auto &counter : histogram) {
+                counter.value.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        void merge_into(format_stats &stats) const {
+            stats.packs += packs.get();
+            stats.unpacks += unpacks.get();
+            stats.unpack_failures += unpack_failures.get();
+            stats.bytes_packed += bytes_packed.get();
+            stats.bytes_unpacked += bytes_unpacked.get();
+            for (std::size_t i = 0; i < histogram.size(); i++) {
+                stats.cycle_histogram[i] += histogram[i].get();
+            }
+        }
+    };
+} // namespace detail
+
+// Process-wide registry of per-format statistics. Every thread updates its
+// own shard without synchronization; snapshot() merges the shards.
+class format_registry {
+public:
+    static auto instance() -> format_registry & {
+        static format_registry registry;
+        return registry;
+    }
+
+    // Small dense id for a format, assigned on first use
+    template <typename Fmt>
+    auto id_of() -> std::size_t {
+        static const std::size_t id
+            = register_format(std::string_view(Fmt::value(), Fmt::size()));
+        return id;
+    }
+
+    // Statistics of the calling thread for format `id`
+    auto local(std::size_t id) -> detail::shard_stats & {
+        thread_local shard this_thread{*this};
+        if (id >= this_thread.stats.size()) {
+            auto lock = std::lock_guard{this_thread.mutex};
+            while (id >= this_thread.stats.size()) {
+                this_thread.stats.emplace_back();
+            }
+        }
+        return this_thread.stats[id];
+    }
+
+    auto snapshot() -> std::map<std::string, format_stats> {
+        auto lock = std::lock_guard{mutex_};
+        auto merged = retired_;
+        for (const auto *s : shards_) {
+            auto shard_lock = std::lock_guard{s->mutex};
+            for (std::size_t id = 0; id < s->stats.size(); id++) {
+                s->stats[id].merge_into(merged[names_[id]]);
+            }
+        }
+        return merged;
+    }
+
+    auto to_text() -> std::string {
+        std::ostringstream out;
+        for (const auto &[format, stats] : snapshot()) {
+            out << format << ": packs=" << stats.packs
+                << " unpacks=" << stats.unpacks
+                << " unpack_failures=" << stats.unpack_failures
+                << " bytes_packed=" << stats.bytes_packed
+                << " bytes_unpacked=" << stats.bytes_unpacked << " cycles=[";
+            write_histogram(out, stats);
+            out << "]\n";
+        }
+        return out.str();
+    }
+
+    auto to_json() -> std::string {
+        std::ostringstream out;
+        out << "{\"formats\":[";
+        auto first = true;
+        for (const auto &[format, stats] : snapshot()) {
+            if (!first) {
+                out << ',';
+            }
+            first = false;
+            out << "{\"format\":\"";
+            for (char ch : format) {
+                if (ch == '"' || ch == '\\') {
+                    out << '\\';
+                }
+                out << ch;
+            }
+            out << "\",\"packs\":" << stats.packs
+                << ",\"unpacks\":" << stats.unpacks
+                << ",\"unpack_failures\":" << stats.unpack_failures
+                << ",\"bytes_packed\":" << stats.bytes_packed
+                << ",\"bytes_unpacked\":" << stats.bytes_unpacked
+                << ",\"cycle_histogram\":[";
+            write_histogram(out, stats);
+            out << "]}";
+        }
+        out << "]}";
+        return out.str();
+    }
+
+    // Zeroes every counter; formats stay registered. An update racing with
+    // reset() may survive it.
+    void reset() {
+        auto lock = std::lock_guard{mutex_};
+        retired_.clear();
+        for (auto *s : shards_) {
+            auto shard_lock = std::lock_guard{s->mutex};
+            for (auto &stats : s->stats) {
+                stats.clear();
+            }
+        }
+    }
+
+private:
+    struct shard {
+        explicit shard(format_registry &r)
+            : registry{r} {
+            auto lock = std::lock_guard{registry.mutex_};
+            registry.shards_.push_back(this);
+        }
+
+        shard(const shard &) = delete;
+        auto operator=(const shard &) -> shard & = delete;
+
+        // Folds the totals of an exiting thread into the registry
+        ~shard() {
+            auto lock = std::lock_guard{registry.mutex_};
+            for (std::size_t id = 0; id < stats.size(); id++) {
+                stats[id].merge_into(registry.retired_[registry.names_[id]]);
+            }
+            std::erase(registry.shards_, this);
+        }
+
+        format_registry &registry;
+        // A deque so growing it never moves the counters being updated
+        std::deque<detail::shard_stats> stats;
+        mutable std::mutex              mutex;
+    };
+
+    auto register_format(std::string_view format) -> std::size_t {
+        auto lock = std::lock_guard{mutex_};
+        names_.emplace_back(format);
+        return names_.size() - 1;
+    }
+
+    static void write_histogram(std::ostringstream &out,
+                                const format_stats &stats) {
+        for (std::size_t i = 0; i < stats.cycle_histogram.size(); i++) {
+            out << (i == 0 ? "" : ",") << stats.cycle_histogram[i];
+        }
+    }
+
+    std::mutex                           mutex_;
+    std::deque<std::string>              names_;
+    std::vector<shard *>                 shards_;
+    std::map<std::string, format_stats> retired_;
+};
+
+namespace instrumented {
+
+    template <typename Fmt, typename... Args>
+    auto pack(Fmt fmt, Args &&...args) {
+#if STRUCT_PACK_INSTRUMENTATION
+        auto &stats = format_registry::instance().local(
+            format_registry::instance().id_of<Fmt>());
+        auto start = detail::read_cycles();
+        auto packed = struct_pack::pack(fmt, std::forward<Args>(args)...);
+        stats.record_cycles(detail::read_cycles() - start);
+        stats.packs.add(1);
+        stats.bytes_packed.add(packed.size());
+        return packed;
+#else
+        return struct_pack::pack(fmt, std::forward<Args>(args)...);
+#endif
+    }
+
+    template <typename Fmt, typename... Args>
+    auto pack_into(Fmt fmt, char *output, Args &&...args) -> std::size_t {
+#if STRUCT_PACK_INSTRUMENTATION
+        auto &stats = format_registry::instance().local(
+            format_registry::instance().id_of<Fmt>());
+        auto start = detail::read_cycles();
+        auto size
+            = struct_pack::pack_into(fmt, output, std::forward<Args>(args)...);
+        stats.record_cycles(detail::read_cycles() - start);
+        stats.packs.add(1);
+        stats.bytes_packed.add(size);
+        return size;
+#else
+        return struct_pack::pack_into(fmt, output, std::forward<Args>(args)...);
+#endif
+    }
+
+    template <typename Fmt, typename Input>
+    auto unpack(Fmt fmt, Input &&packedInput) {
+#if STRUCT_PACK_INSTRUMENTATION
+        auto &stats = format_registry::instance().local(
+            format_registry::instance().id_of<Fmt>());
+        auto start = detail::read_cycles();
+        auto unpacked
+            = struct_pack::unpack(fmt, std::forward<Input>(packedInput));
+        stats.record_cycles(detail::read_cycles() - start);
+        stats.unpacks.add(1);
+        stats.bytes_unpacked.add(struct_pack::calcsize(Fmt{}));
+        return unpacked;
+#else
+        return struct_pack::unpack(fmt, std::forward<Input>(packedInput));
+#endif
+    }
+
+    template <typename Fmt, typename Input>
+    auto try_unpack(Fmt fmt, Input &&packedInput) {
+#if STRUCT_PACK_INSTRUMENTATION
+        auto &stats = format_registry::instance().local(
+            format_registry::instance().id_of<Fmt>());
+        auto start = detail::read_cycles();
+        auto unpacked
+            = struct_pack::try_unpack(fmt, std::forward<Input>(packedInput));
+        stats.record_cycles(detail::read_cycles() - start);
+        if (unpacked) {
+            stats.unpacks.add(1);
+            stats.bytes_unpacked.add(struct_pack::calcsize(Fmt{}));
+        } else {
+            stats.unpack_failures.add(1);
+        }
+        return unpacked;
+#else
+        return struct_pack::try_unpack(fmt, std::forward<Input>(packedInput));
+#endif
+    }
+
+} // namespace instrumented
+
+} // namespace struct_pack
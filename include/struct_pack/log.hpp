@@ -1,12 +1,42 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
 #include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
 #include <format>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <source_location>
 #include <span>
+#include <string>
 #include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// The tracing machinery is only pulled in when it is enabled
+#if STRUCT_PACK_TRACE_EVENTS
+#include "struct_pack/trace_event.hpp"
+#else
+#define STRUCT_PACK_TRACE_SPAN(...)
+#endif
+
+// Messages below this level are compiled out, whatever set_level() says:
+// 0 = TRACE, 1 = DEBUG, 2 = INFO, 3 = WARN, 4 = ERROR, 5 = FATAL
+#ifndef PRINT_HPP_MIN_LOG_LEVEL
+#define PRINT_HPP_MIN_LOG_LEVEL 0
+#endif
 
 namespace print_hpp::log {
 
@@ -19,11 +49,40 @@ enum class LogLevel {
     FATAL,
 };
 
+inline constexpr auto min_level
+    = static_cast<LogLevel>(PRINT_HPP_MIN_LOG_LEVEL);
+
 enum class LogStyle {
     FG,
     BG,
 };
 
+enum class LogClock {
+    PRECISE, // std::chrono::system_clock
+    COARSE,  // CLOCK_REALTIME_COARSE: a few ms resolution, no clock read
+};
+
+// What an async logger does when the calling thread's queue is full
+enum class OverflowPolicy {
+    DROP,  // discard the message and count it
+    BLOCK, // wait for the background thread to make room
+};
+
+// Where formatted lines go instead of std::clog. write() receives whole lines
+// (or whole binary log records) and may be called from several threads at
+// once.
+class LogSink {
+public:
+    virtual ~LogSink() = default;
+    virtual void write(std::string_view lines) = 0;
+};
+
+struct AsyncOptions {
+    std::size_t               queue_size = 1024; // messages per thread
+    OverflowPolicy            overflow = OverflowPolicy::BLOCK;
+    std::chrono::milliseconds poll_interval{1}; // idle wake-up period
+};
+
 namespace detail {
     constexpr auto to_string(LogLevel level) noexcept -> std::string_view {
         using enum LogLevel;
@@ -98,10 +157,10 @@ namespace detail {
         }
     }
 
-    template <LogLevel Level>
-    auto function_name(std::source_location loc) noexcept -> std::string {
-        if constexpr (Level <= LogLevel::DEBUG) {
-            return std::format("|{}|", loc.function_name());
+    inline auto function_name(LogLevel level, std::string_view function)
+        -> std::string {
+        if (level <= LogLevel::DEBUG) {
+            return std::format("|{}|", function);
         } else {
             return {};
         }
@@ -117,11 +176,8 @@ namespace detail {
 
     template <int N, char c>
     inline auto to_int(uint64_t num, std::span<char> p, int &size) {
-        constexpr static std::array<char, 10> digits
-            = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9'};
-
         for (int i = 0; i < N; i++) {
-            p[--size] = digits.at(num % 10);
+            p[--size] = static_cast<char>('0' + num % 10);
             num = num / 10;
         }
 
@@ -149,8 +205,9 @@ namespace detail {
         }
 
         last_second = seconds;
-        auto tt = std::chrono::system_clock::to_time_t(now);
-        auto tm = localtime(&tt);
+        auto    tt = std::chrono::system_clock::to_time_t(now);
+        std::tm local{};
+        auto   *tm = localtime_r(&tt, &local);
 
         to_int<3, '.'>(milliseconds, buf, size);
         to_int<2, ':'>(tm->tm_sec, buf, size);
@@ -163,6 +220,24 @@ namespace detail {
         return buf.data();
     }
 
+    inline auto read_clock(LogClock clock)
+        -> std::chrono::system_clock::time_point {
+        using std::chrono::system_clock;
+#if defined(CLOCK_REALTIME_COARSE)
+        if (clock == LogClock::COARSE) {
+            timespec ts{};
+            clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+            return system_clock::time_point(
+                std::chrono::duration_cast<system_clock::duration>(
+                    std::chrono::seconds(ts.tv_sec)
+                    + std::chrono::nanoseconds(ts.tv_nsec)));
+        }
+#else
+        (void) clock;
+#endif
+        return system_clock::now();
+    }
+
     class FmtWithSourceLocation {
     public:
         template <typename T>
@@ -187,6 +262,395 @@ namespace detail {
         std::source_location source_location_;
     };
 
+    inline void write_lines(LogSink *sink, std::string_view lines) {
+        if (sink != nullptr) {
+            sink->write(lines);
+        } else {
+            std::clog.write(lines.data(),
+                            static_cast<std::streamsize>(lines.size()));
+            std::clog.flush();
+        }
+    }
+
+    // Everything between the timestamp and the message; it depends only on
+    // the call site, the level and the style
+    inline auto format_prefix(LogLevel            level,
+                              LogStyle            style,
+                              std::string_view    file,
+                              std::uint_least32_t line,
+                              std::string_view    function) -> std::string {
+        return std::format(" |{}{:<5}{}| {}{}:{}{}{} ",
+                           to_color(level, style),
+                           to_string(level),
+                           reset_color(),
+                           source_color(),
+                           file,
+                           line,
+                           function_name(level, function),
+                           reset_color());
+    }
+
+    // Prefixes of recently seen call sites, per thread, in a direct-mapped
+    // table keyed by the source location
+    inline auto cached_prefix(LogLevel             level,
+                              LogStyle             style,
+                              std::source_location loc) -> std::string_view {
+        struct Entry {
+            const char         *file{nullptr};
+            std::uint_least32_t line{0};
+            std::uint_least32_t column{0};
+            LogLevel            level{};
+            LogStyle            style{};
+            std::string         prefix;
+        };
+        thread_local std::array<Entry, 256> cache;
+
+        auto hash = (reinterpret_cast<std::uintptr_t>(loc.file_name()) >> 4)
+                    ^ (loc.line() * 0x9E3779B1U) ^ (loc.column() << 8)
+                    ^ (static_cast<std::uintptr_t>(level) << 2)
+                    ^ static_cast<std::uintptr_t>(style);
+        auto &entry = cache[hash % cache.size()];
+        if (entry.file != loc.file_name() || entry.line != loc.line()
+            || entry.column != loc.column() || entry.level != level
+            || entry.style != style) {
+            entry.file = loc.file_name();
+            entry.line = loc.line();
+            entry.column = loc.column();
+            entry.level = level;
+            entry.style = style;
+            entry.prefix = format_prefix(
+                level, style, loc.file_name(), loc.line(), loc.function_name());
+        }
+        return entry.prefix;
+    }
+
+    // Formats a whole line into `out` in one pass. On a format error `out` is
+    // left as it was and the exception propagates.
+    inline void append_line(std::string                          &out,
+                            std::chrono::system_clock::time_point now,
+                            std::string_view                      prefix,
+                            std::string_view                      fmt,
+                            std::format_args                      args) {
+        auto size = out.size();
+        try {
+            out.append(get_timestamp(now), 23);
+            out.append(prefix);
+            std::vformat_to(std::back_inserter(out), fmt, args);
+            out += '\n';
+        } catch (...) {
+            out.resize(size);
+            throw;
+        }
+    }
+
+    // Takes the call site as strings so lines can also be rebuilt from a
+    // binary log, where no std::source_location exists
+    inline auto format_line(LogLevel                              level,
+                            std::chrono::system_clock::time_point now,
+                            LogStyle                              style,
+                            std::string_view                      file,
+                            std::uint_least32_t                   line,
+                            std::string_view                      function,
+                            std::string_view message) -> std::string {
+        std::string out;
+        append_line(out,
+                    now,
+                    format_prefix(level, style, file, line, function),
+                    "{}",
+                    std::make_format_args(message));
+        return out;
+    }
+
+    // Arguments are copied into the queue and formatted later; strings are
+    // copied by value because the caller's buffer may be gone by then
+    template <typename T>
+    using async_capture_t
+        = std::conditional_t<std::is_convertible_v<const T &, std::string_view>,
+                             std::string,
+                             std::decay_t<T>>;
+
+    // One queued message. The arguments live in `args` and are formatted and
+    // destroyed by `render`.
+    struct AsyncRecord {
+        static constexpr std::size_t args_size = 192;
+
+        LogStyle                              style;
+        std::source_location                  source_location;
+        std::chrono::system_clock::time_point time;
+        std::string_view                      fmt;
+        void (*render)(AsyncRecord &record, std::string &out);
+        alignas(std::max_align_t) std::byte args[args_size];
+    };
+
+    // Single-producer single-consumer queue of one thread's messages
+    struct AsyncRing {
+        explicit AsyncRing(std::size_t capacity)
+            : records(std::bit_ceil(std::max<std::size_t>(capacity, 2))) {}
+
+        auto reserve() -> AsyncRecord * {
+            auto h = head.load(std::memory_order_relaxed);
+            if (h - tail.load(std::memory_order_acquire) == records.size()) {
+                return nullptr;
+            }
+            return &records[h & (records.size() - 1)];
+        }
+
+        void commit() {
+            head.store(head.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_release);
+        }
+
+        std::vector<AsyncRecord>   records;
+        std::atomic<std::uint64_t> head{0};
+        std::atomic<std::uint64_t> tail{0};
+        std::atomic<bool>          retired{false};
+    };
+
+    // Formats and writes queued messages on a background thread, in batches
+    // of everything that is pending
+    class AsyncBackend {
+    public:
+        AsyncBackend(AsyncOptions options, std::shared_ptr<LogSink> sink)
+            : options_{options}
+            , sink_{std::move(sink)}
+            , worker_{[this] {
+                run();
+            }} {}
+
+        AsyncBackend(const AsyncBackend &) = delete;
+        auto operator=(const AsyncBackend &) -> AsyncBackend & = delete;
+
+        // Writes out everything still queued
+        ~AsyncBackend() {
+            {
+                auto lock = std::lock_guard{mutex_};
+                stop_ = true;
+            }
+            wake_up_.notify_one();
+            worker_.join();
+        }
+
+        template <LogLevel Level, typename... Args>
+        void push(std::chrono::system_clock::time_point now,
+                  LogStyle                              style,
+                  std::string_view                      fmt,
+                  std::source_location                  source_location,
+                  const Args &...args) {
+            auto &ring = local_ring();
+            auto *record = ring.reserve();
+            while (record == nullptr) {
+                if (options_.overflow == OverflowPolicy::DROP) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                wake();
+                std::this_thread::yield();
+                record = ring.reserve();
+            }
+
+            using Captured = std::tuple<async_capture_t<Args>...>;
+            if constexpr (sizeof(Captured) <= AsyncRecord::args_size
+                          && alignof(Captured) <= alignof(std::max_align_t)) {
+                new (record->args) Captured(args...);
+                record->fmt = fmt;
+                record->render = &render<Level, Captured>;
+            } else {
+                // Too big to queue: format here and queue the text
+                using Formatted = std::tuple<std::string>;
+                new (record->args) Formatted(
+                    std::vformat(fmt, std::make_format_args(args...)));
+                record->fmt = "{}";
+                record->render = &render<Level, Formatted>;
+            }
+            record->style = style;
+            record->source_location = source_location;
+            record->time = now;
+            ring.commit();
+        }
+
+        // Blocks until every message queued before the call is written
+        void flush() {
+            std::vector<std::pair<std::shared_ptr<AsyncRing>, std::uint64_t>>
+                pending;
+            {
+                auto lock = std::lock_guard{mutex_};
+                for (const auto &ring : rings_) {
+                    pending.emplace_back(
+                        ring, ring->head.load(std::memory_order_acquire));
+                }
+            }
+            wake();
+            for (const auto &[ring, head] : pending) {
+                while (ring->tail.load(std::memory_order_acquire) < head) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+            }
+        }
+
+        auto dropped() const -> std::uint64_t {
+            return dropped_.load(std::memory_order_relaxed);
+        }
+
+        // Takes effect from the next batch
+        void set_sink(std::shared_ptr<LogSink> sink) {
+            auto lock = std::lock_guard{mutex_};
+            sink_ = std::move(sink);
+        }
+
+    private:
+        template <LogLevel Level, typename Captured>
+        static void render(AsyncRecord &record, std::string &out) {
+            auto *args
+                = std::launder(reinterpret_cast<Captured *>(record.args));
+            auto prefix
+                = cached_prefix(Level, record.style, record.source_location);
+            try {
+                std::apply(
+                    [&](const auto &...a) {
+                        append_line(out,
+                                    record.time,
+                                    prefix,
+                                    record.fmt,
+                                    std::make_format_args(a...));
+                    },
+                    *args);
+            } catch (const std::format_error &e) {
+                auto error = std::string(e.what());
+                append_line(out,
+                            record.time,
+                            prefix,
+                            "<format error: {}>",
+                            std::make_format_args(error));
+            }
+            args->~Captured();
+        }
+
+        // The calling thread's queue for this backend, created on its first
+        // message. A thread keeps one per backend it logs to, so switching
+        // between loggers is a lookup rather than a new queue.
+        auto local_ring() -> AsyncRing & {
+            struct Rings {
+                struct Entry {
+                    std::uint64_t              backend;
+                    std::shared_ptr<AsyncRing> ring;
+                };
+
+                Rings() = default;
+                Rings(const Rings &) = delete;
+                auto operator=(const Rings &) -> Rings & = delete;
+                ~Rings() {
+                    for (const auto &entry : entries) {
+                        entry.ring->retired.store(true,
+                                                  std::memory_order_release);
+                    }
+                }
+
+                std::vector<Entry> entries;
+            };
+            thread_local Rings rings;
+            for (const auto &entry : rings.entries) {
+                if (entry.backend == id_) {
+                    return *entry.ring;
+                }
+            }
+            // Forget the queues of backends that are gone: only this thread
+            // still holds them
+            std::erase_if(rings.entries, [](const auto &entry) {
+                return entry.ring.use_count() == 1;
+            });
+            auto ring = std::make_shared<AsyncRing>(options_.queue_size);
+            rings.entries.push_back({id_, ring});
+            auto lock = std::lock_guard{mutex_};
+            rings_.push_back(std::move(ring));
+            return *rings.entries.back().ring;
+        }
+
+        void wake() {
+            {
+                auto lock = std::lock_guard{mutex_};
+                wake_ = true;
+            }
+            wake_up_.notify_one();
+        }
+
+        void run() {
+            std::vector<std::shared_ptr<AsyncRing>> rings;
+            std::shared_ptr<LogSink>                sink;
+            std::string                             batch;
+            for (;;) {
+                bool stopping = false;
+                {
+                    auto lock = std::lock_guard{mutex_};
+                    stopping = stop_;
+                    sink = sink_;
+                    std::erase_if(rings_, [](const auto &ring) {
+                        return ring->retired.load(std::memory_order_acquire)
+                               && ring->tail.load(std::memory_order_relaxed)
+                                      == ring->head.load(
+                                          std::memory_order_acquire);
+                    });
+                    rings = rings_;
+                }
+                if (write_batch(rings, sink.get(), batch) > 0) {
+                    continue;
+                }
+                if (stopping) {
+                    return;
+                }
+                auto lock = std::unique_lock{mutex_};
+                wake_up_.wait_for(lock, options_.poll_interval, [this] {
+                    return stop_ || wake_;
+                });
+                wake_ = false;
+            }
+        }
+
+        // Formats every pending message into one write; queue slots are
+        // released only once their text is out
+        auto write_batch(const std::vector<std::shared_ptr<AsyncRing>> &rings,
+                         LogSink     *sink,
+                         std::string &batch) -> std::size_t {
+            std::size_t count = 0;
+            batch.clear();
+            ends_.clear();
+            for (const auto &ring : rings) {
+                auto t = ring->tail.load(std::memory_order_relaxed);
+                auto h = ring->head.load(std::memory_order_acquire);
+                auto mask = ring->records.size() - 1;
+                for (; t != h; t++) {
+                    auto &record = ring->records[t & mask];
+                    record.render(record, batch);
+                    count++;
+                }
+                ends_.emplace_back(ring.get(), h);
+            }
+            if (count > 0) {
+                write_lines(sink, batch);
+            }
+            for (auto [ring, h] : ends_) {
+                ring->tail.store(h, std::memory_order_release);
+            }
+            return count;
+        }
+
+        static auto next_id() -> std::uint64_t {
+            static std::atomic<std::uint64_t> id{0};
+            return ++id;
+        }
+
+        AsyncOptions                            options_;
+        std::shared_ptr<LogSink>                sink_;
+        std::uint64_t                           id_{next_id()};
+        std::mutex                              mutex_;
+        std::condition_variable                 wake_up_;
+        bool                                    stop_{false};
+        bool                                    wake_{false};
+        std::vector<std::shared_ptr<AsyncRing>> rings_;
+        std::vector<std::pair<AsyncRing *, std::uint64_t>> ends_;
+        std::atomic<std::uint64_t>                         dropped_{0};
+        std::thread                                        worker_;
+    };
+
     class ConsoleLogger {
     public:
         template <typename... Args>
@@ -240,32 +704,123 @@ namespace detail {
             style_ = style;
         }
 
+        auto set_clock(LogClock clock) {
+            clock_ = clock;
+        }
+
+        // Sends lines to `sink` instead of std::clog (nullptr restores it).
+        // Not safe to call while other threads are logging.
+        auto set_sink(std::shared_ptr<LogSink> sink) {
+            sink_ = std::move(sink);
+            if (async_) {
+                async_->set_sink(sink_);
+            }
+        }
+
+        // Whether a message at Level would be written. The LOG_* macros check
+        // this before evaluating any argument.
+        template <LogLevel Level>
+        auto enabled() const -> bool {
+            if constexpr (Level < min_level) {
+                return false;
+            } else {
+                return Level >= level_;
+            }
+        }
+
+        // Switches to asynchronous logging: callers only queue their
+        // arguments and a background thread formats and writes them. Not
+        // safe to call while other threads are logging, and the format
+        // string must outlive the call (string literals do). Fatal messages
+        // are flushed before they return.
+        auto enable_async(AsyncOptions options = {}) {
+            async_ = std::make_unique<AsyncBackend>(options, sink_);
+        }
+
+        // Writes out everything still queued and goes back to logging on the
+        // calling thread
+        auto disable_async() {
+            async_.reset();
+        }
+
+        // Waits until every message queued so far has been written
+        auto flush() {
+            if (async_) {
+                async_->flush();
+            }
+        }
+
+        // Messages discarded by OverflowPolicy::DROP
+        auto dropped() const -> std::uint64_t {
+            return async_ ? async_->dropped() : 0;
+        }
+
     private:
         template <LogLevel Level, typename... Args>
         auto log(FmtWithSourceLocation fwsl, const Args &...args) {
-            if (Level < level_) {
+            if (!enabled<Level>()) {
                 return;
             }
+            STRUCT_PACK_TRACE_SPAN(
+                "ConsoleLogger::log", "logger", "level", to_string(Level));
             auto fmt = fwsl.fmt();
             auto source_location = fwsl.source_location();
-            auto message = std::vformat(fmt, std::make_format_args(args...));
-            auto now = std::chrono::system_clock::now();
-            std::clog << std::format("{} |{}{:<5}{}| {}{}:{}{}{} {}\n",
-                                     get_timestamp(now),
-                                     to_color(Level, style_),
-                                     to_string(Level),
-                                     reset_color(),
-                                     source_color(),
-                                     source_location.file_name(),
-                                     source_location.line(),
-                                     function_name<Level>(source_location),
-                                     reset_color(),
-                                     message);
+            auto now = read_clock(clock_);
+            if (async_) {
+                async_->push<Level>(now, style_, fmt, source_location, args...);
+                if constexpr (Level == LogLevel::FATAL) {
+                    async_->flush();
+                }
+                return;
+            }
+
+            // Reused so a message costs no allocation once it has grown
+            thread_local std::string line;
+            line.clear();
+            append_line(line,
+                        now,
+                        cached_prefix(Level, style_, source_location),
+                        fmt,
+                        std::make_format_args(args...));
+            write_lines(sink_.get(), line);
+        }
+
+    private:
+        LogLevel                      level_{LogLevel::DEBUG};
+        LogStyle                      style_{LogStyle::FG};
+        LogClock                      clock_{LogClock::PRECISE};
+        std::shared_ptr<LogSink>      sink_;
+        std::unique_ptr<AsyncBackend> async_;
+    };
+
+    // Per-call-site state of LOG_EVERY_N; n of 0 or 1 logs every time
+    class EveryN {
+    public:
+        auto operator()(std::uint64_t n) -> bool {
+            auto count = count_.fetch_add(1, std::memory_order_relaxed);
+            return n == 0 || count % n == 0;
+        }
+
+    private:
+        std::atomic<std::uint64_t> count_{0};
+    };
+
+    // Per-call-site state of LOG_EVERY_MS; when several threads race for
+    // the same period only one of them logs
+    class EveryMs {
+    public:
+        auto operator()(std::int64_t ms) -> bool {
+            auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count();
+            auto next = next_.load(std::memory_order_relaxed);
+            return now >= next
+                   && next_.compare_exchange_strong(
+                       next, now + ms * 1'000'000, std::memory_order_relaxed);
         }
 
     private:
-        LogLevel level_{LogLevel::DEBUG};
-        LogStyle style_{LogStyle::FG};
+        std::atomic<std::int64_t> next_{0};
     };
 
 } // namespace detail
@@ -0,0 +1,324 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "struct_pack/log.hpp"
+
+namespace print_hpp::log {
+
+// Segments are named path.0, path.1, ...; files left by an earlier run with
+// the same path are overwritten
+struct FileSinkOptions {
+    std::string               path;
+    std::size_t               segment_size = 64 << 20;
+    std::chrono::milliseconds max_age{0};  // rotate after this long; 0: never
+    std::size_t               max_files = 0; // newest segments kept; 0: all
+};
+
+// A LogSink that copies lines into a memory-mapped, preallocated file
+// segment: a write is an atomic reservation and a memcpy, with no syscall.
+// A background thread keeps the next segment mapped, so rotating by size or
+// age is a pointer swap, and it trims finished segments to their used size.
+//
+//     auto sink = std::make_shared<print_hpp::log::MmapFileSink>(
+//         print_hpp::log::FileSinkOptions{.path = "/var/log/app.log"});
+//     print_hpp::log::console.set_sink(sink);
+class MmapFileSink : public LogSink {
+public:
+    explicit MmapFileSink(FileSinkOptions options)
+        : options_{std::move(options)} {
+        current_.store(open_segment());
+        worker_ = std::thread([this] {
+            run();
+        });
+    }
+
+    MmapFileSink(const MmapFileSink &) = delete;
+    auto operator=(const MmapFileSink &) -> MmapFileSink & = delete;
+
+    // Trims and closes every segment; the standby segment is removed
+    ~MmapFileSink() override {
+        {
+            auto lock = std::lock_guard{mutex_};
+            stop_ = true;
+        }
+        wake_up_.notify_one();
+        worker_.join();
+
+        retired_.push_back(current_.load());
+        for (auto *segment : retired_) {
+            finish(*segment);
+        }
+        retired_.clear();
+        if (standby_ != nullptr) {
+            discard(*standby_);
+        }
+    }
+
+    // A write larger than a segment is split after its last line break
+    // that fits; a single line that does not fit is dropped
+    void write(std::string_view lines) override {
+        while (lines.size() > options_.segment_size) {
+            auto end = lines.rfind('\n', options_.segment_size - 1);
+            if (end == std::string_view::npos) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            store(lines.substr(0, end + 1));
+            lines.remove_prefix(end + 1);
+        }
+        if (!lines.empty()) {
+            store(lines);
+        }
+    }
+
+    // Writes that could not be stored: a line larger than a segment, or no
+    // new segment could be created
+    auto dropped() const -> std::uint64_t {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    // Segments retired so far
+    auto rotations() const -> std::uint64_t {
+        return rotations_.load(std::memory_order_relaxed);
+    }
+
+    // Asks the kernel to write the current segment back now
+    void sync() {
+        auto *segment = current_.load();
+        auto  used = segment->used.load(std::memory_order_acquire);
+        auto  page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        if (::msync(segment->data, (used + page - 1) / page * page, MS_SYNC)
+            != 0) {
+            throw std::system_error(
+                errno, std::generic_category(), "MmapFileSink: msync");
+        }
+    }
+
+    auto segment_path(std::uint64_t index) const -> std::string {
+        return options_.path + "." + std::to_string(index);
+    }
+
+private:
+    struct Segment {
+        std::uint64_t                         index;
+        int                                   fd;
+        char                                 *data;
+        std::chrono::steady_clock::time_point opened;
+        std::atomic<std::size_t>              reserved{0};
+        std::atomic<std::size_t>              used{0};
+        std::atomic<int>                      writers{0};
+    };
+
+    void store(std::string_view lines) {
+        for (;;) {
+            auto *segment = current_.load();
+            // Announce the write, then make sure the segment was not
+            // retired in the meantime; the finisher waits for writers == 0
+            segment->writers.fetch_add(1);
+            if (current_.load() != segment) {
+                segment->writers.fetch_sub(1, std::memory_order_release);
+                continue;
+            }
+            auto offset = segment->reserved.fetch_add(
+                lines.size(), std::memory_order_relaxed);
+            if (offset + lines.size() <= options_.segment_size) {
+                std::memcpy(
+                    segment->data + offset, lines.data(), lines.size());
+                segment->used.fetch_add(lines.size(),
+                                        std::memory_order_relaxed);
+                segment->writers.fetch_sub(1, std::memory_order_release);
+                return;
+            }
+            segment->writers.fetch_sub(1, std::memory_order_release);
+            if (!rotate(segment)) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+
+    // Called with segments_mutex_ held (or before the thread starts), so
+    // segments are numbered in the order they are used
+    auto open_segment() -> Segment * {
+        auto index = next_index_++;
+        auto path = segment_path(index);
+        int  fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw std::system_error(
+                errno, std::generic_category(), "MmapFileSink: open");
+        }
+        auto size = static_cast<off_t>(options_.segment_size);
+        // Reserve the blocks up front where the file system can, so page
+        // faults on the hot path never have to allocate them
+        if (::posix_fallocate(fd, 0, size) != 0 && ::ftruncate(fd, size) != 0) {
+            auto error = errno;
+            ::close(fd);
+            throw std::system_error(
+                error, std::generic_category(), "MmapFileSink: ftruncate");
+        }
+        void *data = ::mmap(nullptr,
+                            options_.segment_size,
+                            PROT_READ | PROT_WRITE,
+                            MAP_SHARED,
+                            fd,
+                            0);
+        if (data == MAP_FAILED) {
+            auto error = errno;
+            ::close(fd);
+            throw std::system_error(
+                error, std::generic_category(), "MmapFileSink: mmap");
+        }
+
+        auto &segment = segments_.emplace_back(std::make_unique<Segment>());
+        segment->index = index;
+        segment->fd = fd;
+        segment->data = static_cast<char *>(data);
+        segment->opened = std::chrono::steady_clock::now();
+        return segment.get();
+    }
+
+    // Replaces `full` with the standby segment, or a new one if the
+    // background thread has not made it yet. Returns false if `full` is
+    // still current because no segment could be created.
+    auto rotate(Segment *full) -> bool {
+        auto lock = std::lock_guard{segments_mutex_};
+        if (current_.load() != full) {
+            return true;
+        }
+        auto *next = std::exchange(standby_, nullptr);
+        if (next == nullptr) {
+            try {
+                next = open_segment();
+            } catch (const std::system_error &) {
+                return false;
+            }
+        }
+        next->opened = std::chrono::steady_clock::now();
+        current_.store(next);
+        {
+            auto retired_lock = std::lock_guard{mutex_};
+            retired_.push_back(full);
+        }
+        rotations_.fetch_add(1, std::memory_order_relaxed);
+        wake_up_.notify_one();
+        return true;
+    }
+
+    // Unmaps a retired segment, trims the file to what was written and
+    // removes the segments that fell out of max_files. Called by the
+    // background thread, or by the destructor once it has stopped.
+    void finish(Segment &segment) {
+        ::munmap(segment.data, options_.segment_size);
+        segment.data = nullptr;
+        ::ftruncate(segment.fd,
+                    static_cast<off_t>(
+                        segment.used.load(std::memory_order_acquire)));
+        ::close(segment.fd);
+        segment.fd = -1;
+        if (options_.max_files == 0) {
+            return;
+        }
+        // Keep the newest max_files, counting the current segment
+        auto newest = std::max(current_.load()->index, segment.index);
+        for (; removed_ + options_.max_files <= newest; removed_++) {
+            ::unlink(segment_path(removed_).c_str());
+        }
+    }
+
+    void discard(Segment &segment) {
+        ::munmap(segment.data, options_.segment_size);
+        ::close(segment.fd);
+        ::unlink(segment_path(segment.index).c_str());
+        segment.fd = -1;
+    }
+
+    void run() {
+        for (;;) {
+            std::vector<Segment *> finished;
+            {
+                auto lock = std::unique_lock{mutex_};
+                wake_up_.wait_for(lock, poll_interval, [this] {
+                    return stop_ || !retired_.empty();
+                });
+                if (stop_) {
+                    return;
+                }
+                // Pairs with the writers' increment-then-check in write()
+                std::erase_if(retired_, [&](Segment *segment) {
+                    if (segment->writers.load() != 0) {
+                        return false;
+                    }
+                    finished.push_back(segment);
+                    return true;
+                });
+            }
+            for (auto *segment : finished) {
+                finish(*segment);
+            }
+
+            {
+                auto lock = std::lock_guard{segments_mutex_};
+                if (standby_ == nullptr) {
+                    try {
+                        standby_ = open_segment();
+                    } catch (const std::system_error &) {
+                        // A writer tries again when it needs one
+                    }
+                }
+            }
+
+            auto *segment = current_.load();
+            if (options_.max_age.count() > 0
+                && segment->used.load(std::memory_order_relaxed) > 0
+                && std::chrono::steady_clock::now() - segment->opened
+                       >= options_.max_age) {
+                rotate(segment);
+            }
+        }
+    }
+
+    static constexpr std::chrono::milliseconds poll_interval{10};
+
+    FileSinkOptions            options_;
+    std::atomic<Segment *>     current_{nullptr};
+    std::atomic<std::uint64_t> dropped_{0};
+    std::atomic<std::uint64_t> rotations_{0};
+    std::uint64_t              removed_{0}; // segments below this are gone
+
+    // Rotation and segment creation. Segment objects live as long as the
+    // sink: a writer may still touch the counters of one it saw as current
+    // just before a rotation.
+    std::mutex                           segments_mutex_;
+    std::uint64_t                        next_index_{0};
+    Segment                             *standby_{nullptr};
+    std::deque<std::unique_ptr<Segment>> segments_;
+
+    std::mutex              mutex_;
+    std::condition_variable wake_up_;
+    bool                    stop_{false};
+    std::vector<Segment *>  retired_;
+    std::thread             worker_;
+};
+
+} // namespace print_hpp::log
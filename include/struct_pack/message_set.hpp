@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <tuple>
+
+#include "struct_pack/calcsize.hpp"
+#include "struct_pack/unpack.hpp"
+
+namespace struct_pack {
+
+// One entry of a message_set: messages tagged `Id` carry a record of Fmt
+template <std::uint64_t Id, typename Fmt>
+struct message {
+    static constexpr std::uint64_t id = Id;
+    static constexpr std::size_t   size = struct_pack::calcsize(Fmt{});
+    using format = Fmt;
+};
+
+enum class dispatch_status {
+    ok,
+    unknown_tag,
+    truncated, // more input is needed; `size` says how much, if known
+};
+
+struct dispatch_result {
+    dispatch_status status;
+    std::size_t     size; // tag + body bytes of the message
+
+    constexpr explicit operator bool() const {
+        return status == dispatch_status::ok;
+    }
+};
+
+// Decodes messages that start with a tag (a single unsigned integer item,
+// e.g. "B" or "<H") selecting the format of the body that follows.
+// Dispatch is one table lookup and one indirect call, however many messages
+// there are: small tags index a dense table directly, sparse tags go through
+// a multiplicative perfect hash found at compile time.
+//
+//     using messages = struct_pack::message_set<decltype("B"_fmt),
+//         struct_pack::message<1, decltype("<Iq"_fmt)>,
+//         struct_pack::message<2, decltype("<8s"_fmt)>>;
+//     messages::dispatch(input, [](auto msg, const auto &record) {
+//         if constexpr (decltype(msg)::id == 1) { ... }
+//     });
+template <typename Tag, typename... Messages>
+class message_set {
+    static_assert(countItems(Tag{}) == 1,
+                  "A tag format holds exactly one item");
+    static_assert(getTypeOfItem<0>(Tag{}).formatChar == 'B'
+                      || getTypeOfItem<0>(Tag{}).formatChar == 'H'
+                      || getTypeOfItem<0>(Tag{}).formatChar == 'I'
+                      || getTypeOfItem<0>(Tag{}).formatChar == 'L'
+                      || getTypeOfItem<0>(Tag{}).formatChar == 'Q',
+                  "A tag must be an unsigned integer");
+    static_assert(sizeof...(Messages) > 0, "A message set cannot be empty");
+
+    static constexpr std::size_t num_messages = sizeof...(Messages);
+    static constexpr std::array<std::uint64_t, num_messages> ids
+        = {Messages::id...};
+
+    static constexpr auto unique_ids() -> bool {
+        for (std::size_t i = 0; i < num_messages; i++) {
+            for (std::size_t j = i + 1; j < num_messages; j++) {
+                if (ids[i] == ids[j]) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    static_assert(unique_ids(), "Message ids must be unique");
+
+    static constexpr std::uint64_t max_id = *std::max_element(ids.begin(),
+                                                              ids.end());
+    static constexpr bool dense
+        = max_id < std::max<std::uint64_t>(256, 4 * num_messages);
+
+    struct hash_params {
+        std::size_t   size;
+        std::uint64_t multiplier;
+        unsigned      shift;
+    };
+
+    static constexpr auto hash(std::uint64_t id, hash_params params)
+        -> std::size_t {
+        return static_cast<std::size_t>((id * params.multiplier)
+                                        >> params.shift);
+    }
+
+    // Tries odd multipliers for growing power-of-two tables until every id
+    // lands in its own slot
+    static constexpr auto find_hash() -> hash_params {
+        auto min_size = std::max<std::size_t>(2, std::bit_ceil(num_messages));
+        for (auto size = min_size; size <= 256 * min_size; size *= 2) {
+            auto shift = 64 - static_cast<unsigned>(std::countr_zero(size));
+            for (std::uint64_t k = 1; k <= 256; k++) {
+                // splitmix64 of k, forced odd
+                auto z = k * 0x9E3779B97F4A7C15ULL;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                auto params = hash_params{size, (z ^ (z >> 31)) | 1, shift};
+
+                bool collision = false;
+                for (std::size_t i = 0; i < num_messages && !collision; i++) {
+                    for (std::size_t j = i + 1; j < num_messages; j++) {
+                        if (hash(ids[i], params) == hash(ids[j], params)) {
+                            collision = true;
+                            break;
+                        }
+                    }
+                }
+                if (!collision) {
+                    return params;
+                }
+            }
+        }
+        return {0, 0, 0};
+    }
+
+    static constexpr hash_params params
+        = dense ? hash_params{static_cast<std::size_t>(max_id) + 1, 1, 0}
+                : find_hash();
+    static_assert(params.size != 0, "No perfect hash found for message ids");
+
+    static constexpr auto slot(std::uint64_t id) -> std::size_t {
+        if constexpr (dense) {
+            return static_cast<std::size_t>(id);
+        } else {
+            return hash(id, params);
+        }
+    }
+
+    template <typename Visitor>
+    struct entry {
+        std::uint64_t id;
+        std::size_t   size;
+        void (*decode)(Visitor &, const char *);
+    };
+
+    template <typename Visitor, typename Message>
+    static auto decode(Visitor &visitor, const char *body) -> void {
+        visitor(Message{},
+                struct_pack::unpack(typename Message::format{},
+                                    std::string_view(body, Message::size)));
+    }
+
+    template <typename Visitor>
+    static constexpr auto table = [] {
+        std::array<entry<Visitor>, params.size> t{};
+        ((t[slot(Messages::id)]
+          = {Messages::id, Messages::size, &decode<Visitor, Messages>}),
+         ...);
+        return t;
+    }();
+
+public:
+    static constexpr std::size_t tag_size = struct_pack::calcsize(Tag{});
+
+    // Number of slots in the dispatch table
+    static constexpr std::size_t table_size = params.size;
+
+    // Reads the tag at the start of `input`, unpacks the matching body and
+    // calls `visitor(message<Id, Fmt>{}, record)`. Input length is checked
+    // once against the size of the selected message.
+    template <typename Input, typename Visitor>
+    static auto dispatch(Input &&input, Visitor &&visitor) -> dispatch_result {
+        using V = std::remove_reference_t<Visitor>;
+        auto bytes = std::string_view(std::data(input), std::size(input));
+        if (bytes.size() < tag_size) {
+            return {dispatch_status::truncated, 0};
+        }
+        auto id = static_cast<std::uint64_t>(
+            std::get<0>(struct_pack::unpack(Tag{}, bytes)));
+
+        auto index = slot(id);
+        if (index >= table<V>.size()) {
+            return {dispatch_status::unknown_tag, 0};
+        }
+        const auto &e = table<V>[index];
+        if (e.decode == nullptr || e.id != id) {
+            return {dispatch_status::unknown_tag, 0};
+        }
+        if (bytes.size() < tag_size + e.size) {
+            return {dispatch_status::truncated, tag_size + e.size};
+        }
+        e.decode(visitor, bytes.data() + tag_size);
+        return {dispatch_status::ok, tag_size + e.size};
+    }
+
+    static constexpr auto uses_dense_table() -> bool {
+        return dense;
+    }
+};
+
+} // namespace struct_pack
@@ -12,4 +12,15 @@ auto new_pack(Args &&...args) {
     return Fmt::pack(std::make_index_sequence<N>{},
                      std::forward<Args>(args)...);
 }
+
+// new_pack reporting to `tracer`, e.g. a struct_pack::recording_tracer
+template <string_container container, typename Tracer, typename... Args>
+auto new_pack_traced(Tracer &tracer, Args &&...args) {
+    using Fmt = detail::fmt_string<container>;
+    constexpr size_t N = Fmt::count_items();
+    static_assert(N == sizeof...(args), "Parameter number does not match");
+
+    return Fmt::pack(
+        tracer, std::make_index_sequence<N>{}, std::forward<Args>(args)...);
+}
 } // namespace struct_pack
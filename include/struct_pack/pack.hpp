@@ -4,11 +4,24 @@
 #include "struct_pack/calcsize.hpp"
 #include "struct_pack/data_view.hpp"
 
+// The tracing machinery is only pulled in when it is enabled
+#if STRUCT_PACK_TRACE_EVENTS
+#include "struct_pack/trace_event.hpp"
+#else
+#define STRUCT_PACK_TRACE_SPAN(...)
+#endif
+
 namespace struct_pack {
 
 template <typename Fmt, typename... Args>
 constexpr auto pack(Fmt formatString, Args &&...args);
 
+// Packs into caller-owned memory of at least calcsize(Fmt{}) bytes, returning
+// the number of bytes written
+template <typename Fmt, typename... Args>
+constexpr auto pack_into(Fmt formatString, char *output, Args &&...args)
+    -> std::size_t;
+
 // Impl
 namespace detail {
     template <typename RepType>
@@ -18,6 +31,10 @@ namespace detail {
             // Trim the string size to the repeat count specified in the format
             elem = std::string_view(elem.data(),
                                     std::min(elem.size(), format.size));
+            // The output may be a reused buffer, so clear the unused tail
+            for (size_t i = elem.size(); i < format.size; i++) {
+                data[i] = '\0';
+            }
         } else {
             (void) format; // Unreferenced if constexpr RepType != string_view
         }
@@ -44,15 +61,13 @@ namespace detail {
     }
 
     template <typename Fmt, size_t... Items, typename... Args>
-    constexpr auto pack(std::index_sequence<Items...>, Args &&...args) {
+    constexpr void
+    packInto(char *output, std::index_sequence<Items...>, Args &&...args) {
         static_assert(
             sizeof...(args) == sizeof...(Items),
             "pack expected items for packing != sizeof...(args) passed");
         constexpr auto formatMode = struct_pack::getFormatMode(Fmt{});
 
-        using ArrayType = std::array<char, struct_pack::calcsize(Fmt{})>;
-        ArrayType output{};
-
         constexpr FormatType formats[]
             = {struct_pack::getTypeOfItem<Items>(Fmt{})...};
         using Types = std::tuple<typename struct_pack::RepresentedType<
@@ -65,21 +80,52 @@ namespace detail {
 
         constexpr size_t offsets[] = {getBinaryOffset<Items>(Fmt{})...};
         int              _[] = {0,
-                                packElement(output.data() + offsets[Items],
+                                packElement(output + offsets[Items],
                                formatMode.isBigEndian(),
                                formats[Items],
                                std::get<Items>(t))...};
         (void) _; // _ is a dummy for pack expansion
 
+        // Zero the alignment padding between items
+        if constexpr (formatMode.shouldPad()) {
+            for (size_t i = 0; i + 1 < sizeof...(Items); i++) {
+                for (size_t b = offsets[i] + formats[i].size;
+                     b < offsets[i + 1];
+                     b++) {
+                    output[b] = '\0';
+                }
+            }
+        }
+    }
+
+    template <typename Fmt, size_t... Items, typename... Args>
+    constexpr auto pack(std::index_sequence<Items...> items, Args &&...args) {
+        using ArrayType = std::array<char, struct_pack::calcsize(Fmt{})>;
+        ArrayType output{};
+
+        packInto<Fmt>(output.data(), items, std::forward<Args>(args)...);
+
         return output;
     }
 } // namespace detail
 
 template <typename Fmt, typename... Args>
 constexpr auto pack(Fmt /*unused*/, Args &&...args) {
+    STRUCT_PACK_TRACE_SPAN("pack", "struct_pack", "format", Fmt::value());
     constexpr size_t itemCount = countItems(Fmt{});
     return detail::pack<Fmt>(std::make_index_sequence<itemCount>(),
                              std::forward<Args>(args)...);
 }
 
+template <typename Fmt, typename... Args>
+constexpr auto pack_into(Fmt /*unused*/, char *output, Args &&...args)
+    -> std::size_t {
+    STRUCT_PACK_TRACE_SPAN("pack_into", "struct_pack", "format", Fmt::value());
+    constexpr size_t itemCount = countItems(Fmt{});
+    detail::packInto<Fmt>(output,
+                          std::make_index_sequence<itemCount>(),
+                          std::forward<Args>(args)...);
+    return struct_pack::calcsize(Fmt{});
+}
+
 } // namespace struct_pack
@@ -0,0 +1,294 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <utility>
+
+#include <sys/mman.h>
+
+#include "struct_pack/calcsize.hpp"
+#include "struct_pack/pack.hpp"
+#include "struct_pack/record_view.hpp"
+
+namespace struct_pack {
+
+enum class buffer_pages {
+    normal,
+    huge, // transparent huge pages once the buffer reaches huge_page_size
+};
+
+namespace detail {
+    inline constexpr std::size_t huge_page_size = std::size_t{2} << 20;
+
+    // A cache-line aligned byte buffer. Small ones come from the heap;
+    // with buffer_pages::huge, large ones are anonymous mappings advised
+    // for transparent huge pages, which grow with mremap() instead of a
+    // copy.
+    class record_storage {
+    public:
+        static constexpr std::size_t alignment = 64;
+
+        record_storage() = default;
+
+        record_storage(record_storage &&other) noexcept
+            : data_{std::exchange(other.data_, nullptr)}
+            , capacity_{std::exchange(other.capacity_, 0)}
+            , mapped_{std::exchange(other.mapped_, false)} {}
+
+        auto operator=(record_storage &&other) noexcept -> record_storage & {
+            std::swap(data_, other.data_);
+            std::swap(capacity_, other.capacity_);
+            std::swap(mapped_, other.mapped_);
+            return *this;
+        }
+
+        ~record_storage() {
+            release();
+        }
+
+        auto data() const -> char * {
+            return data_;
+        }
+
+        auto capacity() const -> std::size_t {
+            return capacity_;
+        }
+
+        auto mapped() const -> bool {
+            return mapped_;
+        }
+
+        // Grows to at least `capacity` bytes, keeping the first `used`
+        auto grow(std::size_t capacity, std::size_t used, buffer_pages pages)
+            -> void {
+            if (pages == buffer_pages::huge && capacity >= huge_page_size) {
+                capacity = (capacity + huge_page_size - 1) / huge_page_size
+                           * huge_page_size;
+                if (mapped_) {
+                    remap(capacity);
+                } else {
+                    auto next = record_storage::map(capacity);
+                    std::memcpy(next.data_, data_, used);
+                    *this = std::move(next);
+                }
+                return;
+            }
+            auto next = record_storage();
+            next.data_ = static_cast<char *>(
+                ::operator new(capacity, std::align_val_t{alignment}));
+            next.capacity_ = capacity;
+            if (used > 0) {
+                std::memcpy(next.data_, data_, used);
+            }
+            *this = std::move(next);
+        }
+
+    private:
+        static auto map(std::size_t capacity) -> record_storage {
+            void *data = ::mmap(nullptr,
+                                capacity,
+                                PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS,
+                                -1,
+                                0);
+            if (data == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            // Only a hint: without THP support the pages stay small
+            ::madvise(data, capacity, MADV_HUGEPAGE);
+            auto storage = record_storage();
+            storage.data_ = static_cast<char *>(data);
+            storage.capacity_ = capacity;
+            storage.mapped_ = true;
+            return storage;
+        }
+
+        auto remap(std::size_t capacity) -> void {
+            void *data = ::mremap(data_, capacity_, capacity, MREMAP_MAYMOVE);
+            if (data == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            ::madvise(data, capacity, MADV_HUGEPAGE);
+            data_ = static_cast<char *>(data);
+            capacity_ = capacity;
+        }
+
+        auto release() -> void {
+            if (data_ == nullptr) {
+                return;
+            }
+            if (mapped_) {
+                ::munmap(data_, capacity_);
+            } else {
+                ::operator delete(data_, std::align_val_t{alignment});
+            }
+            data_ = nullptr;
+            capacity_ = 0;
+        }
+
+        char       *data_{nullptr};
+        std::size_t capacity_{0};
+        bool        mapped_{false};
+    };
+} // namespace detail
+
+// Packed records handed out by record_builder::release(). It owns the
+// builder's buffer, so nothing was copied to produce it.
+template <typename Fmt>
+class record_buffer {
+public:
+    static constexpr std::size_t record_size = struct_pack::calcsize(Fmt{});
+
+    record_buffer() = default;
+
+    record_buffer(detail::record_storage storage, std::size_t records)
+        : storage_{std::move(storage)}
+        , records_{records} {}
+
+    auto data() const -> const char * {
+        return storage_.data();
+    }
+
+    // Number of records
+    auto size() const -> std::size_t {
+        return records_;
+    }
+
+    auto empty() const -> bool {
+        return records_ == 0;
+    }
+
+    auto bytes() const -> std::string_view {
+        return {storage_.data(), records_ * record_size};
+    }
+
+    auto operator[](std::size_t i) const -> record_view<Fmt> {
+        return record_view<Fmt>(storage_.data() + i * record_size);
+    }
+
+private:
+    detail::record_storage storage_;
+    std::size_t            records_{0};
+};
+
+// Builds a batch of records of one format by packing each straight into a
+// contiguous, cache-line aligned buffer that grows geometrically.
+//
+//     auto builder = struct_pack::record_builder<decltype("<Iq"_fmt)>();
+//     builder.reserve(n);
+//     for (...) {
+//         builder.append(id, value);
+//     }
+//     write(fd, builder.bytes().data(), builder.bytes().size());
+//
+// With buffer_pages::huge, a buffer of 2 MiB or more is an anonymous
+// mapping advised with MADV_HUGEPAGE, which cuts TLB misses over large
+// batches and lets growth move pages instead of copying them.
+template <typename Fmt>
+class record_builder {
+public:
+    static constexpr std::size_t record_size = struct_pack::calcsize(Fmt{});
+
+    explicit record_builder(buffer_pages pages = buffer_pages::normal)
+        : pages_{pages} {}
+
+    record_builder(std::size_t records, buffer_pages pages)
+        : pages_{pages} {
+        reserve(records);
+    }
+
+    template <typename... Args>
+    auto append(Args &&...args) -> void {
+        if (size_ + record_size > storage_.capacity()) {
+            grow(size_ + record_size);
+        }
+        size_ += struct_pack::pack_into(
+            Fmt{}, storage_.data() + size_, std::forward<Args>(args)...);
+    }
+
+    // Adds `records` records for the caller to fill in place; returns the
+    // first of them
+    auto allocate(std::size_t records = 1) -> char * {
+        auto bytes = records * record_size;
+        if (size_ + bytes > storage_.capacity()) {
+            grow(size_ + bytes);
+        }
+        char *data = storage_.data() + size_;
+        size_ += bytes;
+        return data;
+    }
+
+    // Room for `records` records in total without growing
+    auto reserve(std::size_t records) -> void {
+        if (records * record_size > storage_.capacity()) {
+            storage_.grow(records * record_size, size_, pages_);
+        }
+    }
+
+    // Number of records
+    auto size() const -> std::size_t {
+        return size_ / record_size;
+    }
+
+    auto empty() const -> bool {
+        return size_ == 0;
+    }
+
+    auto capacity() const -> std::size_t {
+        return storage_.capacity() / record_size;
+    }
+
+    // Whether the buffer is currently a huge-page mapping
+    auto huge_pages() const -> bool {
+        return storage_.mapped();
+    }
+
+    auto data() const -> const char * {
+        return storage_.data();
+    }
+
+    auto bytes() const -> std::string_view {
+        return {storage_.data(), size_};
+    }
+
+    auto operator[](std::size_t i) const -> record_view<Fmt> {
+        return record_view<Fmt>(storage_.data() + i * record_size);
+    }
+
+    // Forgets the records and keeps the buffer
+    auto clear() -> void {
+        size_ = 0;
+    }
+
+    // Forgets every record after the first `records`
+    auto truncate(std::size_t records) -> void {
+        size_ = std::min(size_, records * record_size);
+    }
+
+    // Hands the buffer over; the builder starts again empty
+    auto release() -> record_buffer<Fmt> {
+        auto records = size();
+        size_ = 0;
+        return record_buffer<Fmt>(std::exchange(storage_, {}), records);
+    }
+
+private:
+    auto grow(std::size_t needed) -> void {
+        storage_.grow(std::max({needed,
+                                2 * storage_.capacity(),
+                                initial_capacity * record_size}),
+                      size_,
+                      pages_);
+    }
+
+    static constexpr std::size_t initial_capacity = 64;
+
+    detail::record_storage storage_;
+    std::size_t            size_{0};
+    buffer_pages           pages_;
+};
+
+} // namespace struct_pack
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+
+#include "struct_pack/calcsize.hpp"
+#include "struct_pack/pack.hpp"
+#include "struct_pack/record_view.hpp"
+#include "struct_pack/unpack.hpp"
+
+namespace struct_pack {
+
+enum class ring_producers {
+    single,
+    multiple,
+};
+
+// A bounded queue of records of one format for handing data between
+// threads. Records are stored packed, back to back, in a cache-line aligned
+// ring: producers pack_into() a reserved slot and the consumer reads it in
+// place, so nothing is allocated or copied in between. There is always one
+// consumer thread; with ring_producers::multiple any number of threads may
+// produce.
+//
+//     auto ring = struct_pack::record_ring<decltype("<Iq"_fmt)>(1024);
+//     ring.push(1, 2);                    // producer thread
+//     ring.consume([](auto record) {      // consumer thread
+//         auto id = record.template get<0>();
+//     });
+template <typename Fmt, ring_producers Producers = ring_producers::single>
+class record_ring {
+public:
+    static constexpr std::size_t record_size = struct_pack::calcsize(Fmt{});
+    static constexpr std::size_t cache_line = 64;
+
+    // Slots reserved by a producer; every one of them must be filled before
+    // commit()
+    struct reservation {
+        char         *data;
+        std::size_t   count;
+        std::uint64_t position;
+    };
+
+    // Capacity is `min_records` rounded up to a power of two
+    explicit record_ring(std::size_t min_records)
+        : capacity_{std::bit_ceil(std::max<std::size_t>(min_records, 2))}
+        , slots_{new (std::align_val_t{cache_line})
+                     char[capacity_ * record_size]} {
+        if constexpr (Producers == ring_producers::multiple) {
+            ready_ = std::make_unique<std::atomic<std::uint64_t>[]>(capacity_);
+        }
+    }
+
+    record_ring(const record_ring &) = delete;
+    auto operator=(const record_ring &) -> record_ring & = delete;
+
+    auto capacity() const -> std::size_t {
+        return capacity_;
+    }
+
+    // Records reserved and not yet released; exact only when both sides
+    // are idle
+    auto size() const -> std::size_t {
+        const auto &head
+            = Producers == ring_producers::single ? head_ : claim_;
+        return static_cast<std::size_t>(
+            head.load(std::memory_order_acquire)
+            - tail_.load(std::memory_order_acquire));
+    }
+
+    auto empty() const -> bool {
+        return size() == 0;
+    }
+
+    // Producer side
+
+    // Reserves up to `max_records` contiguous slots. Fewer are returned near
+    // the end of the ring or when it is nearly full; none when it is full.
+    auto try_reserve(std::size_t max_records = 1) -> reservation {
+        if constexpr (Producers == ring_producers::single) {
+            auto head = head_.load(std::memory_order_relaxed);
+            if (head + max_records > tail_cache_ + capacity_) {
+                tail_cache_ = tail_.load(std::memory_order_acquire);
+            }
+            auto count = std::min({max_records,
+                                   static_cast<std::size_t>(
+                                       tail_cache_ + capacity_ - head),
+                                   capacity_ - offset(head)});
+            return {slot(head), count, head};
+        } else {
+            auto claim = claim_.load(std::memory_order_relaxed);
+            std::size_t count = 0;
+            do {
+                auto tail = tail_.load(std::memory_order_acquire);
+                count = std::min(
+                    {max_records,
+                     static_cast<std::size_t>(tail + capacity_ - claim),
+                     capacity_ - offset(claim)});
+                if (count == 0) {
+                    return {slot(claim), 0, claim};
+                }
+            } while (!claim_.compare_exchange_weak(
+                claim, claim + count, std::memory_order_relaxed));
+            return {slot(claim), count, claim};
+        }
+    }
+
+    // Publishes a filled reservation to the consumer. With several
+    // producers every slot is flagged on its own, so no producer waits for
+    // another; the consumer stops at the first slot not committed yet.
+    auto commit(const reservation &r) -> void {
+        if constexpr (Producers == ring_producers::single) {
+            head_.store(r.position + r.count, std::memory_order_release);
+        } else {
+            for (std::size_t i = 0; i < r.count; i++) {
+                ready_[offset(r.position + i)].store(
+                    r.position + i + 1, std::memory_order_release);
+            }
+        }
+    }
+
+    // Packs one record into the ring; false if it is full
+    template <typename... Args>
+    auto try_push(Args &&...args) -> bool {
+        auto r = try_reserve(1);
+        if (r.count == 0) {
+            return false;
+        }
+        struct_pack::pack_into(Fmt{}, r.data, std::forward<Args>(args)...);
+        commit(r);
+        return true;
+    }
+
+    // Packs one record, waiting for room if the ring is full
+    template <typename... Args>
+    auto push(Args &&...args) -> void {
+        for (std::size_t spins = 0; !try_push(args...); spins++) {
+            if (spins >= spin_limit) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Consumer side
+
+    // Committed records that are contiguous in memory, up to `max_records`.
+    // They stay valid until release().
+    auto peek(std::size_t max_records
+              = std::numeric_limits<std::size_t>::max()) -> record_batch<Fmt> {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        auto limit = std::min(max_records, capacity_ - offset(tail));
+        if constexpr (Producers == ring_producers::single) {
+            if (head_cache_ == tail) {
+                head_cache_ = head_.load(std::memory_order_acquire);
+            }
+            return {slot(tail),
+                    std::min(limit,
+                             static_cast<std::size_t>(head_cache_ - tail))};
+        } else {
+            // A slot holds position + 1 once the record at `position` is in
+            std::size_t count = 0;
+            while (count < limit
+                   && ready_[offset(tail + count)].load(
+                          std::memory_order_acquire)
+                          == tail + count + 1) {
+                count++;
+            }
+            return {slot(tail), count};
+        }
+    }
+
+    // Gives the first `count` peeked slots back to the producers
+    auto release(std::size_t count) -> void {
+        tail_.store(tail_.load(std::memory_order_relaxed) + count,
+                    std::memory_order_release);
+    }
+
+    // Calls `on_record` with a record_view of every available record, up to
+    // `max_records`, and releases them. Returns how many there were.
+    template <typename F>
+    auto consume(F        &&on_record,
+                 std::size_t max_records
+                 = std::numeric_limits<std::size_t>::max()) -> std::size_t {
+        std::size_t consumed = 0;
+        while (consumed < max_records) {
+            auto batch = peek(max_records - consumed);
+            if (batch.empty()) {
+                break;
+            }
+            for (std::size_t i = 0; i < batch.size(); i++) {
+                on_record(batch[i]);
+            }
+            release(batch.size());
+            consumed += batch.size();
+        }
+        return consumed;
+    }
+
+    // Unpacks and releases the oldest record. Its 's' items come back as
+    // std::string, since producers may overwrite the slot once released.
+    auto try_pop() -> std::optional<detail::owned_record_t<Fmt>> {
+        auto batch = peek(1);
+        if (batch.empty()) {
+            return std::nullopt;
+        }
+        auto record = detail::own_strings(batch[0].unpack());
+        release(1);
+        return record;
+    }
+
+private:
+    // Busy-wait iterations before yielding the CPU
+    static constexpr std::size_t spin_limit = 64;
+
+    struct aligned_delete {
+        auto operator()(char *p) const -> void {
+            ::operator delete[](p, std::align_val_t{cache_line});
+        }
+    };
+
+    auto offset(std::uint64_t position) const -> std::size_t {
+        return static_cast<std::size_t>(position & (capacity_ - 1));
+    }
+
+    auto slot(std::uint64_t position) const -> char * {
+        return slots_.get() + offset(position) * record_size;
+    }
+
+    std::size_t                                  capacity_;
+    std::unique_ptr<char[], aligned_delete>      slots_;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> ready_; // multiple only
+
+    // Each side's counters on its own cache line, next to its cached copy of
+    // the other side's, so the hot paths rarely touch a shared line
+    alignas(cache_line) std::atomic<std::uint64_t> head_{0}; // single
+    std::uint64_t tail_cache_{0};
+    alignas(cache_line) std::atomic<std::uint64_t> claim_{0}; // multiple
+    alignas(cache_line) std::atomic<std::uint64_t> tail_{0};
+    std::uint64_t head_cache_{0}; // single
+};
+
+} // namespace struct_pack
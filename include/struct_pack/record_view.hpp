@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#include "struct_pack/calcsize.hpp"
+#include "struct_pack/unpack.hpp"
+
+namespace struct_pack {
+
+namespace detail {
+    template <typename T>
+    auto own_item(const T &item) {
+        if constexpr (std::is_same_v<T, std::string_view>) {
+            return std::string(item);
+        } else {
+            return item;
+        }
+    }
+
+    // An unpacked record with its strings copied out of the packed bytes,
+    // for records whose slot is reused once released
+    template <typename Tuple>
+    auto own_strings(const Tuple &record) {
+        return std::apply(
+            [](const auto &...items) {
+                return std::make_tuple(own_item(items)...);
+            },
+            record);
+    }
+
+    template <typename Fmt>
+    using owned_record_t = decltype(own_strings(
+        struct_pack::unpack(Fmt{}, std::string_view{})));
+} // namespace detail
+
+// A packed record read in place. get<I>() decodes a single item, so a
+// consumer only pays for the fields it looks at.
+template <typename Fmt>
+class record_view {
+public:
+    static constexpr std::size_t record_size = struct_pack::calcsize(Fmt{});
+
+    constexpr explicit record_view(const char *data)
+        : data_{data} {}
+
+    template <std::size_t Item>
+    constexpr auto get() const {
+        constexpr auto formatMode = struct_pack::getFormatMode(Fmt{});
+        constexpr auto format = struct_pack::getTypeOfItem<Item>(Fmt{});
+        using Type = struct_pack::RepresentedType<decltype(formatMode),
+                                                  format.formatChar>;
+        return unpackElement<Item, Type>(data_
+                                             + getBinaryOffset<Item>(Fmt{}),
+                                         format.size,
+                                         formatMode.isBigEndian());
+    }
+
+    constexpr auto unpack() const {
+        return struct_pack::unpack(Fmt{}, bytes());
+    }
+
+    constexpr auto bytes() const -> std::string_view {
+        return {data_, record_size};
+    }
+
+private:
+    const char *data_;
+};
+
+// Contiguous packed records handed to a consumer
+template <typename Fmt>
+class record_batch {
+public:
+    static constexpr std::size_t record_size = struct_pack::calcsize(Fmt{});
+
+    record_batch(const char *data, std::size_t count)
+        : data_{data}
+        , count_{count} {}
+
+    auto size() const -> std::size_t {
+        return count_;
+    }
+
+    auto empty() const -> bool {
+        return count_ == 0;
+    }
+
+    auto operator[](std::size_t i) const -> record_view<Fmt> {
+        return record_view<Fmt>(data_ + i * record_size);
+    }
+
+    auto bytes() const -> std::string_view {
+        return {data_, count_ * record_size};
+    }
+
+private:
+    const char *data_;
+    std::size_t count_;
+};
+
+} // namespace struct_pack
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <system_error>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "struct_pack/calcsize.hpp"
+#include "struct_pack/fd_io.hpp"
+#include "struct_pack/pack.hpp"
+
+namespace struct_pack {
+
+// Buffers packed records of a single format and writes them to a file
+// descriptor in large batches. The descriptor is borrowed, not owned.
+//
+//     auto writer = struct_pack::record_writer<decltype("<Iq"_fmt)>(fd);
+//     writer.write(1, 2);
+//     writer.flush();
+template <typename Fmt>
+class record_writer {
+public:
+    static constexpr std::size_t record_size = struct_pack::calcsize(Fmt{});
+    static constexpr std::size_t default_buffer_size = 1 << 16;
+
+    // `flush_threshold` is the number of buffered bytes that triggers a
+    // write; 0 means "when the buffer is full"
+    explicit record_writer(int         fd,
+                           std::size_t buffer_size = default_buffer_size,
+                           std::size_t flush_threshold = 0)
+        : fd_{fd}
+        , capacity_{std::max(buffer_size, record_size)}
+        , threshold_{flush_threshold == 0
+                         ? capacity_
+                         : std::clamp(flush_threshold, record_size, capacity_)}
+        , buffer_{std::make_unique<char[]>(capacity_)} {}
+
+    record_writer(const record_writer &) = delete;
+    auto operator=(const record_writer &) -> record_writer & = delete;
+
+    ~record_writer() {
+        try {
+            flush();
+        } catch (const std::system_error &) {
+            // Nowhere to report it; call flush() explicitly to observe errors
+        }
+    }
+
+    // Packs one record straight into the buffer
+    template <typename... Args>
+    auto write(Args &&...args) -> void {
+        if (size_ + record_size > capacity_) {
+            flush();
+        }
+        size_ += struct_pack::pack_into(
+            Fmt{}, buffer_.get() + size_, std::forward<Args>(args)...);
+        records_++;
+        if (size_ >= threshold_) {
+            flush();
+        }
+    }
+
+    // Appends records that are already packed; `size` must be a multiple of
+    // record_size. Large batches go out together with the buffered bytes in a
+    // single writev(2) instead of being copied into the buffer.
+    auto write_packed(const char *data, std::size_t size) -> void {
+        STRUCT_PACK_TRACE_SPAN("record_writer::write_packed", "bulk");
+        if (size % record_size != 0) {
+            detail::throw_invalid("record_writer: partial record");
+        }
+        if (size_ + size <= capacity_) {
+            std::copy_n(data, size, buffer_.get() + size_);
+            size_ += size;
+            records_ += size / record_size;
+            if (size_ >= threshold_) {
+                flush();
+            }
+            return;
+        }
+
+        // As in flush(), drop the buffered bytes first: after a failed
+        // writev the destructor must not write them again
+        auto pending = size_;
+        size_ = 0;
+        struct iovec iov[2]
+            = {{buffer_.get(), pending}, {const_cast<char *>(data), size}};
+        detail::writev_all(fd_, iov, 2, "record_writer: writev");
+        bytes_ += pending + size;
+        records_ += size / record_size;
+    }
+
+    // Hands buffered records to the kernel
+    auto flush() -> void {
+        if (size_ == 0) {
+            return;
+        }
+        STRUCT_PACK_TRACE_SPAN("record_writer::flush", "bulk");
+        // Drop the buffered bytes first so a failing descriptor cannot make
+        // the destructor retry forever
+        auto pending = size_;
+        size_ = 0;
+        detail::write_all(fd_, buffer_.get(), pending, "record_writer: write");
+        bytes_ += pending;
+    }
+
+    // flush() and then wait for the data to reach the device
+    auto sync() -> void {
+        flush();
+        if (::fdatasync(fd_) != 0) {
+            detail::throw_errno("record_writer: fdatasync");
+        }
+    }
+
+    // Records accepted so far, including those still buffered
+    auto records_written() const -> std::size_t {
+        return records_;
+    }
+
+    // Bytes handed to the kernel so far
+    auto bytes_written() const -> std::size_t {
+        return bytes_;
+    }
+
+    auto buffered_bytes() const -> std::size_t {
+        return size_;
+    }
+
+private:
+    int                     fd_;
+    std::size_t             capacity_;
+    std::size_t             threshold_;
+    std::unique_ptr<char[]> buffer_;
+    std::size_t             size_{0};
+    std::size_t             records_{0};
+    std::size_t             bytes_{0};
+};
+
+} // namespace struct_pack
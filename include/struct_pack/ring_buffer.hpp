@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <system_error>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "struct_pack/fd_io.hpp"
+
+namespace struct_pack {
+
+// A byte ring whose storage is mapped twice back to back, so any readable or
+// writable region is contiguous in memory even when it wraps around the end
+// of the ring. Capacity is a power of two and a multiple of the page size.
+// Not thread-safe.
+class mirrored_ring_buffer {
+public:
+    explicit mirrored_ring_buffer(std::size_t min_capacity) {
+        auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        capacity_ = std::bit_ceil(std::max(min_capacity, page));
+
+        int fd = ::memfd_create("struct_pack_ring", MFD_CLOEXEC);
+        if (fd < 0) {
+            detail::throw_errno("mirrored_ring_buffer: memfd_create");
+        }
+        if (::ftruncate(fd, static_cast<off_t>(capacity_)) != 0) {
+            ::close(fd);
+            detail::throw_errno("mirrored_ring_buffer: ftruncate");
+        }
+
+        // Reserve twice the address space, then map the file over each half
+        auto *reserved = ::mmap(nullptr,
+                                2 * capacity_,
+                                PROT_NONE,
+                                MAP_PRIVATE | MAP_ANONYMOUS,
+                                -1,
+                                0);
+        if (reserved == MAP_FAILED) {
+            ::close(fd);
+            detail::throw_errno("mirrored_ring_buffer: mmap");
+        }
+        base_ = static_cast<char *>(reserved);
+        for (auto *half : {base_, base_ + capacity_}) {
+            if (::mmap(half,
+                       capacity_,
+                       PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_FIXED,
+                       fd,
+                       0)
+                == MAP_FAILED) {
+                ::munmap(base_, 2 * capacity_);
+                ::close(fd);
+                detail::throw_errno("mirrored_ring_buffer: mmap");
+            }
+        }
+        ::close(fd);
+    }
+
+    mirrored_ring_buffer(const mirrored_ring_buffer &) = delete;
+    auto operator=(const mirrored_ring_buffer &)
+        -> mirrored_ring_buffer & = delete;
+
+    ~mirrored_ring_buffer() {
+        ::munmap(base_, 2 * capacity_);
+    }
+
+    auto capacity() const -> std::size_t {
+        return capacity_;
+    }
+
+    // Bytes written but not yet consumed
+    auto size() const -> std::size_t {
+        return static_cast<std::size_t>(write_ - read_);
+    }
+
+    auto empty() const -> bool {
+        return write_ == read_;
+    }
+
+    auto readable() const -> std::string_view {
+        return {base_ + offset(read_), size()};
+    }
+
+    // Free space to receive into directly, e.g. with read(2)
+    auto writable() -> std::span<char> {
+        return {base_ + offset(write_), capacity_ - size()};
+    }
+
+    // Marks `n` bytes of writable() as filled
+    auto commit(std::size_t n) -> void {
+        write_ += n;
+    }
+
+    // Releases `n` bytes from the front of readable()
+    auto consume(std::size_t n) -> void {
+        read_ += n;
+    }
+
+private:
+    auto offset(std::uint64_t position) const -> std::size_t {
+        return static_cast<std::size_t>(position & (capacity_ - 1));
+    }
+
+    char         *base_{nullptr};
+    std::size_t   capacity_{0};
+    std::uint64_t read_{0};
+    std::uint64_t write_{0};
+};
+
+} // namespace struct_pack
@@ -0,0 +1,485 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <limits>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "struct_pack/calcsize.hpp"
+#include "struct_pack/fd_io.hpp"
+#include "struct_pack/pack.hpp"
+#include "struct_pack/record_view.hpp"
+#include "struct_pack/unpack.hpp"
+
+namespace struct_pack {
+
+namespace detail {
+    // The start of a channel's shared memory. Everything in it is either
+    // written once before the channel is shared or an address-free atomic,
+    // so it can be mapped at different addresses in different processes.
+    struct shm_channel_header {
+        static constexpr std::uint64_t magic_value = 0x31434d48534b5053;
+        static constexpr std::uint32_t current_version = 1;
+        static constexpr std::size_t   max_format_size = 128;
+
+        std::atomic<std::uint64_t> magic{0}; // set last by the creator
+        std::uint32_t              version{current_version};
+        std::uint32_t              record_size{0};
+        std::uint64_t              capacity{0};
+        std::uint32_t              format_size{0};
+        char                       format[max_format_size]{};
+
+        // Producer side: published records, and a futex word bumped to wake
+        // a consumer waiting for them
+        alignas(64) std::atomic<std::uint64_t> head{0};
+        std::atomic<std::uint32_t> readable{0};
+        std::atomic<std::uint32_t> consumer_waiting{0};
+
+        // Consumer side: released records, and the futex word a producer
+        // waits on for space
+        alignas(64) std::atomic<std::uint64_t> tail{0};
+        std::atomic<std::uint32_t> writable{0};
+        std::atomic<std::uint32_t> producer_waiting{0};
+    };
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free
+                      && std::atomic<std::uint32_t>::is_always_lock_free,
+                  "shm_channel needs address-free atomics");
+
+    // Shared (not process-private) futex calls on a 32-bit atomic
+    inline void futex_wait(std::atomic<std::uint32_t> &word,
+                           std::uint32_t               expected,
+                           const timespec             *timeout) {
+        ::syscall(SYS_futex,
+                  reinterpret_cast<std::uint32_t *>(&word),
+                  FUTEX_WAIT,
+                  expected,
+                  timeout,
+                  nullptr,
+                  0);
+    }
+
+    inline void futex_wake(std::atomic<std::uint32_t> &word) {
+        ::syscall(SYS_futex,
+                  reinterpret_cast<std::uint32_t *>(&word),
+                  FUTEX_WAKE,
+                  std::numeric_limits<int>::max(),
+                  nullptr,
+                  nullptr,
+                  0);
+    }
+
+    // Bumps `word` and wakes its waiters if the other side said it is
+    // waiting; a plain load when it is not, so no syscall per record
+    inline void notify(std::atomic<std::uint32_t> &waiting,
+                       std::atomic<std::uint32_t> &word) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_relaxed) != 0) {
+            word.fetch_add(1, std::memory_order_release);
+            futex_wake(word);
+        }
+    }
+
+    // Sleeps on `word` until `ready` holds or `timeout` passes. A wake-up
+    // can be stale (a bump meant for an earlier wait), so `ready` is checked
+    // again after each one rather than trusted.
+    template <typename Ready>
+    auto wait_until_ready(std::atomic<std::uint32_t> &waiting,
+                          std::atomic<std::uint32_t> &word,
+                          std::chrono::nanoseconds    timeout,
+                          Ready                     &&ready) -> bool {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        waiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (true) {
+            auto seen = word.load(std::memory_order_acquire);
+            if (ready()) {
+                break;
+            }
+            auto left = deadline - std::chrono::steady_clock::now();
+            if (left <= std::chrono::nanoseconds::zero()) {
+                break;
+            }
+            auto seconds
+                = std::chrono::duration_cast<std::chrono::seconds>(left);
+            auto ts = timespec{
+                static_cast<std::time_t>(seconds.count()),
+                static_cast<long>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        left - seconds)
+                        .count())};
+            futex_wait(word, seen, &ts);
+        }
+        waiting.store(0, std::memory_order_relaxed);
+        return ready();
+    }
+} // namespace detail
+
+// A single-producer single-consumer ring of packed records of one format in
+// shared memory, for handing records between two processes without a
+// syscall or a copy per record. The producer packs straight into the ring
+// and the consumer reads records in place through record_view; either side
+// only enters the kernel to sleep when the ring is empty or full.
+//
+// The memory starts with a header holding the format string and
+// calcsize(Fmt{}), which attach() checks, so both processes must agree on
+// the format.
+//
+//     // feed handler
+//     auto channel = struct_pack::shm_channel<Fmt>::create("/ticks", 4096);
+//     channel.push(id, price);
+//
+//     // strategy
+//     auto channel = struct_pack::shm_channel<Fmt>::attach("/ticks");
+//     channel.wait(std::chrono::milliseconds(100));
+//     channel.consume([](auto record) { ... });
+template <typename Fmt>
+class shm_channel {
+public:
+    static constexpr std::size_t record_size = struct_pack::calcsize(Fmt{});
+
+    static_assert(Fmt::size() <= detail::shm_channel_header::max_format_size,
+                  "shm_channel stores formats of up to 128 characters");
+
+    // Slots reserved by the producer; every one of them must be filled
+    // before commit()
+    struct reservation {
+        char         *data;
+        std::size_t   count;
+        std::uint64_t position;
+    };
+
+    // A new anonymous channel; pass fd() to the other process, e.g. across
+    // fork() or over a Unix socket with SCM_RIGHTS
+    static auto create(std::size_t min_records) -> shm_channel {
+        int fd = ::memfd_create("struct_pack_shm_channel", MFD_CLOEXEC);
+        if (fd < 0) {
+            detail::throw_errno("shm_channel: memfd_create");
+        }
+        return initialize(fd, min_records);
+    }
+
+    // A new channel under a POSIX shared memory name such as "/ticks". It
+    // must not exist yet; remove it with unlink() when done.
+    static auto create(const std::string &name, std::size_t min_records)
+        -> shm_channel {
+        int fd = ::shm_open(
+            name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (fd < 0) {
+            detail::throw_errno("shm_channel: shm_open");
+        }
+        return initialize(fd, min_records);
+    }
+
+    // Maps a channel made by create(); `fd` is duplicated, not taken over.
+    // Throws std::system_error with errc::invalid_argument if it is not a
+    // channel of Fmt.
+    static auto attach(int fd) -> shm_channel {
+        int own = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (own < 0) {
+            detail::throw_errno("shm_channel: dup");
+        }
+        return map_existing(own);
+    }
+
+    static auto attach(const std::string &name) -> shm_channel {
+        int fd = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+        if (fd < 0) {
+            detail::throw_errno("shm_channel: shm_open");
+        }
+        return map_existing(fd);
+    }
+
+    static auto unlink(const std::string &name) -> void {
+        if (::shm_unlink(name.c_str()) != 0) {
+            detail::throw_errno("shm_channel: shm_unlink");
+        }
+    }
+
+    shm_channel(shm_channel &&other) noexcept
+        : fd_{std::exchange(other.fd_, -1)}
+        , mapping_{std::exchange(other.mapping_, nullptr)}
+        , mapping_size_{other.mapping_size_}
+        , header_{other.header_}
+        , slots_{other.slots_}
+        , capacity_{other.capacity_}
+        , head_cache_{other.head_cache_}
+        , tail_cache_{other.tail_cache_} {}
+
+    auto operator=(shm_channel &&other) noexcept -> shm_channel & {
+        std::swap(fd_, other.fd_);
+        std::swap(mapping_, other.mapping_);
+        std::swap(mapping_size_, other.mapping_size_);
+        std::swap(header_, other.header_);
+        std::swap(slots_, other.slots_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(head_cache_, other.head_cache_);
+        std::swap(tail_cache_, other.tail_cache_);
+        return *this;
+    }
+
+    ~shm_channel() {
+        if (mapping_ != nullptr) {
+            ::munmap(mapping_, mapping_size_);
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    auto fd() const -> int {
+        return fd_;
+    }
+
+    auto capacity() const -> std::size_t {
+        return capacity_;
+    }
+
+    // Records published and not yet released
+    auto size() const -> std::size_t {
+        return static_cast<std::size_t>(
+            header_->head.load(std::memory_order_acquire)
+            - header_->tail.load(std::memory_order_acquire));
+    }
+
+    auto empty() const -> bool {
+        return size() == 0;
+    }
+
+    // Producer side
+
+    // Up to `max_records` contiguous free slots; none when the ring is full
+    auto try_reserve(std::size_t max_records = 1) -> reservation {
+        auto head = header_->head.load(std::memory_order_relaxed);
+        if (head + max_records > tail_cache_ + capacity_) {
+            tail_cache_ = header_->tail.load(std::memory_order_acquire);
+        }
+        auto count = std::min(
+            {max_records,
+             static_cast<std::size_t>(tail_cache_ + capacity_ - head),
+             capacity_ - offset(head)});
+        return {slot(head), count, head};
+    }
+
+    // Publishes a filled reservation, waking the consumer if it sleeps
+    auto commit(const reservation &r) -> void {
+        header_->head.store(r.position + r.count, std::memory_order_release);
+        detail::notify(header_->consumer_waiting, header_->readable);
+    }
+
+    template <typename... Args>
+    auto try_push(Args &&...args) -> bool {
+        auto r = try_reserve(1);
+        if (r.count == 0) {
+            return false;
+        }
+        struct_pack::pack_into(Fmt{}, r.data, std::forward<Args>(args)...);
+        commit(r);
+        return true;
+    }
+
+    // Packs one record, sleeping while the ring is full
+    template <typename... Args>
+    auto push(Args &&...args) -> void {
+        while (!try_push(args...)) {
+            wait_writable(std::chrono::milliseconds(100));
+        }
+    }
+
+    // Sleeps until there is room for a record or `timeout` passes
+    auto wait_writable(std::chrono::nanoseconds timeout) -> bool {
+        return detail::wait_until_ready(
+            header_->producer_waiting, header_->writable, timeout, [this] {
+                return header_->head.load(std::memory_order_relaxed)
+                       < header_->tail.load(std::memory_order_acquire)
+                             + capacity_;
+            });
+    }
+
+    // Consumer side
+
+    // Published records that are contiguous in the ring, read in place.
+    // They stay valid until release().
+    auto peek(std::size_t max_records
+              = std::numeric_limits<std::size_t>::max()) -> record_batch<Fmt> {
+        auto tail = header_->tail.load(std::memory_order_relaxed);
+        if (head_cache_ == tail) {
+            head_cache_ = header_->head.load(std::memory_order_acquire);
+        }
+        auto count = std::min({max_records,
+                               static_cast<std::size_t>(head_cache_ - tail),
+                               capacity_ - offset(tail)});
+        return {slot(tail), count};
+    }
+
+    // Frees the first `count` peeked records, waking the producer if it
+    // sleeps
+    auto release(std::size_t count) -> void {
+        header_->tail.store(header_->tail.load(std::memory_order_relaxed)
+                                + count,
+                            std::memory_order_release);
+        detail::notify(header_->producer_waiting, header_->writable);
+    }
+
+    template <typename F>
+    auto consume(F        &&on_record,
+                 std::size_t max_records
+                 = std::numeric_limits<std::size_t>::max()) -> std::size_t {
+        std::size_t consumed = 0;
+        while (consumed < max_records) {
+            auto batch = peek(max_records - consumed);
+            if (batch.empty()) {
+                break;
+            }
+            for (std::size_t i = 0; i < batch.size(); i++) {
+                on_record(batch[i]);
+            }
+            release(batch.size());
+            consumed += batch.size();
+        }
+        return consumed;
+    }
+
+    // Unpacks and releases the oldest record. Its 's' items come back as
+    // std::string, since the producer process may overwrite the slot once
+    // released.
+    auto try_pop() -> std::optional<detail::owned_record_t<Fmt>> {
+        auto batch = peek(1);
+        if (batch.empty()) {
+            return std::nullopt;
+        }
+        auto record = detail::own_strings(batch[0].unpack());
+        release(1);
+        return record;
+    }
+
+    // Sleeps until a record is available or `timeout` passes
+    auto wait(std::chrono::nanoseconds timeout) -> bool {
+        return detail::wait_until_ready(
+            header_->consumer_waiting, header_->readable, timeout, [this] {
+                return header_->head.load(std::memory_order_acquire)
+                       != header_->tail.load(std::memory_order_relaxed);
+            });
+    }
+
+private:
+    using header_type = detail::shm_channel_header;
+
+    // Records start on the cache line after the header
+    static constexpr std::size_t slots_offset
+        = (sizeof(header_type) + 63) / 64 * 64;
+
+    shm_channel() = default;
+
+    static auto initialize(int fd, std::size_t min_records) -> shm_channel {
+        auto capacity = std::bit_ceil(std::max<std::size_t>(min_records, 2));
+        auto size = slots_offset + capacity * record_size;
+        if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            ::close(fd);
+            detail::throw_errno("shm_channel: ftruncate");
+        }
+        auto channel = map(fd, size);
+        auto *header = new (channel.mapping_) header_type;
+        header->record_size = static_cast<std::uint32_t>(record_size);
+        header->capacity = capacity;
+        header->format_size = static_cast<std::uint32_t>(Fmt::size());
+        std::copy_n(Fmt::value(), Fmt::size(), header->format);
+        header->magic.store(header_type::magic_value,
+                            std::memory_order_release);
+        channel.bind(header);
+        return channel;
+    }
+
+    static auto map_existing(int fd) -> shm_channel {
+        struct stat st {};
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            detail::throw_errno("shm_channel: fstat");
+        }
+        auto size = static_cast<std::size_t>(st.st_size);
+        if (size < slots_offset) {
+            ::close(fd);
+            detail::throw_invalid("shm_channel: not a channel");
+        }
+        auto channel = map(fd, size);
+        auto *header = std::launder(
+            reinterpret_cast<header_type *>(channel.mapping_));
+        if (header->magic.load(std::memory_order_acquire)
+                != header_type::magic_value
+            || header->version != header_type::current_version) {
+            detail::throw_invalid("shm_channel: not a channel");
+        }
+        if (header->record_size != record_size
+            || std::string_view(header->format, header->format_size)
+                   != std::string_view(Fmt::value(), Fmt::size())) {
+            detail::throw_invalid("shm_channel: format mismatch");
+        }
+        // Divide rather than multiply: a hostile capacity must not wrap
+        if (!std::has_single_bit(header->capacity)
+            || header->capacity > (size - slots_offset) / record_size) {
+            detail::throw_invalid("shm_channel: corrupt header");
+        }
+        channel.bind(header);
+        return channel;
+    }
+
+    static auto map(int fd, std::size_t size) -> shm_channel {
+        void *mapping = ::mmap(
+            nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            detail::throw_errno("shm_channel: mmap");
+        }
+        auto channel = shm_channel();
+        channel.fd_ = fd;
+        channel.mapping_ = mapping;
+        channel.mapping_size_ = size;
+        return channel;
+    }
+
+    auto bind(header_type *header) -> void {
+        header_ = header;
+        slots_ = static_cast<char *>(mapping_) + slots_offset;
+        capacity_ = static_cast<std::size_t>(header->capacity);
+        head_cache_ = header->head.load(std::memory_order_acquire);
+        tail_cache_ = header->tail.load(std::memory_order_acquire);
+    }
+
+    auto offset(std::uint64_t position) const -> std::size_t {
+        return static_cast<std::size_t>(position & (capacity_ - 1));
+    }
+
+    auto slot(std::uint64_t position) const -> char * {
+        return slots_ + offset(position) * record_size;
+    }
+
+    int          fd_{-1};
+    void        *mapping_{nullptr};
+    std::size_t  mapping_size_{0};
+    header_type *header_{nullptr};
+    char        *slots_{nullptr};
+    std::size_t  capacity_{0};
+    // This process's view of the other side's counter
+    std::uint64_t head_cache_{0};
+    std::uint64_t tail_cache_{0};
+};
+
+} // namespace struct_pack
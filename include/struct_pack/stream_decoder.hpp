@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <string_view>
+
+#include "struct_pack/calcsize.hpp"
+#include "struct_pack/unpack.hpp"
+
+namespace struct_pack {
+
+// Decodes a stream of records of one format that arrives in arbitrarily
+// sized chunks (socket reads, pipe reads, ...). Complete records are unpacked
+// straight out of the chunk; only a record split across chunks is copied,
+// into a buffer of calcsize(Fmt{}) bytes.
+//
+// Strings in decoded records are views into the chunk or the decoder's own
+// buffer, and are only valid during the callback.
+//
+//     auto decoder = struct_pack::stream_decoder<decltype("<Ih"_fmt)>{};
+//     decoder.feed(chunk, [](auto record) {
+//         auto [id, value] = record;
+//     });
+template <typename Fmt>
+class stream_decoder {
+public:
+    static constexpr std::size_t record_size = struct_pack::calcsize(Fmt{});
+
+    // Invokes `on_record` with the tuple of every record completed by
+    // `chunk`, returning how many there were
+    template <typename Input, typename F>
+    auto feed(Input &&chunk, F &&on_record) -> std::size_t {
+        STRUCT_PACK_TRACE_SPAN("stream_decoder::feed", "bulk");
+        const char *data = std::data(chunk);
+        std::size_t size = std::size(chunk);
+        std::size_t decoded = 0;
+
+        if (tail_size_ > 0) {
+            auto needed = std::min(record_size - tail_size_, size);
+            std::copy_n(data, needed, tail_.data() + tail_size_);
+            tail_size_ += needed;
+            data += needed;
+            size -= needed;
+            if (tail_size_ < record_size) {
+                return 0;
+            }
+            on_record(struct_pack::unpack(
+                Fmt{}, std::string_view(tail_.data(), record_size)));
+            tail_size_ = 0;
+            decoded++;
+        }
+
+        for (; size >= record_size; size -= record_size, data += record_size) {
+            on_record(struct_pack::unpack(Fmt{},
+                                          std::string_view(data, record_size)));
+            decoded++;
+        }
+
+        std::copy_n(data, size, tail_.data());
+        tail_size_ = size;
+        records_ += decoded;
+        return decoded;
+    }
+
+    // Bytes of an incomplete record held until the next chunk
+    auto buffered() const -> std::size_t {
+        return tail_size_;
+    }
+
+    auto records_decoded() const -> std::size_t {
+        return records_;
+    }
+
+    // Drops a partially received record, e.g. after a reconnect
+    auto reset() -> void {
+        tail_size_ = 0;
+    }
+
+private:
+    std::array<char, record_size> tail_{};
+    std::size_t                   tail_size_{0};
+    std::size_t                   records_{0};
+};
+
+} // namespace struct_pack
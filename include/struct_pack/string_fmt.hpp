@@ -4,9 +4,26 @@
 #include <tuple>
 
 #include "struct_pack/data_view.hpp"
-#include "struct_pack/debug.hpp"
 #include "struct_pack/new_format.hpp"
-#include "struct_pack/print.hpp"
+
+namespace struct_pack {
+// Default tracing policy of new_pack: every hook is empty, so tracing
+// compiles away entirely. See struct_pack/trace.hpp for tracers that record
+// or print.
+struct null_tracer {
+    constexpr void begin_pack(std::string_view /*format*/,
+                              char /*mode*/,
+                              std::size_t /*size*/) {}
+
+    template <typename T>
+    constexpr void item(std::size_t /*index*/,
+                        char /*format_char*/,
+                        std::size_t /*offset*/,
+                        const T & /*value*/) {}
+
+    constexpr void end_pack(const char * /*data*/, std::size_t /*size*/) {}
+};
+} // namespace struct_pack
 
 namespace struct_pack::detail {
 template <auto container>
@@ -212,7 +229,6 @@ struct fmt_string {
             //     string_view
         }
         auto view = data_view<char>{data, big_endian};
-        PRINT("pack store: {} <- {}", (void *) data, elem);
         data::store(view, elem);
     }
 
@@ -232,12 +248,18 @@ struct fmt_string {
     }
 
     template <size_t... Items, typename... Args>
-    static auto pack(std::index_sequence<Items...> /*unused*/, Args &&...args) {
-        constexpr auto mode = format_mode();
-        PRINT("format mode: {}", mode.format());
+    static auto pack(std::index_sequence<Items...> items, Args &&...args) {
+        auto tracer = null_tracer{};
+        return pack(tracer, items, std::forward<Args>(args)...);
+    }
 
+    template <typename Tracer, size_t... Items, typename... Args>
+    static auto pack(Tracer &tracer,
+                     std::index_sequence<Items...> /*unused*/,
+                     Args &&...args) {
+        constexpr auto mode = format_mode();
         constexpr auto num_bytes = calcsize();
-        PRINT("calcsize: {}", num_bytes);
+        tracer.begin_pack(view(), mode.format(), num_bytes);
 
         constexpr auto formats = std::array{type_of_item<Items>()...};
         using Types = std::tuple<
@@ -248,14 +270,18 @@ struct fmt_string {
             = std::make_tuple(convert_to<std::tuple_element_t<Items, Types>>(
                 std::forward<Args>(args))...);
         constexpr auto offsets = std::array{binary_offset<Items>()...};
-        PRINT("offset: {}", print_hpp::P(offsets));
 
         auto output = std::array<char, num_bytes>{};
-        (pack_element(output.data() + offsets[Items],
-                      mode.is_big_endian(),
-                      formats[Items],
+        ((tracer.item(Items,
+                      formats[Items].format_char,
+                      offsets[Items],
                       std::get<Items>(types)),
+          pack_element(output.data() + offsets[Items],
+                       mode.is_big_endian(),
+                       formats[Items],
+                       std::get<Items>(types))),
          ...);
+        tracer.end_pack(output.data(), num_bytes);
         return output;
     }
 };
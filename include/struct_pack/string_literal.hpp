@@ -28,6 +28,14 @@ struct type_string {
     static constexpr auto view() -> std::string_view {
         return std::string_view{data(), size()};
     }
+    // value() and at() let a type_string stand in for PY_STRING(...), so
+    // decltype("<2i"_fmt) can name a format in template arguments
+    static constexpr auto value() -> decltype(auto) {
+        return (container.data);
+    }
+    static constexpr auto at(std::size_t i) -> char {
+        return container.data[i];
+    }
 };
 
 template <string_container container>
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "struct_pack/debug.hpp"
+#include "struct_pack/print.hpp"
+#include "struct_pack/string_fmt.hpp"
+
+// Tracers for new_pack_traced. A tracer is any type with the hooks of
+// struct_pack::null_tracer; they are called in order for every packed record.
+
+namespace struct_pack {
+
+struct trace_item {
+    std::size_t index;
+    char        format_char;
+    std::size_t offset;
+    std::string value;
+};
+
+struct trace_record {
+    std::string_view         format;
+    std::size_t              size;
+    std::vector<trace_item>  items;
+    std::chrono::nanoseconds elapsed;
+};
+
+// Keeps the layout, values and pack time of every record
+class recording_tracer {
+public:
+    void begin_pack(std::string_view format, char /*mode*/, std::size_t size) {
+        records_.push_back({format, size, {}, {}});
+        start_ = std::chrono::steady_clock::now();
+    }
+
+    template <typename T>
+    void item(std::size_t index,
+              char        format_char,
+              std::size_t offset,
+              const T    &value) {
+        records_.back().items.push_back(
+            {index, format_char, offset, print_hpp::P(value)});
+    }
+
+    void end_pack(const char * /*data*/, std::size_t /*size*/) {
+        records_.back().elapsed = std::chrono::steady_clock::now() - start_;
+    }
+
+    auto records() const -> const std::vector<trace_record> & {
+        return records_;
+    }
+
+    void clear() {
+        records_.clear();
+    }
+
+private:
+    std::vector<trace_record>             records_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Prints every step through PRINT, as new_pack used to do unconditionally
+struct print_tracer {
+    void begin_pack(std::string_view format, char mode, std::size_t size) {
+        PRINT("pack {}: format mode: {}, calcsize: {}", format, mode, size);
+    }
+
+    template <typename T>
+    void item(std::size_t index,
+              char        format_char,
+              std::size_t offset,
+              const T    &value) {
+        PRINT("pack item {} '{}' at offset {} <- {}",
+              index,
+              format_char,
+              offset,
+              print_hpp::P(value));
+    }
+
+    void end_pack(const char *data, std::size_t size) {
+        PRINT("packed {} bytes at {}", size, (const void *) data);
+    }
+};
+
+} // namespace struct_pack
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Timeline tracing in the Chrome trace-event format. With
+// STRUCT_PACK_TRACE_EVENTS defined to 1, pack, unpack, the bulk writers and
+// decoders and ConsoleLogger record begin/end events into a per-thread
+// buffer; trace_collector::flush() writes them as JSON that chrome://tracing
+// and ui.perfetto.dev load directly. Otherwise STRUCT_PACK_TRACE_SPAN
+// expands to nothing.
+#ifndef STRUCT_PACK_TRACE_EVENTS
+#define STRUCT_PACK_TRACE_EVENTS 0
+#endif
+
+namespace struct_pack {
+
+// Strings are not copied: every pointer must outlive the collector, which
+// string literals and format strings do
+struct trace_event {
+    const char   *name;
+    const char   *category;
+    const char   *arg_name; // may be null
+    const char   *arg;
+    std::uint32_t arg_size;
+    char          phase; // 'B' or 'E'
+    std::uint64_t timestamp; // nanoseconds since the collector started
+};
+
+namespace detail {
+    // Single-producer single-consumer ring: the owning thread appends, the
+    // flushing thread drains. Events that do not fit are dropped.
+    struct trace_buffer {
+        static constexpr std::size_t capacity = 1 << 15;
+
+        explicit trace_buffer(std::uint32_t thread_id)
+            : tid{thread_id} {}
+
+        void push(const trace_event &event) {
+            auto h = head.load(std::memory_order_relaxed);
+            if (h - tail.load(std::memory_order_acquire) == capacity) {
+                dropped.store(dropped.load(std::memory_order_relaxed) + 1,
+                              std::memory_order_relaxed);
+                return;
+            }
+            events[h & (capacity - 1)] = event;
+            head.store(h + 1, std::memory_order_release);
+        }
+
+        std::unique_ptr<trace_event[]> events{
+            std::make_unique<trace_event[]>(capacity)};
+        std::atomic<std::uint64_t> head{0};
+        std::atomic<std::uint64_t> tail{0};
+        std::atomic<std::uint64_t> dropped{0};
+        std::atomic<bool>          retired{false};
+        std::uint32_t              tid;
+    };
+
+    inline void write_json_string(std::ostream &out, std::string_view s) {
+        out << '"';
+        for (char ch : s) {
+            if (ch == '"' || ch == '\\') {
+                out << '\\' << ch;
+            } else if (static_cast<unsigned char>(ch) < 0x20) {
+                out << ' ';
+            } else {
+                out << ch;
+            }
+        }
+        out << '"';
+    }
+} // namespace detail
+
+// Owns the per-thread buffers and turns them into trace JSON
+class trace_collector {
+public:
+    static auto instance() -> trace_collector & {
+        static trace_collector collector;
+        return collector;
+    }
+
+    // Recording can be paused at run time; it is on by default
+    void set_enabled(bool enabled) {
+        enabled_.store(enabled, std::memory_order_relaxed);
+    }
+
+    auto enabled() const -> bool {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    void record(char             phase,
+                const char      *name,
+                const char      *category,
+                const char      *arg_name = nullptr,
+                std::string_view arg = {}) {
+        if (!enabled()) {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now() - start_;
+        local().push(
+            {name,
+             category,
+             arg_name,
+             arg.data(),
+             static_cast<std::uint32_t>(arg.size()),
+             phase,
+             static_cast<std::uint64_t>(
+                 std::chrono::duration_cast<std::chrono::nanoseconds>(now)
+                     .count())});
+    }
+
+    // Moves every buffered event into a complete trace JSON document.
+    // Events recorded while this runs end up in the next flush.
+    void flush(std::ostream &out) {
+        auto lock = std::lock_guard{mutex_};
+        auto pid = ::getpid();
+        auto first = true;
+        out << "{\"traceEvents\":[";
+        for (const auto &buffer : buffers_) {
+            auto t = buffer->tail.load(std::memory_order_relaxed);
+            auto h = buffer->head.load(std::memory_order_acquire);
+            for (; t != h; t++) {
+                const auto &e = buffer->events[t & (buffer->capacity - 1)];
+                out << (first ? "" : ",") << "\n{\"name\":";
+                first = false;
+                detail::write_json_string(out, e.name);
+                out << ",\"cat\":";
+                detail::write_json_string(out, e.category);
+                out << ",\"ph\":\"" << e.phase << "\",\"ts\":"
+                    << e.timestamp / 1000 << '.' << (e.timestamp % 1000) / 100
+                    << (e.timestamp % 100) / 10 << e.timestamp % 10
+                    << ",\"pid\":" << pid << ",\"tid\":" << buffer->tid;
+                if (e.arg_name != nullptr) {
+                    out << ",\"args\":{";
+                    detail::write_json_string(out, e.arg_name);
+                    out << ':';
+                    detail::write_json_string(
+                        out, std::string_view(e.arg, e.arg_size));
+                    out << '}';
+                }
+                out << '}';
+            }
+            buffer->tail.store(h, std::memory_order_release);
+        }
+        out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+
+        // Threads that exited have nothing more to say
+        std::erase_if(buffers_, [](const auto &buffer) {
+            return buffer->retired.load(std::memory_order_acquire)
+                   && buffer->tail.load(std::memory_order_relaxed)
+                          == buffer->head.load(std::memory_order_acquire);
+        });
+    }
+
+    void flush(const std::string &path) {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out) {
+            throw std::system_error(
+                errno, std::generic_category(), "trace_collector: open");
+        }
+        flush(out);
+        if (!out.flush()) {
+            throw std::system_error(
+                errno, std::generic_category(), "trace_collector: write");
+        }
+    }
+
+    // Events lost because a thread's buffer was full since the last flush
+    auto dropped() -> std::uint64_t {
+        auto          lock = std::lock_guard{mutex_};
+        std::uint64_t total = 0;
+        for (const auto &buffer : buffers_) {
+            total += buffer->dropped.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    trace_collector() = default;
+
+    // Keeps the calling thread's buffer registered; the collector holds on
+    // to it after the thread exits until its events are flushed
+    struct thread_buffer {
+        explicit thread_buffer(trace_collector &collector)
+            : buffer{std::make_shared<detail::trace_buffer>(
+                static_cast<std::uint32_t>(::syscall(SYS_gettid)))} {
+            auto lock = std::lock_guard{collector.mutex_};
+            collector.buffers_.push_back(buffer);
+        }
+
+        thread_buffer(const thread_buffer &) = delete;
+        auto operator=(const thread_buffer &) -> thread_buffer & = delete;
+
+        ~thread_buffer() {
+            buffer->retired.store(true, std::memory_order_release);
+        }
+
+        std::shared_ptr<detail::trace_buffer> buffer;
+    };
+
+    auto local() -> detail::trace_buffer & {
+        thread_local thread_buffer this_thread{*this};
+        return *this_thread.buffer;
+    }
+
+    std::chrono::steady_clock::time_point start_{
+        std::chrono::steady_clock::now()};
+    std::atomic<bool>                                  enabled_{true};
+    std::mutex                                         mutex_;
+    std::vector<std::shared_ptr<detail::trace_buffer>> buffers_;
+};
+
+// Records a begin event now and the matching end event when it goes out of
+// scope. Usable in constexpr functions: nothing is recorded during constant
+// evaluation.
+class trace_span {
+public:
+    constexpr trace_span(const char      *name,
+                         const char      *category,
+                         const char      *arg_name = nullptr,
+                         std::string_view arg = {})
+        : name_{name}
+        , category_{category} {
+        if (!std::is_constant_evaluated()) {
+            trace_collector::instance().record(
+                'B', name, category, arg_name, arg);
+        }
+    }
+
+    trace_span(const trace_span &) = delete;
+    auto operator=(const trace_span &) -> trace_span & = delete;
+
+    constexpr ~trace_span() {
+        if (!std::is_constant_evaluated()) {
+            trace_collector::instance().record('E', name_, category_);
+        }
+    }
+
+private:
+    const char *name_;
+    const char *category_;
+};
+
+} // namespace struct_pack
+
+#if STRUCT_PACK_TRACE_EVENTS
+#define STRUCT_PACK_TRACE_SPAN(...)                                            \
+    ::struct_pack::trace_span struct_pack_trace_span_ {                        \
+        __VA_ARGS__                                                            \
+    }
+#else
+#define STRUCT_PACK_TRACE_SPAN(...)
+#endif
@@ -3,25 +3,71 @@
 
 #include "struct_pack/calcsize.hpp"
 #include "struct_pack/data_view.hpp"
+#include "struct_pack/expected.hpp"
+
+// The tracing machinery is only pulled in when it is enabled
+#if STRUCT_PACK_TRACE_EVENTS
+#include "struct_pack/trace_event.hpp"
+#else
+#define STRUCT_PACK_TRACE_SPAN(...)
+#endif
 
 namespace struct_pack {
 
 template <typename Fmt, typename Input>
 constexpr auto unpack(Fmt, Input &&packedInput);
 
+enum class unpack_error {
+    truncated,    // the input is shorter than calcsize(Fmt{})
+    invalid_bool, // a '?' item holds something other than 0 or 1
+};
+
+// Checked unpack: the input length is validated against calcsize once (which
+// also covers every fixed-width 's' item) and '?' bytes must be 0 or 1; the
+// record is then decoded by the same unchecked path as unpack()
+template <typename Fmt, typename Input>
+constexpr auto try_unpack(Fmt, Input &&packedInput)
+    -> expected<decltype(unpack(Fmt{}, packedInput)), unpack_error>;
+
 namespace detail {
 
     template <typename Fmt, size_t... Items, typename Input>
     constexpr auto unpack(std::index_sequence<Items...>, Input &&packedInput);
 
+    template <typename Fmt, size_t... Items>
+    constexpr bool validBools(std::index_sequence<Items...>, const char *data) {
+        constexpr FormatType formats[]
+            = {struct_pack::getTypeOfItem<Items>(Fmt{})...};
+        constexpr size_t offsets[] = {getBinaryOffset<Items>(Fmt{})...};
+
+        return ((formats[Items].formatChar != '?'
+                 || static_cast<unsigned char>(data[offsets[Items]]) <= 1)
+                && ...);
+    }
+
 } // namespace detail
 
 template <typename Fmt, typename Input>
 constexpr auto unpack(Fmt, Input &&packedInput) {
+    STRUCT_PACK_TRACE_SPAN("unpack", "struct_pack", "format", Fmt::value());
     return detail::unpack<Fmt>(std::make_index_sequence<countItems(Fmt{})>(),
                                std::forward<Input>(packedInput));
 }
 
+template <typename Fmt, typename Input>
+constexpr auto try_unpack(Fmt, Input &&packedInput)
+    -> expected<decltype(unpack(Fmt{}, packedInput)), unpack_error> {
+    STRUCT_PACK_TRACE_SPAN("try_unpack", "struct_pack", "format", Fmt::value());
+    if (std::size(packedInput) < struct_pack::calcsize(Fmt{})) {
+        return unexpected(unpack_error::truncated);
+    }
+    if (!detail::validBools<Fmt>(std::make_index_sequence<countItems(Fmt{})>(),
+                                 std::data(packedInput))) {
+        return unexpected(unpack_error::invalid_bool);
+    }
+    return unpack(Fmt{}, std::forward<Input>(packedInput));
+}
+
 template <size_t Item, typename UnpackedType>
 constexpr auto unpackElement(const char *begin, size_t size, bool bigEndian) {
     data_view<const char> view(begin, bigEndian);
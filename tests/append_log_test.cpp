@@ -0,0 +1,170 @@
+#include "struct_pack.hpp"
+#include "struct_pack/append_log.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+
+using namespace std::string_view_literals;
+
+namespace {
+using Fmt = decltype("<Iq3s"_fmt);
+
+// A path in the temp directory, removed afterwards
+class temp_file {
+public:
+    explicit temp_file(const std::string &name)
+        : path_{"/tmp/" + name + "." + std::to_string(::getpid())} {}
+
+    ~temp_file() {
+        std::remove(path_.c_str());
+    }
+
+    auto path() const -> const std::string & {
+        return path_;
+    }
+
+private:
+    std::string path_;
+};
+} // namespace
+
+TEST_CASE("append_log appends and follows", "[struct_pack::append_log]") {
+    temp_file file("append_log_test_basic");
+    {
+        auto log = struct_pack::append_log<Fmt>::create(file.path(), 100);
+        REQUIRE(log.capacity() == 100);
+        for (uint32_t i = 0; i < 70; i++) {
+            REQUIRE(log.append(i, -int64_t{i}, "abc"));
+        }
+
+        std::uint64_t cursor = 0;
+        REQUIRE(log.follow(cursor, [&](auto record) {
+            REQUIRE(record.template get<0>() == cursor);
+        }) == 70);
+        REQUIRE(cursor == 70);
+        REQUIRE(log.follow(cursor, [](auto) {}) == 0);
+    }
+
+    // The records survive reopening, and appends continue after them
+    auto log = struct_pack::append_log<Fmt>::open(file.path());
+    REQUIRE(log.reserved() == 70);
+    REQUIRE(log.committed_until(0) == 70);
+    REQUIRE(log.record(69).get<1>() == -69);
+    REQUIRE(log.record(69).get<2>() == "abc"sv);
+
+    auto r = log.try_reserve(40);
+    REQUIRE(r.count == 30);
+    REQUIRE(r.index == 70);
+    for (uint32_t i = 0; i < r.count; i++) {
+        struct_pack::pack_into(
+            Fmt{}, r.data + i * log.record_size, 70 + i, int64_t{0}, "xyz");
+    }
+    REQUIRE(!log.committed(70));
+    log.commit(r);
+    REQUIRE(log.committed_until(0) == 100);
+    REQUIRE(!log.append(0u, int64_t{0}, "abc"));
+    REQUIRE(log.try_reserve(1).count == 0);
+    log.sync();
+}
+
+TEST_CASE("append_log checks the format on open",
+          "[struct_pack::append_log]") {
+    temp_file file("append_log_test_format");
+    struct_pack::append_log<Fmt>::create(file.path(), 10);
+
+    using Other = decltype("<qI3s"_fmt);
+    REQUIRE_THROWS_AS(struct_pack::append_log<Other>::open(file.path()),
+                      std::system_error);
+    REQUIRE_NOTHROW(struct_pack::append_log<Fmt>::open(file.path()));
+    REQUIRE_THROWS_AS(
+        struct_pack::append_log<Fmt>::open(file.path() + ".missing"),
+        std::system_error);
+}
+
+TEST_CASE("append_log recovers the committed prefix",
+          "[struct_pack::append_log]") {
+    temp_file file("append_log_test_recover");
+    auto      log = struct_pack::append_log<Fmt>::create(file.path(), 200);
+    for (uint32_t i = 0; i < 65; i++) {
+        log.append(i, int64_t{0}, "abc");
+    }
+    // A writer that died between reserve and commit leaves a gap
+    auto lost = log.try_reserve(1);
+    REQUIRE(lost.index == 65);
+    for (uint32_t i = 66; i < 150; i++) {
+        log.append(i, int64_t{0}, "abc");
+    }
+    REQUIRE(log.committed_until(0) == 65);
+    REQUIRE(log.committed_until(66) == 150);
+
+    REQUIRE(log.recover() == 65);
+    REQUIRE(log.reserved() == 65);
+    REQUIRE(!log.committed(66));
+    REQUIRE(!log.committed(149));
+    REQUIRE(log.append(65u, int64_t{0}, "abc"));
+    REQUIRE(log.committed_until(0) == 66);
+}
+
+TEST_CASE("append_log with concurrent writers",
+          "[struct_pack::append_log]") {
+    constexpr uint32_t writers = 4;
+    constexpr uint32_t per_writer = 50'000;
+    temp_file          file("append_log_test_threads");
+    auto               log = struct_pack::append_log<Fmt>::create(
+        file.path(), writers * per_writer);
+
+    std::atomic<bool>        full{false};
+    std::vector<std::thread> threads;
+    for (uint32_t w = 0; w < writers; w++) {
+        threads.emplace_back([&log, &full, w] {
+            for (uint32_t i = 0; i < per_writer;) {
+                // Mix single appends and batches
+                if (i % 3 == 0) {
+                    if (!log.append(w, int64_t{i}, "abc")) {
+                        full = true;
+                    }
+                    i++;
+                    continue;
+                }
+                auto r = log.try_reserve(std::min(5u, per_writer - i));
+                for (std::size_t k = 0; k < r.count; k++, i++) {
+                    struct_pack::pack_into(Fmt{},
+                                           r.data + k * log.record_size,
+                                           w,
+                                           int64_t{i},
+                                           "abc");
+                }
+                log.commit(r);
+            }
+        });
+    }
+
+    // A reader follows while the writers run
+    std::vector<int64_t> next(writers, 0);
+    std::uint64_t        cursor = 0;
+    bool                 ok = true;
+    while (cursor < writers * per_writer) {
+        if (log.follow(cursor, [&](auto record) {
+                auto w = record.template get<0>();
+                ok = ok && record.template get<1>() == next[w]++;
+            })
+            == 0) {
+            std::this_thread::yield();
+        }
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    REQUIRE(!full);
+    REQUIRE(ok);
+    for (auto n : next) {
+        REQUIRE(n == per_writer);
+    }
+}
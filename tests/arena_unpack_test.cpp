@@ -0,0 +1,97 @@
+#include "struct_pack.hpp"
+#include "struct_pack/arena_unpack.hpp"
+
+#include <array>
+#include <memory_resource>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+using namespace std::string_view_literals;
+
+namespace {
+// Counts allocations made through it
+class counting_resource : public std::pmr::memory_resource {
+public:
+    std::size_t allocations = 0;
+    std::size_t bytes = 0;
+
+private:
+    auto do_allocate(std::size_t size, std::size_t alignment)
+        -> void * override {
+        allocations++;
+        bytes += size;
+        return std::pmr::new_delete_resource()->allocate(size, alignment);
+    }
+
+    void do_deallocate(void *p, std::size_t size, std::size_t alignment)
+        override {
+        std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+    }
+
+    auto do_is_equal(const std::pmr::memory_resource &other) const noexcept
+        -> bool override {
+        return this == &other;
+    }
+};
+} // namespace
+
+TEST_CASE("unpack into an arena outlives the input",
+          "[struct_pack::arena_unpack]") {
+    using Fmt = decltype("<3sI5s?2s"_fmt);
+    counting_resource arena;
+
+    auto packed = struct_pack::pack(Fmt{}, "abc", 7u, "hello", true, "xy");
+    auto input = std::string(packed.data(), packed.size());
+    auto [a, n, b, flag, c] = struct_pack::unpack(Fmt{}, input, arena);
+    input.assign(input.size(), '\0');
+
+    REQUIRE(a == "abc"sv);
+    REQUIRE(n == 7);
+    REQUIRE(b == "hello"sv);
+    REQUIRE(flag);
+    REQUIRE(c == "xy"sv);
+    // One allocation holds all three strings
+    REQUIRE(arena.allocations == 1);
+    REQUIRE(arena.bytes == 10);
+    REQUIRE(b.data() == a.data() + 3);
+}
+
+TEST_CASE("unpack into an arena without strings",
+          "[struct_pack::arena_unpack]") {
+    using Fmt = decltype("<Iq"_fmt);
+    counting_resource arena;
+
+    auto packed = struct_pack::pack(Fmt{}, 1u, int64_t{-2});
+    auto [n, q] = struct_pack::unpack(Fmt{}, packed, arena);
+    REQUIRE(n == 1);
+    REQUIRE(q == -2);
+    REQUIRE(arena.allocations == 0);
+}
+
+TEST_CASE("unpack_records into an arena", "[struct_pack::arena_unpack]") {
+    using Fmt = decltype(">H4s"_fmt);
+    std::string input;
+    for (uint16_t i = 0; i < 100; i++) {
+        auto packed = struct_pack::pack(
+            Fmt{}, i, std::to_string(1000 + i).c_str());
+        input.append(packed.data(), packed.size());
+    }
+    // A trailing partial record is left alone
+    input.append("\x01");
+
+    std::array<char, 4096>              memory;
+    std::pmr::monotonic_buffer_resource arena(
+        memory.data(), memory.size(), std::pmr::null_memory_resource());
+    auto records = struct_pack::unpack_records(Fmt{}, input, arena);
+    input.assign(input.size(), '\0');
+
+    REQUIRE(records.size() == 100);
+    for (uint16_t i = 0; i < 100; i++) {
+        auto [id, name] = records[i];
+        REQUIRE(id == i);
+        REQUIRE(name == std::to_string(1000 + i));
+        REQUIRE(name.data() >= memory.data());
+        REQUIRE(name.data() < memory.data() + memory.size());
+    }
+}
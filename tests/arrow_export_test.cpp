@@ -0,0 +1,175 @@
+#include "struct_pack.hpp"
+#include "struct_pack/arrow_export.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using namespace std::string_view_literals;
+
+namespace {
+template <typename Fmt>
+auto make_records(std::size_t count) -> std::string {
+    std::string records;
+    for (std::size_t i = 0; i < count; i++) {
+        auto packed = struct_pack::pack(Fmt{},
+                                        static_cast<int64_t>(i) - 5,
+                                        static_cast<uint16_t>(i * 3),
+                                        i % 3 == 0,
+                                        '\0',
+                                        '\0',
+                                        static_cast<double>(i) / 2,
+                                        "SYM" + std::to_string(i % 10));
+        records.append(packed.data(), packed.size());
+    }
+    return records;
+}
+
+template <typename T>
+auto column_value(const ArrowArray &column, std::size_t i) -> T {
+    T value;
+    std::memcpy(&value,
+                static_cast<const char *>(column.buffers[1]) + i * sizeof(T),
+                sizeof(T));
+    return value;
+}
+
+template <typename Fmt>
+void check_columns(const ArrowArray &array, std::size_t count) {
+    REQUIRE(array.length == static_cast<int64_t>(count));
+    REQUIRE(array.n_buffers == 1);
+    REQUIRE(array.buffers[0] == nullptr);
+    REQUIRE(array.n_children == 5);
+    for (int64_t c = 0; c < array.n_children; c++) {
+        REQUIRE(array.children[c]->length == static_cast<int64_t>(count));
+        REQUIRE(array.children[c]->n_buffers == 2);
+        REQUIRE(array.children[c]->null_count == 0);
+        REQUIRE(array.children[c]->buffers[0] == nullptr);
+    }
+
+    const auto &bools = *array.children[2];
+    const auto *bits = static_cast<const unsigned char *>(bools.buffers[1]);
+    const auto *symbols
+        = static_cast<const char *>(array.children[4]->buffers[1]);
+    for (std::size_t i = 0; i < count; i++) {
+        REQUIRE(column_value<int64_t>(*array.children[0], i)
+                == static_cast<int64_t>(i) - 5);
+        REQUIRE(column_value<uint16_t>(*array.children[1], i) == i * 3);
+        REQUIRE(((bits[i / 8] >> (i % 8)) & 1) == (i % 3 == 0));
+        REQUIRE(column_value<double>(*array.children[3], i)
+                == static_cast<double>(i) / 2);
+        auto symbol = "SYM" + std::to_string(i % 10);
+        symbol.resize(6, '\0');
+        REQUIRE(std::string_view(symbols + i * 6, 6) == symbol);
+    }
+}
+} // namespace
+
+TEST_CASE("export_arrow schema", "[struct_pack::arrow_export]") {
+    ArrowSchema schema;
+    struct_pack::export_arrow_schema("<qH?2xd6s"_fmt, &schema);
+    REQUIRE(schema.format == "+s"sv);
+    REQUIRE(schema.n_children == 5);
+    const char *formats[] = {"l", "S", "b", "g", "w:6"};
+    for (int64_t c = 0; c < schema.n_children; c++) {
+        REQUIRE(schema.children[c]->format == std::string_view(formats[c]));
+        REQUIRE(schema.children[c]->flags == 0);
+        REQUIRE(schema.children[c]->n_children == 0);
+        REQUIRE(schema.children[c]->release != nullptr);
+    }
+    // Named by item index; "2x" is items 3 and 4
+    REQUIRE(schema.children[3]->name == "f5"sv);
+    schema.release(&schema);
+    REQUIRE(schema.release == nullptr);
+
+    struct_pack::export_arrow_schema(
+        "<bBhiIqQfdc"_fmt,
+        &schema,
+        {"a", "b", "c", "d", "e", "f", "g", "h", "i", "j"});
+    const char *more[] = {"c", "C", "s", "i", "I", "l", "L", "f", "g", "w:1"};
+    for (int64_t c = 0; c < schema.n_children; c++) {
+        REQUIRE(schema.children[c]->format == std::string_view(more[c]));
+    }
+    REQUIRE(schema.children[9]->name == "j"sv);
+    schema.release(&schema);
+
+    REQUIRE_THROWS_AS(
+        struct_pack::export_arrow_schema("<qq"_fmt, &schema, {"one"}),
+        std::system_error);
+}
+
+TEST_CASE("export_arrow columns", "[struct_pack::arrow_export]") {
+    using Little = decltype("<qH?2xd6s"_fmt);
+    using Big = decltype(">qH?2xd6s"_fmt);
+    for (std::size_t count : {0, 1, 9, 1000}) {
+        ArrowSchema schema;
+        ArrowArray  array;
+
+        auto little = make_records<Little>(count);
+        struct_pack::export_arrow(Little{}, little, &schema, &array);
+        check_columns<Little>(array, count);
+        array.release(&array);
+        schema.release(&schema);
+
+        // Byte order is made native
+        auto big = make_records<Big>(count);
+        struct_pack::export_arrow_array(Big{}, big, &array);
+        check_columns<Big>(array, count);
+        array.release(&array);
+        REQUIRE(array.release == nullptr);
+    }
+}
+
+TEST_CASE("export_arrow children released on their own",
+          "[struct_pack::arrow_export]") {
+    using Fmt = decltype("<qH?2xd6s"_fmt);
+    auto records = make_records<Fmt>(100);
+
+    ArrowSchema schema;
+    ArrowArray  array;
+    struct_pack::export_arrow(Fmt{}, records, &schema, &array);
+
+    // A consumer may move a child out and release the parent first
+    ArrowArray column = *array.children[3];
+    array.children[3]->release = nullptr;
+    ArrowSchema field = *schema.children[3];
+    schema.children[3]->release = nullptr;
+    array.release(&array);
+    schema.release(&schema);
+
+    REQUIRE(field.format == "g"sv);
+    REQUIRE(column_value<double>(column, 99) == 49.5);
+    column.release(&column);
+    field.release(&field);
+}
+
+TEST_CASE("export_arrow borrows single item records",
+          "[struct_pack::arrow_export]") {
+    std::vector<uint32_t> native = {1, 2, 3, 4};
+    auto bytes = std::string_view(reinterpret_cast<const char *>(native.data()),
+                                  native.size() * sizeof(uint32_t));
+
+    ArrowArray array;
+    struct_pack::export_arrow_array("=I"_fmt, bytes, &array);
+    REQUIRE(array.children[0]->buffers[1] == native.data());
+    array.release(&array);
+
+    // Not at native byte order: copied
+    if constexpr (std::endian::native == std::endian::big) {
+        struct_pack::export_arrow_array("<I"_fmt, bytes, &array);
+    } else {
+        struct_pack::export_arrow_array(">I"_fmt, bytes, &array);
+    }
+    REQUIRE(array.children[0]->buffers[1] != native.data());
+    array.release(&array);
+
+    // Fixed-size binary is at any byte order
+    struct_pack::export_arrow_array(">4s"_fmt, bytes, &array);
+    REQUIRE(array.children[0]->buffers[1] == native.data());
+    REQUIRE(array.children[0]->length == 4);
+    array.release(&array);
+}
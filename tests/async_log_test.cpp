@@ -0,0 +1,172 @@
+#include "struct_pack/log.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace {
+using namespace print_hpp::log;
+
+// Redirects std::clog for the lifetime of the object
+class capture_clog {
+public:
+    capture_clog()
+        : old_{std::clog.rdbuf(out_.rdbuf())} {}
+
+    ~capture_clog() {
+        std::clog.rdbuf(old_);
+    }
+
+    auto str() const -> std::string {
+        return out_.str();
+    }
+
+    auto lines() const -> std::size_t {
+        auto text = out_.str();
+        return static_cast<std::size_t>(
+            std::count(text.begin(), text.end(), '\n'));
+    }
+
+private:
+    std::ostringstream out_;
+    std::streambuf    *old_;
+};
+} // namespace
+
+TEST_CASE("async messages are written in order per thread",
+          "[print_hpp::log::async]") {
+    capture_clog captured;
+    auto         logger = detail::ConsoleLogger();
+    logger.enable_async();
+
+    auto worker = [&logger](int id) {
+        for (int i = 0; i < 100; i++) {
+            logger.info("thread {} message {} {}", id, i, std::string("x"));
+        }
+    };
+    std::thread a(worker, 1);
+    std::thread b(worker, 2);
+    a.join();
+    b.join();
+    // Strings are copied: the buffer behind this one is gone before the
+    // background thread formats it
+    logger.warn("{}", std::string(40, 'y').c_str());
+    logger.flush();
+
+    auto text = captured.str();
+    REQUIRE(captured.lines() == 201);
+    REQUIRE(text.find("thread 1 message 99 x") != std::string::npos);
+    REQUIRE(text.find("thread 1 message 41")
+            < text.find("thread 1 message 42"));
+    REQUIRE(text.find(std::string(40, 'y')) != std::string::npos);
+    REQUIRE(logger.dropped() == 0);
+    logger.disable_async();
+}
+
+TEST_CASE("a thread logging to two async loggers in turn",
+          "[print_hpp::log::async]") {
+    capture_clog captured;
+    auto         first = detail::ConsoleLogger();
+    auto         second = detail::ConsoleLogger();
+    first.enable_async({.queue_size = 4});
+    second.enable_async({.queue_size = 4});
+
+    for (int i = 0; i < 500; i++) {
+        first.info("first {}", i);
+        second.info("second {}", i);
+    }
+    first.flush();
+    second.flush();
+
+    auto text = captured.str();
+    REQUIRE(captured.lines() == 1000);
+    REQUIRE(text.find("first 41") < text.find("first 42"));
+    REQUIRE(text.find("second 498") < text.find("second 499"));
+    REQUIRE(first.dropped() + second.dropped() == 0);
+    first.disable_async();
+    second.disable_async();
+}
+
+TEST_CASE("async queue overflow policies", "[print_hpp::log::async]") {
+    capture_clog captured;
+    auto         logger = detail::ConsoleLogger();
+
+    SECTION("drop") {
+        logger.enable_async({.queue_size = 4,
+                             .overflow = OverflowPolicy::DROP,
+                             .poll_interval = std::chrono::milliseconds(1)});
+        for (int i = 0; i < 1000; i++) {
+            logger.info("message {}", i);
+        }
+        auto dropped = logger.dropped();
+        logger.disable_async();
+        REQUIRE(dropped > 0);
+        REQUIRE(captured.lines() == 1000 - dropped);
+    }
+
+    SECTION("block") {
+        logger.enable_async({.queue_size = 4,
+                             .overflow = OverflowPolicy::BLOCK,
+                             .poll_interval = std::chrono::hours(1)});
+        for (int i = 0; i < 1000; i++) {
+            logger.info("message {}", i);
+        }
+        logger.disable_async();
+        REQUIRE(captured.lines() == 1000);
+    }
+}
+
+TEST_CASE("fatal flushes before returning", "[print_hpp::log::async]") {
+    capture_clog captured;
+    auto         logger = detail::ConsoleLogger();
+    logger.enable_async({.poll_interval = std::chrono::hours(1)});
+    logger.info("queued");
+    logger.fatal("fatal {}", 42);
+    auto text = captured.str();
+    REQUIRE(text.find("queued") < text.find("fatal 42"));
+    logger.disable_async();
+}
+
+TEST_CASE("sync and async lines match", "[print_hpp::log::async]") {
+    auto log_twice = [](detail::ConsoleLogger &logger) {
+        for (int i = 0; i < 2; i++) {
+            logger.warn("value {} of {}", i, "two");
+        }
+    };
+    // Drops the timestamps, which differ
+    auto strip = [](const std::string &text) {
+        std::string out;
+        for (std::size_t pos = 0; pos < text.size();) {
+            auto end = text.find('\n', pos);
+            out += text.substr(pos + 23, end - pos - 23) + '\n';
+            pos = end + 1;
+        }
+        return out;
+    };
+
+    std::string sync_text;
+    {
+        capture_clog captured;
+        auto         logger = detail::ConsoleLogger();
+        logger.set_clock(LogClock::COARSE);
+        log_twice(logger);
+        sync_text = captured.str();
+    }
+    std::string async_text;
+    {
+        capture_clog captured;
+        auto         logger = detail::ConsoleLogger();
+        logger.enable_async();
+        log_twice(logger);
+        logger.disable_async();
+        async_text = captured.str();
+    }
+
+    REQUIRE(std::count(sync_text.begin(), sync_text.end(), '\n') == 2);
+    REQUIRE(sync_text.find("value 1 of two\n") != std::string::npos);
+    REQUIRE(strip(sync_text) == strip(async_text));
+}
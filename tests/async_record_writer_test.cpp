@@ -0,0 +1,137 @@
+#include "struct_pack.hpp"
+#include "struct_pack/async_record_writer.hpp"
+
+#include <cstdio>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std::string_view_literals;
+
+namespace {
+using Fmt = decltype("<Q4s"_fmt);
+
+auto read_back(std::FILE *file) -> std::string {
+    std::string contents;
+    char        chunk[4096];
+    std::rewind(file);
+    while (auto n = std::fread(chunk, 1, sizeof(chunk), file)) {
+        contents.append(chunk, n);
+    }
+    return contents;
+}
+
+void write_and_check(struct_pack::write_backend backend) {
+    auto *file = std::tmpfile();
+    REQUIRE(file != nullptr);
+
+    constexpr uint64_t count = 10'000;
+    {
+        // 64 records per buffer, so many buffers cycle through the backend
+        auto writer = struct_pack::async_record_writer<Fmt>(
+            fileno(file), 768, 3, backend);
+        REQUIRE(writer.backend() == backend);
+        for (uint64_t i = 0; i < count; i++) {
+            writer.write(i, "rec");
+            REQUIRE(writer.in_flight() <= 2);
+        }
+        writer.drain();
+        REQUIRE(writer.in_flight() == 0);
+        REQUIRE(writer.records_written() == count);
+        REQUIRE(writer.bytes_written() == count * 12);
+
+        // The descriptor ends up positioned after the data
+        REQUIRE(::lseek(fileno(file), 0, SEEK_CUR) == count * 12);
+    }
+
+    auto contents = read_back(file);
+    auto view = std::string_view(contents);
+    REQUIRE(view.size() == count * 12);
+    for (uint64_t i = 0; i < count; i++) {
+        auto [value, str] = struct_pack::unpack(Fmt{}, view.substr(i * 12));
+        REQUIRE(value == i);
+        REQUIRE(str == "rec\0"sv);
+    }
+    std::fclose(file);
+}
+
+#if STRUCT_PACK_HAS_IO_URING
+// Only setting up the ring may fail; write errors must still fail the test
+auto io_uring_available() -> bool {
+    auto *file = std::tmpfile();
+    REQUIRE(file != nullptr);
+    bool available = true;
+    try {
+        auto writer = struct_pack::async_record_writer<Fmt>(
+            fileno(file), 768, 3, struct_pack::write_backend::io_uring);
+    } catch (const std::system_error &e) {
+        WARN("io_uring unavailable: " << e.what());
+        available = false;
+    }
+    std::fclose(file);
+    return available;
+}
+#endif
+} // namespace
+
+TEST_CASE("async_record_writer thread backend",
+          "[struct_pack::async_record_writer]") {
+    write_and_check(struct_pack::write_backend::thread);
+}
+
+#if STRUCT_PACK_HAS_IO_URING
+TEST_CASE("async_record_writer io_uring backend",
+          "[struct_pack::async_record_writer]") {
+    if (io_uring_available()) {
+        write_and_check(struct_pack::write_backend::io_uring);
+    }
+}
+#endif
+
+TEST_CASE("async_record_writer falls back for pipes",
+          "[struct_pack::async_record_writer]") {
+    int fds[2];
+    REQUIRE(::pipe(fds) == 0);
+    {
+        auto writer = struct_pack::async_record_writer<Fmt>(fds[1], 12);
+        REQUIRE(writer.backend() == struct_pack::write_backend::thread);
+
+        REQUIRE(writer.try_write(1, "a"));
+        REQUIRE(writer.try_write(2, "b"));
+        writer.drain();
+    }
+    char buffer[24];
+    REQUIRE(::read(fds[0], buffer, sizeof(buffer)) == 24);
+    REQUIRE(std::get<0>(
+                struct_pack::unpack(Fmt{}, std::string_view(buffer, 12)))
+            == 1);
+    REQUIRE(std::get<0>(struct_pack::unpack(
+                Fmt{}, std::string_view(buffer + 12, 12)))
+            == 2);
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+TEST_CASE("async_record_writer reports failed writes",
+          "[struct_pack::async_record_writer]") {
+    int fd = ::open("/dev/null", O_RDONLY);
+    REQUIRE(fd >= 0);
+    for (auto backend : {struct_pack::write_backend::thread,
+                         struct_pack::write_backend::automatic}) {
+        // Leaving the scope must not wait forever on the failed writes
+        auto writer = struct_pack::async_record_writer<Fmt>(fd, 12, 3, backend);
+        writer.write(1, "a");
+        writer.write(2, "b");
+        writer.write(3, "c");
+        REQUIRE_THROWS_AS(writer.drain(), std::system_error);
+        REQUIRE(writer.bytes_written() == 0);
+
+        // The first error sticks
+        REQUIRE_THROWS_AS(writer.write(4, "d"), std::system_error);
+        REQUIRE_THROWS_AS(writer.drain(), std::system_error);
+    }
+    ::close(fd);
+}
@@ -0,0 +1,115 @@
+#include "struct_pack/binary_log.hpp"
+
+#include <string>
+
+#include <catch2/catch.hpp>
+
+using namespace print_hpp::log;
+
+namespace {
+// The decoded text without the timestamp and colors
+auto strip(std::string text) -> std::string {
+    std::string out;
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+        auto end = text.find('\n', pos);
+        auto line = text.substr(pos, end - pos);
+        out += line.substr(line.rfind("\033[0m") + 5) + '\n';
+        pos = end + 1;
+    }
+    return out;
+}
+} // namespace
+
+TEST_CASE("binary log round trip", "[print_hpp::log::binary]") {
+    auto writer = BinaryLogWriter(64);
+    auto name = std::string("disk0");
+    for (int i = 0; i < 3; i++) {
+        BINARY_LOG(writer,
+                   INFO,
+                   "read {} bytes from {} ({:.1f}%, {:#x}) {}",
+                   std::uint64_t{4096} * i,
+                   name,
+                   12.5,
+                   255,
+                   i == 1);
+    }
+    BINARY_LOG(writer, WARN, "no arguments");
+    BINARY_LOG(writer, ERROR, "{1}{0} {2}", 'a', "literal", std::int8_t{-3});
+
+    auto decoder = BinaryLogDecoder();
+    auto text = decoder.decode(std::string_view(writer.data(), writer.size()));
+    REQUIRE(strip(text)
+            == "read 0 bytes from disk0 (12.5%, 0xff) false\n"
+               "read 4096 bytes from disk0 (12.5%, 0xff) true\n"
+               "read 8192 bytes from disk0 (12.5%, 0xff) false\n"
+               "no arguments\n"
+               "literala -3\n");
+    REQUIRE(text.find("binary_log_test.cpp:") != std::string::npos);
+    REQUIRE(text.find("ERROR") != std::string::npos);
+}
+
+TEST_CASE("binary log decodes in chunks", "[print_hpp::log::binary]") {
+    auto writer = BinaryLogWriter();
+    for (int i = 0; i < 10; i++) {
+        BINARY_LOG(writer, INFO, "message {}", i);
+    }
+    auto bytes = std::string(writer.data(), writer.size());
+
+    // Sites are described once per stream, so clear() keeps the stream going
+    writer.clear();
+    BINARY_LOG(writer, INFO, "still {}", "decodable");
+    auto more = std::string(writer.data(), writer.size());
+
+    auto        decoder = BinaryLogDecoder();
+    std::string text;
+    std::size_t messages = 0;
+    for (std::size_t i = 0; i < bytes.size(); i += 7) {
+        messages += decoder.decode(std::string_view(bytes).substr(i, 7), text);
+    }
+    messages += decoder.decode(more, text);
+    REQUIRE(messages == 11);
+    REQUIRE(strip(text).starts_with("message 0\nmessage 1\n"));
+    REQUIRE(strip(text).ends_with("message 9\nstill decodable\n"));
+}
+
+TEST_CASE("binary log level and restart", "[print_hpp::log::binary]") {
+    auto writer = BinaryLogWriter();
+    writer.set_level(LogLevel::WARN);
+    BINARY_LOG(writer, INFO, "filtered {}", 1);
+    REQUIRE(writer.size() == 0);
+
+    auto kept = [&writer](int i) {
+        BINARY_LOG(writer, WARN, "kept {}", i);
+    };
+    kept(2);
+    writer.restart();
+    kept(3);
+    auto decoder = BinaryLogDecoder();
+    auto text = decoder.decode(std::string_view(writer.data(), writer.size()));
+    REQUIRE(strip(text) == "kept 3\n");
+
+    // After clear() the site is not described again
+    writer.clear();
+    kept(4);
+    auto fresh = BinaryLogDecoder();
+    REQUIRE_THROWS_AS(
+        fresh.decode(std::string_view(writer.data(), writer.size())),
+        std::runtime_error);
+}
+
+TEST_CASE("binary log site ids come from the input",
+          "[print_hpp::log::binary]") {
+    auto writer = BinaryLogWriter();
+    BINARY_LOG(writer, WARN, "sparse {}", 5);
+    auto bytes = std::string(writer.data(), writer.size());
+
+    // A huge id in the site and the message records sizes nothing
+    auto site_size = std::get<0>(
+        struct_pack::unpack(detail::binary_length, bytes.substr(0, 4)));
+    for (std::size_t at : {std::size_t{5}, std::size_t{site_size} + 5}) {
+        bytes.replace(at, 4, "\xf0\xff\xff\xff");
+    }
+    auto decoder = BinaryLogDecoder();
+    REQUIRE(strip(decoder.decode(bytes)) == "sparse 5\n");
+}
@@ -0,0 +1,130 @@
+#include "struct_pack.hpp"
+#include "struct_pack/block_file.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+
+using namespace std::string_view_literals;
+
+namespace {
+// time, id, price, symbol
+using Tick = decltype("<qId4s"_fmt);
+
+// An anonymous file to write and read back
+class temp_fd {
+public:
+    temp_fd()
+        : fd_{::memfd_create("block_file_test", MFD_CLOEXEC)} {}
+
+    ~temp_fd() {
+        ::close(fd_);
+    }
+
+    auto get() const -> int {
+        return fd_;
+    }
+
+private:
+    int fd_;
+};
+
+void write_ticks(int fd, int64_t count, std::size_t block_records) {
+    auto writer = struct_pack::block_file_writer<Tick, 0, 2>(fd, block_records);
+    for (int64_t t = 0; t < count; t++) {
+        writer.write(t * 10,
+                     static_cast<uint32_t>(t % 7),
+                     100.0 + static_cast<double>(t % 50),
+                     "ABCD");
+    }
+}
+} // namespace
+
+TEST_CASE("block_file round trip", "[struct_pack::block_file]") {
+    temp_fd file;
+    write_ticks(file.get(), 1000, 64);
+
+    auto reader = struct_pack::block_file_reader<Tick>(file.get());
+    REQUIRE(reader.blocks().size() == 16); // 15 full blocks and a short one
+    REQUIRE(reader.blocks().back().records == 1000 - 15 * 64);
+    REQUIRE(reader.records() == 1000);
+    REQUIRE(reader.has_zone_map(0));
+    REQUIRE(!reader.has_zone_map(1));
+
+    int64_t next = 0;
+    REQUIRE(reader.for_each([&](auto record) {
+        auto [time, id, price, symbol] = record.unpack();
+        REQUIRE(time == next * 10);
+        REQUIRE(id == next % 7);
+        REQUIRE(symbol == "ABCD"sv);
+        next++;
+    }) == 1000);
+}
+
+TEST_CASE("block_file range scans skip blocks", "[struct_pack::block_file]") {
+    temp_fd file;
+    write_ticks(file.get(), 10'000, 100);
+    auto reader = struct_pack::block_file_reader<Tick>(file.get());
+    REQUIRE(reader.blocks().size() == 100);
+
+    // Times 25000..25990 are records 2500..2599, all of block 25
+    std::vector<int64_t> times;
+    REQUIRE(reader.scan_range<0>(25'000, 25'990, [&](auto record) {
+        times.push_back(record.template get<0>());
+    }) == 100);
+    REQUIRE(times.front() == 25'000);
+    REQUIRE(times.back() == 25'990);
+    REQUIRE(reader.blocks_read() == 1);
+    REQUIRE(reader.blocks_skipped() == 99);
+
+    // Prices repeat in every block, so nothing can be skipped
+    REQUIRE(reader.scan_range<2>(149.0, 200.0, [](auto) {}) == 200);
+    REQUIRE(reader.blocks_skipped() == 99);
+
+    // No zone map for the id: every block is read and filtered
+    REQUIRE(reader.scan_range<1>(3u, 3u, [](auto record) {
+        REQUIRE(record.template get<1>() == 3);
+    }) == 1429);
+
+    // Out of range altogether
+    REQUIRE(reader.scan_range<0>(-100, -1, [](auto) {}) == 0);
+
+    // Signed bounds on the unsigned id are clamped rather than wrapped
+    REQUIRE(reader.scan_range<1>(-1, 5, [](auto record) {
+        REQUIRE(record.template get<1>() <= 5);
+    }) == 10'000 - 1428);
+    REQUIRE(reader.scan_range<1>(-5, -1, [](auto) {}) == 0);
+}
+
+TEST_CASE("block_file checks the format", "[struct_pack::block_file]") {
+    temp_fd file;
+    write_ticks(file.get(), 10, 4);
+
+    using Other = decltype("<qIf4s"_fmt);
+    REQUIRE_THROWS_AS(struct_pack::block_file_reader<Other>(file.get()),
+                      std::system_error);
+
+    temp_fd not_a_block_file;
+    REQUIRE(::write(not_a_block_file.get(), "plain records here", 18) == 18);
+    REQUIRE_THROWS_AS(
+        struct_pack::block_file_reader<Tick>(not_a_block_file.get()),
+        std::system_error);
+}
+
+TEST_CASE("block_file ignores a torn last block",
+          "[struct_pack::block_file]") {
+    temp_fd file;
+    write_ticks(file.get(), 100, 40);
+    auto size = ::lseek(file.get(), 0, SEEK_END);
+    REQUIRE(::ftruncate(file.get(), size - 5) == 0);
+
+    auto reader = struct_pack::block_file_reader<Tick>(file.get());
+    REQUIRE(reader.blocks().size() == 2);
+    REQUIRE(reader.records() == 80);
+}
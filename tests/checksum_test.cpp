@@ -0,0 +1,93 @@
+#include "struct_pack.hpp"
+#include "struct_pack/checksum.hpp"
+
+#include <string>
+
+#include <catch2/catch.hpp>
+
+using namespace std::string_view_literals;
+
+namespace {
+template <typename Checksum>
+auto checksum_of(std::string_view str) {
+    return Checksum::compute(str.data(), str.size());
+}
+} // namespace
+
+TEST_CASE("crc32c known values", "[struct_pack::crc32c]") {
+    REQUIRE(checksum_of<struct_pack::crc32c>("") == 0);
+    REQUIRE(checksum_of<struct_pack::crc32c>("123456789") == 0xE3069283);
+    // RFC 3720, B.4
+    REQUIRE(checksum_of<struct_pack::crc32c>(std::string(32, '\x00'))
+            == 0x8A9136AA);
+    REQUIRE(checksum_of<struct_pack::crc32c>(std::string(32, '\xff'))
+            == 0x62A8AB43);
+
+    // The hardware and table implementations agree for every length and
+    // alignment
+    std::string data;
+    for (int i = 0; i < 300; i++) {
+        data.push_back(static_cast<char>(i * 131 + 7));
+    }
+    for (std::size_t offset = 0; offset < 8; offset++) {
+        for (std::size_t size = 0; size + offset <= data.size(); size += 13) {
+            auto expected = ~struct_pack::detail::crc32c_portable(
+                data.data() + offset, size, ~0U);
+            REQUIRE(struct_pack::crc32c::compute(data.data() + offset, size)
+                    == expected);
+        }
+    }
+}
+
+TEST_CASE("xxhash64 known values", "[struct_pack::xxhash64]") {
+    REQUIRE(checksum_of<struct_pack::xxhash64>("") == 0xEF46DB3751D8E999);
+    REQUIRE(checksum_of<struct_pack::xxhash64>("a") == 0xD24EC4F1A98C6E5B);
+    REQUIRE(checksum_of<struct_pack::xxhash64>("abc") == 0x44BC2CF5AD770999);
+    REQUIRE(checksum_of<struct_pack::xxhash64>(
+                "Nobody inspects the spammish repetition")
+            == 0xFBCEA83C8A378BF1);
+    static_assert(struct_pack::xxhash64::compute("abc", 3)
+                  == 0x44BC2CF5AD770999);
+}
+
+TEST_CASE("checksummed records", "[struct_pack::pack_checksummed]") {
+    constexpr auto fmt = ">Ih5s"_fmt;
+    static_assert(struct_pack::checksummed_size<struct_pack::crc32c>(fmt)
+                  == 15);
+    static_assert(struct_pack::checksummed_size<struct_pack::xxhash64>(fmt)
+                  == 19);
+
+    auto packed
+        = struct_pack::pack_checksummed<struct_pack::crc32c>(fmt, 7, -2, "hi");
+    auto record = struct_pack::pack(fmt, 7, -2, "hi");
+    REQUIRE(std::string_view(packed.data(), 11)
+            == std::string_view(record.data(), 11));
+    // Big endian format, so a big endian checksum
+    auto crc = struct_pack::crc32c::compute(record.data(), record.size());
+    REQUIRE(std::get<0>(struct_pack::unpack(
+                ">I"_fmt, std::string_view(packed.data() + 11, 4)))
+            == crc);
+
+    auto unpacked = struct_pack::unpack_checksummed<struct_pack::crc32c>(
+        fmt, std::string_view(packed.data(), packed.size()));
+    REQUIRE(unpacked.has_value());
+    REQUIRE(std::get<0>(*unpacked) == 7);
+    REQUIRE(std::get<1>(*unpacked) == -2);
+    REQUIRE(std::get<2>(*unpacked) == "hi\0\0\0"sv);
+
+    // Any flipped bit is detected
+    for (std::size_t i = 0; i < packed.size(); i++) {
+        auto corrupted = packed;
+        corrupted[i] ^= 0x10;
+        REQUIRE_FALSE(struct_pack::unpack_checksummed<struct_pack::crc32c>(
+            fmt, std::string_view(corrupted.data(), corrupted.size())));
+    }
+    // Truncated input
+    REQUIRE_FALSE(struct_pack::unpack_checksummed<struct_pack::crc32c>(
+        fmt, std::string_view(packed.data(), packed.size() - 1)));
+
+    auto hashed
+        = struct_pack::pack_checksummed<struct_pack::xxhash64>(fmt, 1, 2, "x");
+    REQUIRE(struct_pack::unpack_checksummed<struct_pack::xxhash64>(
+        fmt, std::string_view(hashed.data(), hashed.size())));
+}
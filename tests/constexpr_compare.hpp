@@ -2,6 +2,8 @@
 
 #include <array>
 #include <string_view>
+#include <tuple>
+#include <utility>
 
 template <size_t ArrSize>
 constexpr bool operator==(const std::array<char, ArrSize> &arr,
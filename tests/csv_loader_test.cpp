@@ -0,0 +1,137 @@
+#include "struct_pack.hpp"
+#include "struct_pack/csv_loader.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+
+using namespace std::string_view_literals;
+
+namespace {
+// time, id, price, active, symbol
+using Tick = decltype("<qHd?6s"_fmt);
+
+auto make_csv(std::size_t lines) -> std::string {
+    std::string text = "time,id,price,active,symbol\n";
+    for (std::size_t i = 0; i < lines; i++) {
+        text += std::to_string(1'700'000'000'000 + i) + ","
+                + std::to_string(i % 60'000) + "," + std::to_string(i) + ".25,"
+                + (i % 2 == 0 ? "true" : "0") + ",S" + std::to_string(i % 97)
+                + "\n";
+    }
+    return text;
+}
+
+void check_records(const struct_pack::record_buffer<Tick> &records,
+                   std::size_t                              lines) {
+    REQUIRE(records.size() == lines);
+    for (std::size_t i = 0; i < lines; i++) {
+        auto expected = struct_pack::pack(
+            Tick{},
+            static_cast<int64_t>(1'700'000'000'000 + i),
+            static_cast<uint16_t>(i % 60'000),
+            static_cast<double>(i) + 0.25,
+            i % 2 == 0,
+            "S" + std::to_string(i % 97));
+        REQUIRE(records[i].bytes()
+                == std::string_view(expected.data(), expected.size()));
+    }
+}
+} // namespace
+
+TEST_CASE("parse_csv packs fields in place", "[struct_pack::csv_loader]") {
+    auto builder = struct_pack::record_builder<Tick>();
+    REQUIRE(struct_pack::parse_csv("1,2,3.5,1,abc\n"
+                                   "\n"
+                                   "-4,5,-6e2,false,\"a,\"\"b\"\r\n"
+                                   "7,8,9,true,\"\"",
+                                   builder)
+            == 3);
+    REQUIRE(builder[0].unpack()
+            == std::tuple(int64_t{1}, uint16_t{2}, 3.5, true, "abc\0\0\0"sv));
+    REQUIRE(builder[1].unpack()
+            == std::tuple(
+                int64_t{-4}, uint16_t{5}, -600.0, false, "a,\"b\0\0"sv));
+    REQUIRE(builder[2].get<4>() == "\0\0\0\0\0\0"sv);
+
+    // Other delimiters, big endian and padding that takes no field
+    auto big = struct_pack::record_builder<decltype(">I2xc"_fmt)>();
+    REQUIRE(struct_pack::parse_csv("258\tz\n", big, '\t') == 1);
+    REQUIRE(big.bytes() == "\0\0\x01\x02\0\0z"sv);
+}
+
+TEST_CASE("parse_csv reports bad lines", "[struct_pack::csv_loader]") {
+    auto builder = struct_pack::record_builder<Tick>();
+    auto error_of = [&](std::string_view text) -> std::string {
+        try {
+            struct_pack::parse_csv(text, builder);
+        } catch (const std::system_error &e) {
+            REQUIRE(e.code() == std::errc::invalid_argument);
+            return e.what();
+        }
+        return "no error";
+    };
+    REQUIRE_THAT(error_of("1,2,3,1,a\n1,2,3,1\n"),
+                 Catch::Contains("line 2: too few fields"));
+    REQUIRE_THAT(error_of("1,2,3,1,a,extra\n"),
+                 Catch::Contains("line 1: too many fields"));
+    REQUIRE_THAT(error_of("\n\n1,70000,3,1,a\n"),
+                 Catch::Contains("line 3: bad field"));
+    REQUIRE_THAT(error_of("1,2,3x,1,a\n"), Catch::Contains("bad field"));
+    REQUIRE_THAT(error_of("1,2,3,yes,a\n"), Catch::Contains("bad field"));
+    REQUIRE_THAT(error_of("1,2,3,1,toolong\n"), Catch::Contains("bad field"));
+    REQUIRE_THAT(error_of("1,2,3,1,\"a\n\"\n"),
+                 Catch::Contains("unterminated quote"));
+}
+
+TEST_CASE("parse_csv keeps only whole records on error",
+          "[struct_pack::csv_loader]") {
+    auto builder = struct_pack::record_builder<Tick>();
+    builder.append(int64_t{0}, uint16_t{0}, 0.0, false, "first");
+    REQUIRE_THROWS_AS(
+        struct_pack::parse_csv("1,2,3,1,a\n4,5,6,0,b\n7,8\n", builder),
+        std::system_error);
+    REQUIRE(builder.size() == 3);
+    REQUIRE(builder[2].get<4>() == "b\0\0\0\0\0"sv);
+}
+
+TEST_CASE("load_csv on many threads", "[struct_pack::csv_loader]") {
+    auto text = make_csv(20'000);
+    for (std::size_t threads : {1, 3, 8}) {
+        struct_pack::csv_options options;
+        options.header = true;
+        options.threads = threads;
+        check_records(struct_pack::load_csv(Tick{}, text, options), 20'000);
+    }
+
+    // Errors name the line in the whole text, whichever thread found them
+    text.insert(text.rfind("\n", text.size() - 2) + 1, "oops\n");
+    struct_pack::csv_options options;
+    options.header = true;
+    options.threads = 4;
+    REQUIRE_THROWS_WITH(struct_pack::load_csv(Tick{}, text, options),
+                        Catch::Contains("line 20001:"));
+}
+
+TEST_CASE("load_csv_file", "[struct_pack::csv_loader]") {
+    char path[] = "/tmp/csv_loader_testXXXXXX";
+    int  fd = ::mkstemp(path);
+    REQUIRE(fd >= 0);
+    auto text = make_csv(1000);
+    REQUIRE(::write(fd, text.data(), text.size())
+            == static_cast<ssize_t>(text.size()));
+    ::close(fd);
+
+    struct_pack::csv_options options;
+    options.header = true;
+    options.threads = 0;
+    check_records(struct_pack::load_csv_file(Tick{}, path, options), 1000);
+    ::unlink(path);
+
+    REQUIRE_THROWS_AS(struct_pack::load_csv_file(Tick{}, path),
+                      std::system_error);
+}
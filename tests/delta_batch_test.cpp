@@ -0,0 +1,133 @@
+#include "struct_pack.hpp"
+#include "struct_pack/delta_batch.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace {
+// sequence, time, id, price
+using Tick = decltype("<QqId"_fmt);
+
+template <typename Time>
+auto make_ticks(std::size_t count, Time &&time) -> std::string {
+    std::string records;
+    for (std::size_t i = 0; i < count; i++) {
+        auto packed = struct_pack::pack(Tick{},
+                                        static_cast<uint64_t>(1000 + i),
+                                        time(i),
+                                        static_cast<uint32_t>(i * 7919),
+                                        static_cast<double>(i) / 4);
+        records.append(packed.data(), packed.size());
+    }
+    return records;
+}
+
+auto steady_time(std::size_t i) -> int64_t {
+    return 1'700'000'000'000 + static_cast<int64_t>(i * 1000 + i % 13);
+}
+} // namespace
+
+TEST_CASE("delta_batch round trip", "[struct_pack::delta_batch]") {
+    for (std::size_t count : {0, 1, 2, 5, 8, 1000, 1001}) {
+        auto records = make_ticks(count, steady_time);
+        auto encoded = struct_pack::encode_delta<0, 1>(Tick{}, records);
+        auto batch = struct_pack::delta_batch<Tick, 0, 1>(encoded);
+        REQUIRE(batch.size() == count);
+
+        std::string decoded(records.size(), '\0');
+        REQUIRE(batch.decode_into(decoded.data()) == records.size());
+        REQUIRE(decoded == records);
+    }
+}
+
+TEST_CASE("delta_batch shrinks steady columns", "[struct_pack::delta_batch]") {
+    auto records = make_ticks(10'000, steady_time);
+    auto encoded = struct_pack::encode_delta<0, 1>(Tick{}, records);
+    auto batch = struct_pack::delta_batch<Tick, 0, 1>(encoded);
+
+    // Sequence numbers step by one: no bits at all. Times step by 1000
+    // to 1012: 4 bits.
+    REQUIRE(batch.bit_width<0>() == 0);
+    REQUIRE(batch.bit_width<1>() == 4);
+    REQUIRE(encoded.size() < records.size() / 2);
+
+    std::vector<uint64_t> sequence(batch.size());
+    batch.decode_column<0>(sequence.data());
+    std::vector<int64_t> times(batch.size());
+    batch.decode_column<1>(times.data());
+    for (std::size_t i = 0; i < batch.size(); i++) {
+        REQUIRE(sequence[i] == 1000 + i);
+        REQUIRE(times[i] == steady_time(i));
+        REQUIRE(batch.get<2>(i) == i * 7919);
+        REQUIRE(batch.get<3>(i) == static_cast<double>(i) / 4);
+    }
+}
+
+TEST_CASE("delta_batch handles any deltas", "[struct_pack::delta_batch]") {
+    // Decreasing, and jumping between the ends of the range
+    for (int shift = 0; shift < 64; shift += 7) {
+        // Wrapping arithmetic in uint64_t, which is well defined
+        auto records = make_ticks(333, [shift](std::size_t i) {
+            auto step = uint64_t{1} << shift;
+            auto n = static_cast<uint64_t>(i);
+            return static_cast<int64_t>(
+                i % 3 == 0 ? uint64_t{1} << 63 | n : INT64_MAX - n * step);
+        });
+        auto encoded = struct_pack::encode_delta<1, 2>(Tick{}, records);
+        auto batch = struct_pack::delta_batch<Tick, 1, 2>(encoded);
+
+        std::string decoded(records.size(), '\0');
+        batch.decode_into(decoded.data());
+        REQUIRE(decoded == records);
+        REQUIRE(batch.get<0>(10) == 1010);
+    }
+}
+
+TEST_CASE("delta_batch bit unpacking", "[struct_pack::delta_batch]") {
+    // The AVX2 and portable unpackers agree on every width
+    for (unsigned width = 1; width <= 64; width++) {
+        std::vector<uint64_t> values(203);
+        for (std::size_t i = 0; i < values.size(); i++) {
+            values[i] = (i * 0x9E3779B97F4A7C15ULL) >> (64 - width);
+        }
+        auto size = struct_pack::detail::delta_words_size(values.size() + 1,
+                                                          width);
+        std::vector<uint64_t> words(size / 8);
+        struct_pack::detail::pack_bits(
+            values.data(), values.size(), width, words.data());
+        std::string bytes(size, '\0');
+        for (std::size_t w = 0; w < words.size(); w++) {
+            auto view = struct_pack::data_view<char>(bytes.data() + w * 8,
+                                                     false);
+            struct_pack::data::store(view, words[w]);
+        }
+
+        std::vector<uint64_t> fast(values.size() + 3);
+        std::vector<uint64_t> portable(values.size() + 3);
+        auto                  groups = fast.size() / 4;
+        struct_pack::detail::bit_cursor cursor;
+        struct_pack::detail::unpack_bits(
+            bytes.data(), width, cursor, fast.data(), groups);
+        cursor = {};
+        struct_pack::detail::unpack_bits_portable(
+            bytes.data(), width, cursor, portable.data(), groups);
+        fast.resize(values.size());
+        portable.resize(values.size());
+        REQUIRE(fast == values);
+        REQUIRE(portable == values);
+    }
+}
+
+TEST_CASE("delta_batch rejects bad input", "[struct_pack::delta_batch]") {
+    auto encoded = struct_pack::encode_delta<0, 1>(Tick{},
+                                                   make_ticks(10, steady_time));
+    using Batch = struct_pack::delta_batch<Tick, 0, 1>;
+    REQUIRE_THROWS_AS(Batch(std::string_view(encoded).substr(0, 30)),
+                      std::system_error);
+    REQUIRE_THROWS_AS((struct_pack::delta_batch<Tick, 0>(encoded)),
+                      std::system_error);
+    REQUIRE_THROWS_AS(Batch("not a batch at all"), std::system_error);
+}
@@ -0,0 +1,109 @@
+#include "struct_pack.hpp"
+#include "struct_pack/dictionary_batch.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using namespace std::string_view_literals;
+
+namespace {
+// time, id, price, symbol
+using Tick = decltype("<qId8s"_fmt);
+
+auto make_ticks(int64_t count, int64_t symbols) -> std::string {
+    std::string records;
+    for (int64_t t = 0; t < count; t++) {
+        auto symbol = "SYM" + std::to_string(t % symbols);
+        auto packed = struct_pack::pack(Tick{},
+                                        t,
+                                        static_cast<uint32_t>(t),
+                                        static_cast<double>(t) / 2,
+                                        symbol);
+        records.append(packed.data(), packed.size());
+    }
+    return records;
+}
+} // namespace
+
+TEST_CASE("dictionary_batch round trip", "[struct_pack::dictionary_batch]") {
+    auto records = make_ticks(1000, 5);
+    auto encoded = struct_pack::encode_dictionary<3>(Tick{}, records);
+    REQUIRE(encoded.size() < records.size());
+
+    auto batch = struct_pack::dictionary_batch<Tick, 3>(encoded);
+    REQUIRE(batch.size() == 1000);
+    REQUIRE(batch.dictionary_size() == 5);
+    REQUIRE(encoded.size() == decltype(batch)::encoded_size(1000, 5));
+
+    // Codes in order of first appearance
+    REQUIRE(batch.code(0) == 0);
+    REQUIRE(batch.code(7) == 2);
+    REQUIRE(batch.entry(2) == "SYM2\0\0\0\0"sv);
+
+    constexpr auto size = struct_pack::calcsize(Tick{});
+    for (std::size_t i = 0; i < batch.size(); i++) {
+        auto original = struct_pack::unpack(
+            Tick{}, std::string_view(records).substr(i * size, size));
+        REQUIRE(batch.unpack(i) == original);
+    }
+    REQUIRE(batch.get<0>(999) == 999);
+    REQUIRE(batch.get<2>(3) == 1.5);
+
+    std::string decoded(records.size(), '\0');
+    REQUIRE(batch.decode_into(decoded.data()) == records.size());
+    REQUIRE(decoded == records);
+}
+
+TEST_CASE("dictionary_batch equality filter",
+          "[struct_pack::dictionary_batch]") {
+    auto records = make_ticks(100, 10);
+    auto encoded = struct_pack::encode_dictionary<3>(Tick{}, records);
+    auto batch = struct_pack::dictionary_batch<Tick, 3>(encoded);
+
+    REQUIRE(batch.find("SYM4") == 4u);
+    REQUIRE(!batch.find("SYM"));
+    REQUIRE(!batch.find("SYM4 and more"));
+
+    std::vector<int64_t> times;
+    REQUIRE(batch.for_each_equal("SYM4", [&](std::size_t i) {
+        times.push_back(batch.get<0>(i));
+    }) == 10);
+    REQUIRE(times.front() == 4);
+    REQUIRE(times.back() == 94);
+    REQUIRE(batch.for_each_equal("MISSING", [](std::size_t) {}) == 0);
+}
+
+TEST_CASE("dictionary_batch code widths", "[struct_pack::dictionary_batch]") {
+    for (int64_t symbols : {1, 256, 257, 5000}) {
+        auto records = make_ticks(6000, symbols);
+        auto encoded = struct_pack::encode_dictionary<3>(Tick{}, records);
+        auto batch = struct_pack::dictionary_batch<Tick, 3>(encoded);
+        REQUIRE(batch.dictionary_size() == static_cast<std::size_t>(symbols));
+        REQUIRE(batch.code(5999) == 5999 % symbols);
+        REQUIRE(batch.for_each_equal("SYM0", [](std::size_t) {})
+                == static_cast<std::size_t>((6000 + symbols - 1) / symbols));
+    }
+
+    auto empty = struct_pack::encode_dictionary<3>(Tick{}, std::string());
+    REQUIRE(struct_pack::dictionary_batch<Tick, 3>(empty).empty());
+}
+
+TEST_CASE("dictionary_batch rejects bad input",
+          "[struct_pack::dictionary_batch]") {
+    auto encoded
+        = struct_pack::encode_dictionary<3>(Tick{}, make_ticks(10, 3));
+    using Batch = struct_pack::dictionary_batch<Tick, 3>;
+    REQUIRE_THROWS_AS(Batch(std::string_view(encoded).substr(0, 20)),
+                      std::system_error);
+    REQUIRE_THROWS_AS(Batch("not a batch at all"), std::system_error);
+
+    // A code past the three entries
+    auto corrupt = encoded;
+    corrupt[struct_pack::detail::dictionary_batch_header_size
+            + 3 * Batch::item_size + 4]
+        = 3;
+    REQUIRE_THROWS_AS(Batch(corrupt), std::system_error);
+}
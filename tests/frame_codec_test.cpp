@@ -0,0 +1,114 @@
+#include "struct_pack.hpp"
+#include "struct_pack/frame_codec.hpp"
+
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using namespace std::string_view_literals;
+
+TEST_CASE("mirrored_ring_buffer wraps contiguously",
+          "[struct_pack::mirrored_ring_buffer]") {
+    auto ring = struct_pack::mirrored_ring_buffer(1);
+    REQUIRE(ring.capacity() >= 4096);
+    REQUIRE((ring.capacity() & (ring.capacity() - 1)) == 0);
+
+    // Move the read position close to the end of the ring
+    ring.commit(ring.capacity() - 3);
+    ring.consume(ring.capacity() - 3);
+    REQUIRE(ring.empty());
+
+    auto space = ring.writable();
+    REQUIRE(space.size() == ring.capacity());
+    std::copy_n("abcdefgh", 8, space.data());
+    ring.commit(8);
+
+    // Readable across the wrap point without copying
+    REQUIRE(ring.readable() == "abcdefgh"sv);
+    ring.consume(8);
+    REQUIRE(ring.empty());
+}
+
+TEST_CASE("pack_frame writes the length prefix", "[struct_pack::frame]") {
+    constexpr auto len = "!H"_fmt;
+    constexpr auto body = "<Ic"_fmt;
+    static_assert(struct_pack::frame_size(len, body) == 7);
+
+    char frame[7];
+    REQUIRE(struct_pack::pack_frame(len, body, frame, 0x01020304, 'z') == 7);
+    REQUIRE(std::string_view(frame, 7) == "\x00\x05\x04\x03\x02\x01z"sv);
+}
+
+TEST_CASE("frame_decoder reassembles frames", "[struct_pack::frame_decoder]") {
+    constexpr auto len = "!I"_fmt;
+    constexpr auto body = "<Q5s"_fmt;
+
+    std::string stream;
+    for (uint64_t i = 0; i < 2000; i++) {
+        char frame[struct_pack::frame_size(len, body)];
+        auto n = struct_pack::pack_frame(len, body, frame, i, "hello");
+        stream.append(frame, n);
+    }
+
+    for (std::size_t chunk_size : {1, 16, 17, 1000, 8192}) {
+        // A small ring so frames regularly wrap around its end
+        auto decoder = struct_pack::frame_decoder<decltype(len)>(64);
+        auto ids = std::vector<uint64_t>{};
+        auto view = std::string_view(stream);
+        while (!view.empty()) {
+            auto chunk = view.substr(0, chunk_size);
+            view.remove_prefix(chunk.size());
+            decoder.feed(chunk, [&](std::string_view frame_body) {
+                auto [id, str] = struct_pack::unpack(body, frame_body);
+                REQUIRE(str == "hello"sv);
+                ids.push_back(id);
+            });
+        }
+        REQUIRE(decoder.buffered() == 0);
+        REQUIRE(ids.size() == 2000);
+        for (uint64_t i = 0; i < ids.size(); i++) {
+            REQUIRE(ids[i] == i);
+        }
+    }
+}
+
+TEST_CASE("frame_decoder receives in place", "[struct_pack::frame_decoder]") {
+    auto decoder = struct_pack::frame_decoder<decltype("!H"_fmt)>(4096);
+
+    auto space = decoder.writable();
+    auto first = "\x00\x03"
+                 "abc"
+                 "\x00\x02"
+                 "d"sv;
+    std::copy(first.begin(), first.end(), space.data());
+    decoder.commit(first.size());
+
+    auto frames = std::vector<std::string>{};
+    auto collect = [&](std::string_view frame_body) {
+        frames.emplace_back(frame_body);
+    };
+    REQUIRE(decoder.decode(collect) == 1);
+    REQUIRE(decoder.buffered() == 3);
+
+    space = decoder.writable();
+    space[0] = 'e';
+    decoder.commit(1);
+    REQUIRE(decoder.decode(collect) == 1);
+    REQUIRE(frames == std::vector<std::string>{"abc", "de"});
+}
+
+TEST_CASE("frame_decoder rejects oversized frames",
+          "[struct_pack::frame_decoder]") {
+    auto decoder = struct_pack::frame_decoder<decltype("!I"_fmt)>(4096);
+    REQUIRE_THROWS_AS(decoder.feed("\x00\x01\x00\x00"sv, [](auto) {}),
+                      std::length_error);
+}
+
+TEST_CASE("frame_decoder rejects lengths that overflow",
+          "[struct_pack::frame_decoder]") {
+    auto decoder = struct_pack::frame_decoder<decltype("!Q"_fmt)>(4096);
+    REQUIRE_THROWS_AS(
+        decoder.feed("\xff\xff\xff\xff\xff\xff\xff\xfc"sv, [](auto) {}),
+        std::length_error);
+}
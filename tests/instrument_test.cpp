@@ -0,0 +1,67 @@
+#define STRUCT_PACK_INSTRUMENTATION 1
+
+#include "struct_pack.hpp"
+#include "struct_pack/instrument.hpp"
+
+#include <numeric>
+#include <thread>
+
+#include <catch2/catch.hpp>
+
+using namespace std::string_view_literals;
+
+namespace {
+auto histogram_total(const struct_pack::format_stats &stats)
+    -> std::uint64_t {
+    return std::accumulate(
+        stats.cycle_histogram.begin(), stats.cycle_histogram.end(), 0ULL);
+}
+} // namespace
+
+TEST_CASE("per-format counters", "[struct_pack::instrumented]") {
+    auto &registry = struct_pack::format_registry::instance();
+    registry.reset();
+
+    constexpr auto fmt = "<Ih"_fmt;
+    for (int i = 0; i < 10; i++) {
+        auto packed = struct_pack::instrumented::pack(fmt, i, -1);
+        auto [a, b] = struct_pack::instrumented::unpack(
+            fmt, std::string_view(packed.data(), packed.size()));
+        REQUIRE(a == static_cast<unsigned>(i));
+        REQUIRE(b == -1);
+    }
+    REQUIRE_FALSE(struct_pack::instrumented::try_unpack(fmt, "\x01"sv));
+
+    // Other threads count into their own shards; snapshot() merges them,
+    // including those of threads that already exited
+    std::thread([] {
+        char buffer[8];
+        for (int i = 0; i < 5; i++) {
+            struct_pack::instrumented::pack_into("<Ih"_fmt, buffer, i, 1);
+            struct_pack::instrumented::pack_into(">Q"_fmt, buffer, i);
+        }
+    }).join();
+
+    auto stats = registry.snapshot();
+    REQUIRE(stats.size() >= 2);
+
+    const auto &ih = stats.at("<Ih");
+    REQUIRE(ih.packs == 15);
+    REQUIRE(ih.bytes_packed == 15 * 6);
+    REQUIRE(ih.unpacks == 10);
+    REQUIRE(ih.bytes_unpacked == 10 * 6);
+    REQUIRE(ih.unpack_failures == 1);
+    REQUIRE(histogram_total(ih) == 26);
+
+    const auto &q = stats.at(">Q");
+    REQUIRE(q.packs == 5);
+    REQUIRE(q.bytes_packed == 40);
+
+    auto json = registry.to_json();
+    REQUIRE(json.find(R"({"format":"<Ih","packs":15,"unpacks":10,)")
+            != std::string::npos);
+    REQUIRE(registry.to_text().find(">Q: packs=5 ") != std::string::npos);
+
+    registry.reset();
+    REQUIRE(registry.snapshot().at("<Ih").packs == 0);
+}
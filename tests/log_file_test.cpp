@@ -0,0 +1,213 @@
+#include "struct_pack/log_file.hpp"
+
+#include "struct_pack/binary_log.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using namespace print_hpp::log;
+
+namespace {
+// A fresh directory under the system temp dir, removed afterwards
+class temp_dir {
+public:
+    explicit temp_dir(const std::string &name)
+        : path_{std::filesystem::temp_directory_path()
+                / (name + "." + std::to_string(::getpid()))} {
+        std::filesystem::remove_all(path_);
+        std::filesystem::create_directories(path_);
+    }
+
+    ~temp_dir() {
+        std::filesystem::remove_all(path_);
+    }
+
+    auto file(const std::string &name) const -> std::string {
+        return (path_ / name).string();
+    }
+
+    auto count() const -> std::size_t {
+        return static_cast<std::size_t>(std::distance(
+            std::filesystem::directory_iterator(path_),
+            std::filesystem::directory_iterator()));
+    }
+
+private:
+    std::filesystem::path path_;
+};
+
+auto read_file(const std::string &path) -> std::string {
+    std::ifstream      in(path, std::ios::binary);
+    std::ostringstream out;
+    out << in.rdbuf();
+    return out.str();
+}
+
+// Every segment of `path` in order, concatenated
+auto read_segments(const std::string &path) -> std::string {
+    std::string text;
+    for (int i = 0; std::filesystem::exists(path + "." + std::to_string(i));
+         i++) {
+        text += read_file(path + "." + std::to_string(i));
+    }
+    return text;
+}
+} // namespace
+
+TEST_CASE("file sink rotates by size", "[print_hpp::log::file]") {
+    temp_dir    dir("log_file_test_size");
+    auto        path = dir.file("app.log");
+    std::string batch;
+    for (int i = 10; i < 20; i++) {
+        batch += "line " + std::to_string(i) + " 012345678\n";
+    }
+    {
+        auto sink = MmapFileSink({.path = path, .segment_size = 64});
+        for (int i = 0; i < 10; i++) {
+            sink.write("line " + std::to_string(i) + " 0123456789\n");
+        }
+        REQUIRE(sink.rotations() == 3);
+        REQUIRE(sink.dropped() == 0);
+
+        // A line larger than a segment is dropped
+        sink.write(std::string(65, 'x'));
+        REQUIRE(sink.dropped() == 1);
+
+        // A longer write is split between lines
+        sink.write(batch);
+        REQUIRE(sink.dropped() == 1);
+    }
+
+    // Each 18-byte line fits three to a segment, and finished segments are
+    // trimmed to what was written
+    REQUIRE(std::filesystem::file_size(path + ".0") == 54);
+    REQUIRE(std::filesystem::file_size(path + ".3") == 18);
+    std::string expected;
+    for (int i = 0; i < 10; i++) {
+        expected += "line " + std::to_string(i) + " 0123456789\n";
+    }
+    REQUIRE(read_segments(path) == expected + batch);
+}
+
+TEST_CASE("file sink keeps max_files segments", "[print_hpp::log::file]") {
+    temp_dir dir("log_file_test_max");
+    auto     path = dir.file("app.log");
+    {
+        auto sink = MmapFileSink(
+            {.path = path, .segment_size = 16, .max_files = 2});
+        for (int i = 0; i < 20; i++) {
+            sink.write("0123456789abcde\n");
+        }
+    }
+    REQUIRE(dir.count() == 2);
+    REQUIRE(read_file(path + ".18") == "0123456789abcde\n");
+    REQUIRE(read_file(path + ".19") == "0123456789abcde\n");
+}
+
+TEST_CASE("file sink rotates by age", "[print_hpp::log::file]") {
+    temp_dir dir("log_file_test_age");
+    auto     path = dir.file("app.log");
+    auto     sink = MmapFileSink(
+        {.path = path, .max_age = std::chrono::milliseconds(20)});
+
+    // An empty segment is never rotated
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    REQUIRE(sink.rotations() == 0);
+
+    sink.write("first\n");
+    auto deadline
+        = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (sink.rotations() == 0
+           && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    REQUIRE(sink.rotations() >= 1);
+    sink.write("second\n");
+}
+
+TEST_CASE("file sink with concurrent writers", "[print_hpp::log::file]") {
+    temp_dir dir("log_file_test_threads");
+    auto     path = dir.file("app.log");
+    {
+        auto sink = MmapFileSink({.path = path, .segment_size = 4096});
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&sink, t] {
+                for (int i = 0; i < 2000; i++) {
+                    sink.write("thread " + std::to_string(t) + " line "
+                               + std::to_string(i) + "\n");
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        REQUIRE(sink.dropped() == 0);
+        REQUIRE(sink.rotations() > 0);
+    }
+
+    // No line is lost, torn or duplicated, and each thread's lines keep
+    // their order
+    auto                  text = read_segments(path);
+    std::istringstream    in(text);
+    std::string           line;
+    std::vector<int>      next(4, 0);
+    std::size_t           lines = 0;
+    while (std::getline(in, line)) {
+        int t = 0;
+        int i = 0;
+        REQUIRE(std::sscanf(line.c_str(), "thread %d line %d", &t, &i) == 2);
+        REQUIRE(i == next[t]++);
+        lines++;
+    }
+    REQUIRE(lines == 8000);
+}
+
+TEST_CASE("console logger writes through a file sink",
+          "[print_hpp::log::file]") {
+    temp_dir dir("log_file_test_console");
+    auto     path = dir.file("app.log");
+    {
+        auto sink = std::make_shared<MmapFileSink>(
+            FileSinkOptions{.path = path, .segment_size = 1024});
+        auto logger = detail::ConsoleLogger();
+        logger.set_sink(sink);
+        logger.info("sync {}", 1);
+        logger.enable_async();
+        for (int i = 0; i < 100; i++) {
+            logger.warn("async {}", i);
+        }
+        logger.flush();
+        logger.disable_async();
+        REQUIRE(sink->dropped() == 0);
+    }
+
+    auto text = read_segments(path);
+    REQUIRE(std::count(text.begin(), text.end(), '\n') == 101);
+    REQUIRE(text.find("sync 1") < text.find("async 0"));
+    REQUIRE(text.find("async 99") != std::string::npos);
+}
+
+TEST_CASE("binary log records through a file sink",
+          "[print_hpp::log::file]") {
+    temp_dir dir("log_file_test_binary");
+    auto     path = dir.file("app.log");
+    {
+        auto sink = MmapFileSink({.path = path});
+        auto writer = BinaryLogWriter();
+        for (int i = 0; i < 3; i++) {
+            BINARY_LOG(writer, INFO, "record {}", i);
+        }
+        writer.flush(sink);
+    }
+
+    auto text = BinaryLogDecoder().decode(read_segments(path));
+    REQUIRE(text.find("record 0") < text.find("record 2"));
+}
@@ -0,0 +1,99 @@
+// Everything below INFO is compiled out in this test
+#define PRINT_HPP_MIN_LOG_LEVEL 2
+
+#include "struct_pack/binary_log.hpp"
+#include "struct_pack/debug.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+#include <catch2/catch.hpp>
+
+namespace {
+// Redirects std::clog for the lifetime of the object
+class capture_clog {
+public:
+    capture_clog()
+        : old_{std::clog.rdbuf(out_.rdbuf())} {}
+
+    ~capture_clog() {
+        std::clog.rdbuf(old_);
+    }
+
+    auto lines() const -> std::size_t {
+        auto text = out_.str();
+        return static_cast<std::size_t>(
+            std::count(text.begin(), text.end(), '\n'));
+    }
+
+private:
+    std::ostringstream out_;
+    std::streambuf    *old_;
+};
+
+int evaluated = 0;
+
+auto expensive() -> int {
+    return ++evaluated;
+}
+} // namespace
+
+TEST_CASE("levels below the minimum are compiled out",
+          "[print_hpp::log::level]") {
+    using print_hpp::log::LogLevel;
+    capture_clog captured;
+    evaluated = 0;
+
+    SET_LOG_LEVEL(LogLevel::TRACE);
+    REQUIRE_FALSE(debug_logger.enabled<LogLevel::DEBUG>());
+    REQUIRE(debug_logger.enabled<LogLevel::INFO>());
+
+    LOG_TRACE("{}", expensive());
+    LOG_DEBUG("{}", expensive());
+    LOG_INFO("{}", expensive());
+    REQUIRE(evaluated == 1);
+    REQUIRE(captured.lines() == 1);
+
+    // Runtime threshold above the compile-time one
+    SET_LOG_LEVEL(LogLevel::ERROR);
+    LOG_WARN("{}", expensive());
+    LOG_IF(ERROR, expensive() > 0)("{}", expensive());
+    LOG_IF(WARN, expensive() > 0)("{}", expensive());
+    REQUIRE(evaluated == 3);
+    REQUIRE(captured.lines() == 2);
+    SET_LOG_LEVEL(LogLevel::DEBUG);
+
+    auto writer = print_hpp::log::BinaryLogWriter();
+    writer.set_level(LogLevel::TRACE);
+    BINARY_LOG(writer, DEBUG, "{}", expensive());
+    REQUIRE(writer.size() == 0);
+    REQUIRE(evaluated == 3);
+}
+
+TEST_CASE("LOG_EVERY_N and LOG_EVERY_MS", "[print_hpp::log::level]") {
+    capture_clog captured;
+    evaluated = 0;
+
+    for (int i = 0; i < 10; i++) {
+        LOG_EVERY_N(INFO, 4, "every 4th: {} {}", i, expensive());
+    }
+    REQUIRE(captured.lines() == 3); // 0, 4 and 8
+    REQUIRE(evaluated == 3);
+
+    for (int i = 0; i < 1000; i++) {
+        LOG_EVERY_MS(WARN, 60'000, "at most once a minute: {}", i);
+    }
+    REQUIRE(captured.lines() == 4);
+
+    // Disabled levels do not advance the counter
+    for (int i = 0; i < 3; i++) {
+        LOG_EVERY_N(DEBUG, 2, "{}", expensive());
+    }
+    REQUIRE(evaluated == 3);
+
+    // Every 0th is every time
+    for (int i = 0; i < 3; i++) {
+        LOG_EVERY_N(INFO, 0, "every time: {}", i);
+    }
+    REQUIRE(captured.lines() == 7);
+}
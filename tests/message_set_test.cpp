@@ -0,0 +1,119 @@
+#include "struct_pack.hpp"
+#include "struct_pack/message_set.hpp"
+
+#include <string>
+#include <utility>
+
+#include <catch2/catch.hpp>
+
+using namespace std::string_view_literals;
+
+namespace {
+using dense_set = struct_pack::message_set<
+    decltype("B"_fmt),
+    struct_pack::message<1, decltype("<Iq"_fmt)>,
+    struct_pack::message<2, decltype("<4s"_fmt)>,
+    struct_pack::message<9, decltype("<?"_fmt)>>;
+
+using sparse_set = struct_pack::message_set<
+    decltype("!I"_fmt),
+    struct_pack::message<0x10000, decltype("!H"_fmt)>,
+    struct_pack::message<0xDEADBEEF, decltype("!I"_fmt)>,
+    struct_pack::message<77, decltype("!2s"_fmt)>,
+    struct_pack::message<0x7FFFFFFF, decltype("!b"_fmt)>>;
+
+template <std::size_t... Is>
+auto many_messages(std::index_sequence<Is...>)
+    -> struct_pack::message_set<
+        decltype("<H"_fmt),
+        struct_pack::message<Is * 1000 + 3, decltype("<Q"_fmt)>...>;
+using wide_set = decltype(many_messages(std::make_index_sequence<60>{}));
+} // namespace
+
+TEST_CASE("message_set dense dispatch", "[struct_pack::message_set]") {
+    static_assert(dense_set::uses_dense_table());
+    static_assert(dense_set::table_size == 10);
+
+    std::string seen;
+    auto        visitor = [&](auto msg, const auto &record) {
+        if constexpr (decltype(msg)::id == 1) {
+            auto [a, b] = record;
+            seen += std::to_string(a + b);
+        } else if constexpr (decltype(msg)::id == 2) {
+            seen += std::get<0>(record);
+        } else {
+            seen += std::get<0>(record) ? "T" : "F";
+        }
+    };
+
+    auto input = "\x01\x02\x00\x00\x00\x03\x00\x00\x00\x00\x00\x00\x00"sv;
+    auto result = dense_set::dispatch(input, visitor);
+    REQUIRE(result);
+    REQUIRE(result.size == 13);
+
+    REQUIRE(dense_set::dispatch("\x02wxyz"sv, visitor).size == 5);
+    REQUIRE(dense_set::dispatch("\x09\x01"sv, visitor));
+    REQUIRE(seen == "5wxyzT");
+
+    REQUIRE(dense_set::dispatch("\x03"sv, visitor).status
+            == struct_pack::dispatch_status::unknown_tag);
+    REQUIRE(dense_set::dispatch("\xff"sv, visitor).status
+            == struct_pack::dispatch_status::unknown_tag);
+
+    auto truncated = dense_set::dispatch("\x02wx"sv, visitor);
+    REQUIRE(truncated.status == struct_pack::dispatch_status::truncated);
+    REQUIRE(truncated.size == 5);
+    REQUIRE(dense_set::dispatch(""sv, visitor).status
+            == struct_pack::dispatch_status::truncated);
+    REQUIRE(seen == "5wxyzT");
+}
+
+TEST_CASE("message_set sparse dispatch", "[struct_pack::message_set]") {
+    static_assert(!sparse_set::uses_dense_table());
+
+    std::uint64_t last_id = 0;
+    auto          visitor = [&](auto msg, const auto &) {
+        last_id = decltype(msg)::id;
+    };
+
+    REQUIRE(sparse_set::dispatch("\x00\x01\x00\x00\x12\x34"sv, visitor));
+    REQUIRE(last_id == 0x10000);
+    REQUIRE(sparse_set::dispatch("\xde\xad\xbe\xef\x00\x00\x00\x01"sv,
+                                 visitor));
+    REQUIRE(last_id == 0xDEADBEEF);
+    REQUIRE(sparse_set::dispatch("\x00\x00\x00\x4dhi"sv, visitor));
+    REQUIRE(last_id == 77);
+    REQUIRE(sparse_set::dispatch("\x7f\xff\xff\xff\xff"sv, visitor));
+    REQUIRE(last_id == 0x7FFFFFFF);
+
+    // Unknown ids are rejected even if they hash to a used slot
+    for (std::uint32_t id : {0u, 1u, 78u, 0x10001u, 0xFFFFFFFFu}) {
+        auto packed = struct_pack::pack("!I"_fmt, id);
+        auto input = std::string(packed.data(), packed.size()) + "xxxx";
+        REQUIRE(sparse_set::dispatch(input, visitor).status
+                == struct_pack::dispatch_status::unknown_tag);
+    }
+}
+
+TEST_CASE("message_set with many sparse messages",
+          "[struct_pack::message_set]") {
+    static_assert(!wide_set::uses_dense_table());
+
+    for (std::uint16_t i = 0; i < 60; i++) {
+        std::uint16_t id = i * 1000 + 3;
+        char          input[10];
+        struct_pack::pack_into("<H"_fmt, input, id);
+        struct_pack::pack_into("<Q"_fmt, input + 2, i);
+
+        std::uint64_t seen_id = 0;
+        std::uint64_t value = 0;
+        auto          result = wide_set::dispatch(
+            std::string_view(input, 10), [&](auto msg, const auto &record) {
+                seen_id = decltype(msg)::id;
+                value = std::get<0>(record);
+            });
+        REQUIRE(result);
+        REQUIRE(seen_id == id);
+        REQUIRE(value == i);
+    }
+}
@@ -0,0 +1,124 @@
+#include "struct_pack.hpp"
+#include "struct_pack/record_builder.hpp"
+
+#include <cstdint>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+using namespace std::string_view_literals;
+
+namespace {
+using Fmt = decltype("<Iq3s"_fmt);
+
+auto expected_bytes(uint32_t count) -> std::string {
+    std::string bytes;
+    for (uint32_t i = 0; i < count; i++) {
+        auto packed = struct_pack::pack(Fmt{}, i, -int64_t{i}, "abc");
+        bytes.append(packed.data(), packed.size());
+    }
+    return bytes;
+}
+} // namespace
+
+TEST_CASE("record_builder packs records back to back",
+          "[struct_pack::record_builder]") {
+    auto builder = struct_pack::record_builder<Fmt>();
+    REQUIRE(builder.empty());
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        builder.append(i, -int64_t{i}, "abc");
+    }
+    REQUIRE(builder.size() == 1000);
+    REQUIRE(builder.capacity() >= 1000);
+    REQUIRE(builder.bytes() == expected_bytes(1000));
+    REQUIRE(builder[999].get<1>() == -999);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(builder.data()) % 64 == 0);
+
+    builder.clear();
+    REQUIRE(builder.empty());
+    REQUIRE(builder.capacity() >= 1000);
+}
+
+TEST_CASE("record_builder reserve avoids growth",
+          "[struct_pack::record_builder]") {
+    auto builder = struct_pack::record_builder<Fmt>();
+    builder.reserve(500);
+    REQUIRE(builder.capacity() == 500);
+    const auto *data = builder.data();
+    for (uint32_t i = 0; i < 500; i++) {
+        builder.append(i, -int64_t{i}, "abc");
+    }
+    REQUIRE(builder.data() == data);
+
+    // Reserving keeps what is already there
+    builder.reserve(2000);
+    REQUIRE(builder.bytes() == expected_bytes(500));
+}
+
+TEST_CASE("record_builder allocate fills records in place",
+          "[struct_pack::record_builder]") {
+    auto builder = struct_pack::record_builder<Fmt>();
+    builder.append(0, int64_t{0}, "abc");
+    char *records = builder.allocate(300);
+    for (uint32_t i = 1; i <= 300; i++, records += builder.record_size) {
+        struct_pack::pack_into(Fmt{}, records, i, -int64_t{i}, "abc");
+    }
+    REQUIRE(builder.size() == 301);
+    REQUIRE(builder.bytes() == expected_bytes(301));
+}
+
+TEST_CASE("record_builder truncate drops trailing records",
+          "[struct_pack::record_builder]") {
+    auto builder = struct_pack::record_builder<Fmt>();
+    for (uint32_t i = 0; i < 10; i++) {
+        builder.append(i, -int64_t{i}, "abc");
+    }
+    builder.truncate(4);
+    REQUIRE(builder.size() == 4);
+    REQUIRE(builder.bytes() == expected_bytes(4));
+
+    // Never grows
+    builder.truncate(8);
+    REQUIRE(builder.size() == 4);
+}
+
+TEST_CASE("record_builder release hands out the buffer",
+          "[struct_pack::record_builder]") {
+    auto builder = struct_pack::record_builder<Fmt>();
+    for (uint32_t i = 0; i < 10; i++) {
+        builder.append(i, -int64_t{i}, "abc");
+    }
+    const auto *data = builder.data();
+
+    auto buffer = builder.release();
+    REQUIRE(buffer.data() == data);
+    REQUIRE(buffer.size() == 10);
+    REQUIRE(buffer.bytes() == expected_bytes(10));
+    REQUIRE(buffer[3].get<2>() == "abc"sv);
+
+    // The builder starts over with a buffer of its own
+    REQUIRE(builder.empty());
+    builder.append(1u, int64_t{1}, "xyz");
+    REQUIRE(builder.data() != data);
+    REQUIRE(buffer.bytes() == expected_bytes(10));
+}
+
+TEST_CASE("record_builder with huge pages",
+          "[struct_pack::record_builder]") {
+    constexpr uint32_t count = 300'000; // several MiB
+    auto               builder
+        = struct_pack::record_builder<Fmt>(struct_pack::buffer_pages::huge);
+
+    builder.append(0u, int64_t{0}, "abc");
+    REQUIRE(!builder.huge_pages()); // small batches stay on the heap
+    for (uint32_t i = 1; i < count; i++) {
+        builder.append(i, -int64_t{i}, "abc");
+    }
+    REQUIRE(builder.huge_pages());
+    REQUIRE(builder.bytes() == expected_bytes(count));
+
+    auto buffer = builder.release();
+    REQUIRE(buffer.size() == count);
+    REQUIRE(buffer[count - 1].get<0>() == count - 1);
+}
@@ -0,0 +1,177 @@
+#include "struct_pack.hpp"
+#include "struct_pack/record_ring.hpp"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using namespace std::string_view_literals;
+
+namespace {
+using Fmt = decltype("<Iq3s"_fmt);
+} // namespace
+
+TEST_CASE("record_ring push and pop", "[struct_pack::record_ring]") {
+    auto ring = struct_pack::record_ring<Fmt>(3);
+    REQUIRE(ring.capacity() == 4);
+    REQUIRE(ring.empty());
+    REQUIRE(!ring.try_pop());
+
+    // Several laps around the ring
+    for (uint32_t lap = 0; lap < 5; lap++) {
+        for (uint32_t i = 0; i < 4; i++) {
+            REQUIRE(ring.try_push(lap * 4 + i, -int64_t{i}, "abc"));
+        }
+        REQUIRE(!ring.try_push(0u, int64_t{0}, "xyz"));
+        REQUIRE(ring.size() == 4);
+        for (uint32_t i = 0; i < 4; i++) {
+            auto record = ring.try_pop();
+            REQUIRE(record);
+            auto [id, value, name] = *record;
+            REQUIRE(id == lap * 4 + i);
+            REQUIRE(value == -int64_t{i});
+            REQUIRE(name == "abc"sv);
+        }
+        REQUIRE(ring.empty());
+    }
+}
+
+TEST_CASE("record_ring try_pop copies strings out of the slot",
+          "[struct_pack::record_ring]") {
+    auto ring = struct_pack::record_ring<Fmt>(2);
+    REQUIRE(ring.try_push(1u, int64_t{1}, "abc"));
+    auto record = ring.try_pop();
+    REQUIRE(record);
+
+    // Both slots are overwritten after the pop
+    REQUIRE(ring.try_push(2u, int64_t{2}, "xyz"));
+    REQUIRE(ring.try_push(3u, int64_t{3}, "xyz"));
+    REQUIRE(std::get<2>(*record) == "abc"sv);
+}
+
+TEST_CASE("record_ring batches are views into the ring",
+          "[struct_pack::record_ring]") {
+    auto ring = struct_pack::record_ring<Fmt>(8);
+
+    auto r = ring.try_reserve(5);
+    REQUIRE(r.count == 5);
+    for (uint32_t i = 0; i < r.count; i++) {
+        struct_pack::pack_into(
+            Fmt{}, r.data + i * ring.record_size, i, int64_t{i} * 10, "abc");
+    }
+    // Nothing is visible before the commit
+    REQUIRE(ring.peek().empty());
+    ring.commit(r);
+
+    auto batch = ring.peek(3);
+    REQUIRE(batch.size() == 3);
+    REQUIRE(batch[2].get<0>() == 2);
+    REQUIRE(batch[2].get<1>() == 20);
+    REQUIRE(batch[2].get<2>() == "abc"sv);
+    REQUIRE(batch.bytes().data() == r.data);
+    REQUIRE(batch.bytes().size() == 3 * ring.record_size);
+    ring.release(3);
+
+    // A reservation stops at the end of the ring
+    auto wrapped = ring.try_reserve(8);
+    REQUIRE(wrapped.count == 3);
+    REQUIRE(wrapped.data == r.data + 5 * ring.record_size);
+    for (uint32_t i = 0; i < wrapped.count; i++) {
+        struct_pack::pack_into(Fmt{},
+                               wrapped.data + i * ring.record_size,
+                               i + 5,
+                               int64_t{0},
+                               "xyz");
+    }
+    ring.commit(wrapped);
+    REQUIRE(ring.try_reserve(8).count == 3);
+
+    std::vector<uint32_t> ids;
+    REQUIRE(ring.consume([&](auto record) {
+        ids.push_back(record.template get<0>());
+    }) == 5);
+    REQUIRE(ids == std::vector<uint32_t>{3, 4, 5, 6, 7});
+}
+
+TEST_CASE("record_ring hands records between threads",
+          "[struct_pack::record_ring]") {
+    constexpr uint32_t count = 200'000;
+
+    SECTION("single producer") {
+        auto ring = struct_pack::record_ring<Fmt>(64);
+        auto producer = std::thread([&] {
+            for (uint32_t i = 0; i < count; i++) {
+                ring.push(i, int64_t{i} * 3, "abc");
+            }
+        });
+        uint32_t next = 0;
+        while (next < count) {
+            auto consumed = ring.consume([&](auto record) {
+                auto [id, value, name] = record.unpack();
+                REQUIRE(id == next);
+                REQUIRE(value == int64_t{id} * 3);
+                next++;
+            });
+            if (consumed == 0) {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+        REQUIRE(ring.empty());
+    }
+
+    SECTION("multiple producers") {
+        constexpr uint32_t producers = 4;
+        auto               ring = struct_pack::record_ring<
+            Fmt,
+            struct_pack::ring_producers::multiple>(64);
+        std::vector<std::thread> threads;
+        for (uint32_t p = 0; p < producers; p++) {
+            threads.emplace_back([&ring, p] {
+                // Alternate single pushes and batches
+                for (uint32_t i = 0; i < count;) {
+                    auto r = ring.try_reserve(i % 2 == 0 ? 1 : 7);
+                    if (r.count == 0) {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    auto n = std::min<std::size_t>(r.count, count - i);
+                    for (std::size_t k = 0; k < r.count; k++) {
+                        struct_pack::pack_into(
+                            Fmt{},
+                            r.data + k * ring.record_size,
+                            p,
+                            static_cast<int64_t>(k < n ? i + k : count),
+                            "abc");
+                    }
+                    ring.commit(r);
+                    i += static_cast<uint32_t>(n);
+                }
+            });
+        }
+
+        std::vector<int64_t> next(producers, 0);
+        std::size_t          received = 0;
+        while (received < producers * count) {
+            auto consumed = ring.consume([&](auto record) {
+                auto p = record.template get<0>();
+                auto i = record.template get<1>();
+                if (i == count) {
+                    return; // padding of a partly used batch
+                }
+                REQUIRE(i == next[p]++);
+                received++;
+            });
+            if (consumed == 0) {
+                std::this_thread::yield();
+            }
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        ring.consume([](auto) {});
+        REQUIRE(ring.empty());
+    }
+}
@@ -0,0 +1,142 @@
+#include "struct_pack.hpp"
+#include "struct_pack/record_writer.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+
+using namespace std::string_view_literals;
+
+namespace {
+auto read_back(std::FILE *file) -> std::string {
+    std::string contents;
+    char        chunk[4096];
+    std::rewind(file);
+    while (auto n = std::fread(chunk, 1, sizeof(chunk), file)) {
+        contents.append(chunk, n);
+    }
+    return contents;
+}
+} // namespace
+
+TEST_CASE("pack_into matches pack", "[struct_pack::pack_into]") {
+    char buffer[16];
+    std::fill(std::begin(buffer), std::end(buffer), '\xAA');
+
+    auto n = struct_pack::pack_into(PY_STRING("<h5s"), buffer, 126, "12");
+    REQUIRE(n == 7);
+    REQUIRE(std::string_view(buffer, n) == "\x7e\x00"
+                                           "12\x00\x00\x00"sv);
+    // Bytes after the record are untouched
+    REQUIRE(buffer[n] == '\xAA');
+
+    // Padding of a reused buffer is cleared
+    std::fill(std::begin(buffer), std::end(buffer), '\xAA');
+    n = struct_pack::pack_into(PY_STRING("@ci"), buffer, 'x', 1);
+    auto packed = struct_pack::pack(PY_STRING("@ci"), 'x', 1);
+    REQUIRE(n == packed.size());
+    REQUIRE(std::string_view(buffer, n)
+            == std::string_view(packed.data(), packed.size()));
+}
+
+TEST_CASE("record_writer batches records", "[struct_pack::record_writer]") {
+    using Fmt = decltype("<I4s"_fmt);
+    auto *file = std::tmpfile();
+    REQUIRE(file != nullptr);
+
+    {
+        // Room for three records, so every third write flushes
+        auto writer = struct_pack::record_writer<Fmt>(fileno(file), 24);
+        for (uint32_t i = 0; i < 10; i++) {
+            writer.write(i, "abcd");
+        }
+        REQUIRE(writer.records_written() == 10);
+        REQUIRE(writer.bytes_written() == 9 * 8);
+        REQUIRE(writer.buffered_bytes() == 8);
+
+        writer.flush();
+        REQUIRE(writer.bytes_written() == 10 * 8);
+        REQUIRE(writer.buffered_bytes() == 0);
+    }
+
+    auto contents = read_back(file);
+    auto view = std::string_view(contents);
+    REQUIRE(contents.size() == 80);
+    for (uint32_t i = 0; i < 10; i++) {
+        auto [value, str] = struct_pack::unpack(Fmt{}, view.substr(i * 8));
+        REQUIRE(value == i);
+        REQUIRE(str == "abcd"sv);
+    }
+    std::fclose(file);
+}
+
+TEST_CASE("record_writer flush threshold and packed batches",
+          "[struct_pack::record_writer]") {
+    using Fmt = decltype(">H"_fmt);
+    auto *file = std::tmpfile();
+    REQUIRE(file != nullptr);
+
+    {
+        auto writer = struct_pack::record_writer<Fmt>(fileno(file), 64, 4);
+        writer.write(1);
+        REQUIRE(writer.bytes_written() == 0);
+        writer.write(2);
+        REQUIRE(writer.bytes_written() == 4);
+
+        writer.write(3);
+        std::vector<char> batch;
+        for (uint16_t i = 4; i < 100; i++) {
+            auto packed = struct_pack::pack(Fmt{}, i);
+            batch.insert(batch.end(), packed.begin(), packed.end());
+        }
+        // Larger than the buffer: goes out with a single writev
+        writer.write_packed(batch.data(), batch.size());
+        REQUIRE(writer.records_written() == 99);
+        REQUIRE(writer.bytes_written() == 99 * 2);
+        writer.sync();
+    } // destructor flushes nothing further
+
+    auto contents = read_back(file);
+    auto view = std::string_view(contents);
+    REQUIRE(contents.size() == 99 * 2);
+    for (uint16_t i = 0; i < 99; i++) {
+        REQUIRE(std::get<0>(struct_pack::unpack(Fmt{}, view.substr(i * 2)))
+                == i + 1);
+    }
+    std::fclose(file);
+}
+
+TEST_CASE("record_writer write_packed failures",
+          "[struct_pack::record_writer]") {
+    using Fmt = decltype(">H"_fmt);
+    auto *file = std::tmpfile();
+    REQUIRE(file != nullptr);
+    {
+        auto writer = struct_pack::record_writer<Fmt>(fileno(file), 8);
+        REQUIRE_THROWS_AS(writer.write_packed("\0\1\0", 3),
+                          std::system_error);
+        REQUIRE(writer.records_written() == 0);
+    }
+
+    // A writev that fails leaves nothing for the destructor to retry
+    int fds[2];
+    REQUIRE(::pipe(fds) == 0);
+    ::close(fds[0]);
+    std::signal(SIGPIPE, SIG_IGN);
+    {
+        auto writer = struct_pack::record_writer<Fmt>(fds[1], 8);
+        writer.write(1);
+        auto batch = std::string(16, '\0');
+        REQUIRE_THROWS_AS(writer.write_packed(batch.data(), batch.size()),
+                          std::system_error);
+        REQUIRE_NOTHROW(writer.flush());
+    }
+    ::close(fds[1]);
+    std::fclose(file);
+}
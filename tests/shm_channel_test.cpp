@@ -0,0 +1,159 @@
+#include "struct_pack.hpp"
+#include "struct_pack/shm_channel.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+
+using namespace std::string_view_literals;
+
+namespace {
+using Fmt = decltype("<Iq3s"_fmt);
+} // namespace
+
+TEST_CASE("shm_channel shares records between mappings",
+          "[struct_pack::shm_channel]") {
+    auto producer = struct_pack::shm_channel<Fmt>::create(5);
+    auto consumer = struct_pack::shm_channel<Fmt>::attach(producer.fd());
+    REQUIRE(consumer.capacity() == 8);
+    REQUIRE(!consumer.wait(std::chrono::milliseconds(1)));
+
+    for (uint32_t lap = 0; lap < 3; lap++) {
+        for (uint32_t i = 0; i < 8; i++) {
+            REQUIRE(producer.try_push(lap * 8 + i, -int64_t{i}, "abc"));
+        }
+        REQUIRE(!producer.try_push(0u, int64_t{0}, "xyz"));
+        REQUIRE(consumer.size() == 8);
+        REQUIRE(consumer.wait(std::chrono::milliseconds(1)));
+
+        auto batch = consumer.peek(3);
+        REQUIRE(batch.size() == 3);
+        REQUIRE(batch[1].get<0>() == lap * 8 + 1);
+        REQUIRE(batch[1].get<2>() == "abc"sv);
+        consumer.release(3);
+
+        std::vector<uint32_t> ids;
+        consumer.consume([&](auto record) {
+            auto [id, value, name] = record.unpack();
+            REQUIRE(value == -int64_t{id - lap * 8});
+            ids.push_back(id);
+        });
+        REQUIRE(ids.size() == 5);
+        REQUIRE(ids.front() == lap * 8 + 3);
+        REQUIRE(consumer.empty());
+    }
+}
+
+TEST_CASE("shm_channel checks the format on attach",
+          "[struct_pack::shm_channel]") {
+    auto channel = struct_pack::shm_channel<Fmt>::create(16);
+
+    using Other = decltype("<Iq4s"_fmt);
+    REQUIRE_THROWS_AS(
+        struct_pack::shm_channel<Other>::attach(channel.fd()),
+        std::system_error);
+    // Same size, different items
+    using Swapped = decltype("<qI3s"_fmt);
+    REQUIRE_THROWS_AS(
+        struct_pack::shm_channel<Swapped>::attach(channel.fd()),
+        std::system_error);
+    REQUIRE_NOTHROW(struct_pack::shm_channel<Fmt>::attach(channel.fd()));
+
+    // Not a channel at all
+    int fd = ::memfd_create("not_a_channel", MFD_CLOEXEC);
+    REQUIRE(::ftruncate(fd, 4096) == 0);
+    REQUIRE_THROWS_AS(struct_pack::shm_channel<Fmt>::attach(fd),
+                      std::system_error);
+    ::close(fd);
+}
+
+TEST_CASE("shm_channel rejects a capacity past the mapping",
+          "[struct_pack::shm_channel]") {
+    // 16-byte records: 2^62 of them is 2^66 bytes, which wraps to 0
+    using Wide = decltype("<Iq4s"_fmt);
+    auto channel = struct_pack::shm_channel<Wide>::create(16);
+
+    std::uint64_t capacity = std::uint64_t{1} << 62;
+    REQUIRE(::pwrite(channel.fd(),
+                     &capacity,
+                     sizeof(capacity),
+                     offsetof(struct_pack::detail::shm_channel_header,
+                              capacity))
+            == sizeof(capacity));
+    REQUIRE_THROWS_AS(struct_pack::shm_channel<Wide>::attach(channel.fd()),
+                      std::system_error);
+}
+
+TEST_CASE("shm_channel by name", "[struct_pack::shm_channel]") {
+    auto name = "/struct_pack_shm_channel_test." + std::to_string(::getpid());
+    auto producer = struct_pack::shm_channel<Fmt>::create(name, 64);
+    REQUIRE_THROWS_AS(struct_pack::shm_channel<Fmt>::create(name, 64),
+                      std::system_error);
+    auto consumer = struct_pack::shm_channel<Fmt>::attach(name);
+    struct_pack::shm_channel<Fmt>::unlink(name);
+
+    producer.push(7u, int64_t{-7}, "abc");
+    auto record = consumer.try_pop();
+    REQUIRE(record);
+    REQUIRE(std::get<0>(*record) == 7);
+}
+
+TEST_CASE("shm_channel try_pop copies strings out of the slot",
+          "[struct_pack::shm_channel]") {
+    auto producer = struct_pack::shm_channel<Fmt>::create(2);
+    auto consumer = struct_pack::shm_channel<Fmt>::attach(producer.fd());
+    REQUIRE(producer.try_push(1u, int64_t{1}, "abc"));
+    auto record = consumer.try_pop();
+    REQUIRE(record);
+
+    // Every slot is overwritten after the pop
+    for (uint32_t i = 0; i < producer.capacity(); i++) {
+        REQUIRE(producer.try_push(2u, int64_t{2}, "xyz"));
+    }
+    REQUIRE(std::get<2>(*record) == "abc"sv);
+}
+
+TEST_CASE("shm_channel between two processes",
+          "[struct_pack::shm_channel]") {
+    constexpr uint32_t count = 100'000;
+    auto               channel = struct_pack::shm_channel<Fmt>::create(256);
+
+    auto child = ::fork();
+    REQUIRE(child >= 0);
+    if (child == 0) {
+        // The producer process attaches on its own and fills the ring
+        // faster than the parent drains it, so both sides sleep on futexes
+        auto producer = struct_pack::shm_channel<Fmt>::attach(channel.fd());
+        for (uint32_t i = 0; i < count; i++) {
+            producer.push(i, int64_t{i} * 2, i % 2 == 0 ? "abc" : "xyz");
+        }
+        ::_exit(0);
+    }
+
+    uint32_t next = 0;
+    bool     ok = true;
+    while (next < count && ok) {
+        if (!channel.wait(std::chrono::seconds(10))) {
+            break;
+        }
+        channel.consume([&](auto record) {
+            auto [id, value, name] = record.unpack();
+            ok = ok && id == next && value == int64_t{id} * 2
+                 && name == (id % 2 == 0 ? "abc"sv : "xyz"sv);
+            next++;
+        });
+    }
+    int status = 0;
+    REQUIRE(::waitpid(child, &status, 0) == child);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+    REQUIRE(ok);
+    REQUIRE(next == count);
+}
@@ -0,0 +1,73 @@
+#include "struct_pack.hpp"
+#include "struct_pack/stream_decoder.hpp"
+
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using namespace std::string_view_literals;
+
+namespace {
+using Fmt = decltype(">Ih3s"_fmt);
+
+auto make_stream(uint32_t count) -> std::string {
+    std::string stream;
+    for (uint32_t i = 0; i < count; i++) {
+        auto packed = struct_pack::pack(
+            Fmt{}, i, static_cast<int16_t>(-i), i % 2 == 0 ? "abc" : "xyz");
+        stream.append(packed.data(), packed.size());
+    }
+    return stream;
+}
+} // namespace
+
+TEST_CASE("stream_decoder reassembles split records",
+          "[struct_pack::stream_decoder]") {
+    constexpr uint32_t count = 200;
+    auto               stream = make_stream(count);
+
+    for (std::size_t chunk_size : {1, 2, 8, 9, 10, 37, 4096}) {
+        auto decoder = struct_pack::stream_decoder<Fmt>{};
+        auto ids = std::vector<uint32_t>{};
+        auto view = std::string_view(stream);
+
+        while (!view.empty()) {
+            auto chunk = view.substr(0, chunk_size);
+            view.remove_prefix(chunk.size());
+            decoder.feed(chunk, [&](auto record) {
+                auto [id, value, str] = record;
+                REQUIRE(value == static_cast<int16_t>(-id));
+                REQUIRE(str == (id % 2 == 0 ? "abc"sv : "xyz"sv));
+                ids.push_back(id);
+            });
+            REQUIRE(decoder.buffered() < decoder.record_size);
+        }
+
+        REQUIRE(decoder.buffered() == 0);
+        REQUIRE(decoder.records_decoded() == count);
+        REQUIRE(ids.size() == count);
+        for (uint32_t i = 0; i < count; i++) {
+            REQUIRE(ids[i] == i);
+        }
+    }
+}
+
+TEST_CASE("stream_decoder keeps the partial tail",
+          "[struct_pack::stream_decoder]") {
+    auto stream = make_stream(2);
+    auto decoder = struct_pack::stream_decoder<Fmt>{};
+    auto calls = 0;
+    auto count = [&](auto) {
+        calls++;
+    };
+
+    REQUIRE(decoder.feed(std::string_view(stream).substr(0, 12), count) == 1);
+    REQUIRE(decoder.buffered() == 3);
+    REQUIRE(decoder.feed(std::string_view(stream).substr(12, 5), count) == 0);
+    REQUIRE(decoder.buffered() == 8);
+
+    decoder.reset();
+    REQUIRE(decoder.buffered() == 0);
+    REQUIRE(calls == 1);
+}
@@ -0,0 +1,88 @@
+#define STRUCT_PACK_TRACE_EVENTS 1
+
+#include "struct_pack.hpp"
+#include "struct_pack/log.hpp"
+#include "struct_pack/stream_decoder.hpp"
+#include "struct_pack/trace_event.hpp"
+
+#include <sstream>
+#include <thread>
+
+#include <catch2/catch.hpp>
+
+using namespace std::string_view_literals;
+
+namespace {
+auto flush_to_string() -> std::string {
+    std::ostringstream out;
+    struct_pack::trace_collector::instance().flush(out);
+    return out.str();
+}
+
+auto count(std::string_view haystack, std::string_view needle)
+    -> std::size_t {
+    std::size_t n = 0;
+    for (auto pos = haystack.find(needle); pos != std::string_view::npos;
+         pos = haystack.find(needle, pos + 1)) {
+        n++;
+    }
+    return n;
+}
+} // namespace
+
+TEST_CASE("constant evaluation records nothing", "[struct_pack::trace_span]") {
+    constexpr auto packed = struct_pack::pack("<h"_fmt, 0x0102);
+    static_assert(packed[0] == 0x02 && packed[1] == 0x01);
+    static_assert(std::get<0>(struct_pack::unpack(
+                      "<h"_fmt, std::string_view(packed.data(), 2)))
+                  == 0x0102);
+}
+
+TEST_CASE("pack, unpack and logger spans", "[struct_pack::trace_span]") {
+    flush_to_string();
+
+    auto packed = struct_pack::pack("<Ih"_fmt, 1, 2);
+    auto [a, b] = struct_pack::unpack(
+        "<Ih"_fmt, std::string_view(packed.data(), packed.size()));
+    REQUIRE(a == 1);
+    REQUIRE(b == 2);
+
+    print_hpp::log::console.set_level(print_hpp::log::LogLevel::INFO);
+    print_hpp::log::console.debug("filtered out");
+    print_hpp::log::console.info("traced {}", a);
+
+    std::thread([] {
+        STRUCT_PACK_TRACE_SPAN("worker", "test");
+        auto decoder = struct_pack::stream_decoder<decltype(">H"_fmt)>{};
+        decoder.feed("\x00\x01\x00\x02"sv, [](const auto &) {});
+    }).join();
+
+    auto json = flush_to_string();
+    REQUIRE(json.starts_with("{\"traceEvents\":["));
+    REQUIRE(json.ends_with("],\"displayTimeUnit\":\"ns\"}\n"));
+    REQUIRE(count(json, R"("ph":"B")") == count(json, R"("ph":"E")"));
+
+    REQUIRE(count(json, R"({"name":"pack","cat":"struct_pack","ph":"B")")
+            == 1);
+    REQUIRE(count(json, R"("args":{"format":"<Ih"})") == 2);
+    REQUIRE(count(json, R"("name":"ConsoleLogger::log")") == 2);
+    REQUIRE(count(json, R"("args":{"level":"INFO "})") == 1);
+    REQUIRE(count(json, R"("name":"worker","cat":"test")") == 2);
+    REQUIRE(count(json, R"("name":"stream_decoder::feed","cat":"bulk")")
+            == 2);
+    // One unpack for ours and one per decoded record
+    REQUIRE(count(json, R"("name":"unpack")") == 6);
+
+    // Everything was consumed by the previous flush
+    REQUIRE(count(flush_to_string(), "\"ph\"") == 0);
+}
+
+TEST_CASE("recording can be paused", "[struct_pack::trace_span]") {
+    auto &collector = struct_pack::trace_collector::instance();
+    flush_to_string();
+    collector.set_enabled(false);
+    (void) struct_pack::pack("<I"_fmt, 1);
+    collector.set_enabled(true);
+    REQUIRE(count(flush_to_string(), "\"ph\"") == 0);
+    REQUIRE(collector.dropped() == 0);
+}
@@ -0,0 +1,49 @@
+#include "struct_pack.hpp"
+#include "struct_pack/trace.hpp"
+
+#include <iostream>
+#include <sstream>
+
+#include <catch2/catch.hpp>
+
+using namespace std::string_view_literals;
+
+TEST_CASE("new_pack prints nothing by default", "[struct_pack::trace]") {
+    std::ostringstream captured;
+    auto              *old = std::cout.rdbuf(captured.rdbuf());
+    auto               packed = struct_pack::new_pack<"<hc">(1, 'x');
+    std::cout.rdbuf(old);
+
+    REQUIRE(captured.str().empty());
+    REQUIRE(std::string_view(packed.data(), packed.size()) == "\x01\x00x"sv);
+}
+
+TEST_CASE("recording_tracer records layout and values",
+          "[struct_pack::trace]") {
+    auto tracer = struct_pack::recording_tracer{};
+    auto traced = struct_pack::new_pack_traced<"@cih">(tracer, 'a', 7, -1);
+    auto plain = struct_pack::new_pack<"@cih">('a', 7, -1);
+    REQUIRE(traced == plain);
+
+    REQUIRE(tracer.records().size() == 1);
+    const auto &record = tracer.records()[0];
+    REQUIRE(record.format == "@cih");
+    REQUIRE(record.size == 10);
+    REQUIRE(record.items.size() == 3);
+
+    REQUIRE(record.items[0].format_char == 'c');
+    REQUIRE(record.items[0].offset == 0);
+    REQUIRE(record.items[1].index == 1);
+    REQUIRE(record.items[1].format_char == 'i');
+    REQUIRE(record.items[1].offset == 4);
+    REQUIRE(record.items[1].value == "7");
+    REQUIRE(record.items[2].offset == 8);
+    REQUIRE(record.items[2].value == "-1");
+    REQUIRE(record.elapsed.count() >= 0);
+
+    struct_pack::new_pack_traced<"<3s">(tracer, "xyz"sv);
+    REQUIRE(tracer.records()[1].items[0].value == "\"xyz\"");
+    REQUIRE(tracer.records().size() == 2);
+    tracer.clear();
+    REQUIRE(tracer.records().empty());
+}
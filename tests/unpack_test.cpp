@@ -149,3 +149,26 @@ TEST_CASE("unpack bools", "[struct_pack::unpack]") {
                 == std::make_tuple(true));
     }
 }
+
+TEST_CASE("try_unpack", "[struct_pack::try_unpack]") {
+    REQUIRE_STATIC(
+        struct_pack::try_unpack(PY_STRING("<h5s"), "\x7e\x00"
+                                                   "12345"sv)
+            .has_value());
+    REQUIRE_STATIC(*struct_pack::try_unpack(PY_STRING(">h"), "\x00\x7e"sv)
+                   == std::make_tuple(126));
+
+    // A truncated input is reported instead of read past its end
+    auto truncated = struct_pack::try_unpack(PY_STRING("<h5s"), "\x7e\x00"
+                                                                "1234"sv);
+    REQUIRE_FALSE(truncated);
+    REQUIRE(truncated.error() == struct_pack::unpack_error::truncated);
+    REQUIRE(struct_pack::try_unpack(PY_STRING("<I"), ""sv).error()
+            == struct_pack::unpack_error::truncated);
+
+    // Only 0 and 1 are valid bools
+    REQUIRE(*struct_pack::try_unpack(PY_STRING("c2?"), "x\x01\x00"sv)
+            == std::make_tuple('x', true, false));
+    auto invalid = struct_pack::try_unpack(PY_STRING("c2?"), "x\x01\x02"sv);
+    REQUIRE(invalid.error() == struct_pack::unpack_error::invalid_bool);
+}